@@ -0,0 +1,76 @@
+#!/usr/bin/env python
+"""\
+Names the callers in the output of the alloc command
+
+Reads what alloc printed, from a file or stdin, and looks each address up in the
+firmware elf with addr2line, so the table shows the function and line that made
+the allocations. The elf has to be the one the board is running.
+
+    alloc-symbolize.py dump.txt
+    alloc-symbolize.py -e LPC1768/main.elf --by-function < dump.txt
+"""
+
+from __future__ import print_function
+import sys
+import re
+import argparse
+import subprocess
+
+# Define command line argument interface
+parser = argparse.ArgumentParser(description='Name the callers in the output of the alloc command.')
+parser.add_argument('dump', nargs='?', type=argparse.FileType('r'), default=sys.stdin,
+        help='output of the alloc command, stdin if not given')
+parser.add_argument('-e', '--elf', default='LPC1768/main.elf',
+        help='firmware elf the board is running (default LPC1768/main.elf)')
+parser.add_argument('-a', '--addr2line', default='arm-none-eabi-addr2line',
+        help='addr2line to use (default arm-none-eabi-addr2line)')
+parser.add_argument('-f', '--by-function', action='store_true', default=False,
+        help='add up the counts of each function instead of listing each caller')
+args = parser.parse_args()
+
+# 0x00012345      1234      56789  <=32 max 20
+line_re = re.compile(r'^\s*0x([0-9A-Fa-f]+)\s+(\d+)\s+(\d+)\s+<=(\d+)\s+max\s+(\d+)')
+
+entries = []
+for line in args.dump:
+    m = line_re.match(line)
+    if m:
+        entries.append((int(m.group(1), 16), int(m.group(2)), int(m.group(3)), int(m.group(4)), int(m.group(5))))
+    elif line.strip() and line.split()[0] != 'pc':
+        print(line.rstrip())
+
+if not entries:
+    print('no allocations found in the input')
+    sys.exit(1)
+
+# the addresses are where the call returns to with the thumb bit set, look up the call itself
+pcs = sorted(set(e[0] for e in entries))
+cmd = [args.addr2line, '-f', '-C', '-e', args.elf] + ['0x%x' % ((pc & ~1) - 2) for pc in pcs]
+try:
+    out = subprocess.check_output(cmd, universal_newlines=True).splitlines()
+except (OSError, subprocess.CalledProcessError) as e:
+    print('could not run {}: {}'.format(args.addr2line, e))
+    sys.exit(1)
+
+where = {}
+for i, pc in enumerate(pcs):
+    function = out[2 * i] if 2 * i < len(out) else '??'
+    location = out[2 * i + 1] if 2 * i + 1 < len(out) else '??:0'
+    where[pc] = (function, location.split('/')[-1])
+
+if args.by_function:
+    totals = {}
+    for pc, count, nbytes, bucket, biggest in entries:
+        function = where[pc][0]
+        t = totals.setdefault(function, [0, 0, 0])
+        t[0] += count
+        t[1] += nbytes
+        t[2] = max(t[2], biggest)
+    print('    count      bytes    max  function')
+    for function, t in sorted(totals.items(), key=lambda kv: kv[1][0], reverse=True):
+        print('{:9d} {:10d} {:6d}  {}'.format(t[0], t[1], t[2], function))
+else:
+    print('        pc     count      bytes   size  function')
+    for pc, count, nbytes, bucket, biggest in entries:
+        function, location = where[pc]
+        print('0x{:08X} {:9d} {:10d} {:>6}  {} ({})'.format(pc, count, nbytes, '<=%d' % bucket, function, location))
@@ -21,6 +21,7 @@
 #include "mpu.h"
 
 #include "platform_memory.h"
+#include "AllocProfile.h"
 
 unsigned int g_maximumHeapAddress;
 
@@ -359,10 +360,18 @@ static void breakOnHeapOpFromInterruptHandler(void)
         __debugbreak();
 }
 
+/* While the alloc command has profiling on, count each allocation against the code that made it. */
+static inline void profileAllocation(void *returnAddress, size_t size)
+{
+    if (AllocProfile::is_on())
+        AllocProfile::record((uint32_t)returnAddress, size);
+}
+
 extern "C" void *__real_malloc(size_t size);
 extern "C" void *__wrap_malloc(size_t size)
 {
     breakOnHeapOpFromInterruptHandler();
+    profileAllocation(__builtin_return_address(0), size);
     return __real_malloc(size);
 }
 
@@ -371,6 +380,7 @@ extern "C" void *__real_realloc(void *ptr, size_t size);
 extern "C" void *__wrap_realloc(void *ptr, size_t size)
 {
     breakOnHeapOpFromInterruptHandler();
+    profileAllocation(__builtin_return_address(0), size);
     return __real_realloc(ptr, size);
 }
 
@@ -382,4 +392,25 @@ extern "C" void __wrap_free(void *ptr)
     __real_free(ptr);
 }
 
+/* Replace the library's new so allocations are profiled against the caller of new and not new itself. */
+void *operator new(size_t size)
+{
+    breakOnHeapOpFromInterruptHandler();
+    profileAllocation(__builtin_return_address(0), size);
+    void *p = __real_malloc(size);
+    if (!p)
+        abort();
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    breakOnHeapOpFromInterruptHandler();
+    profileAllocation(__builtin_return_address(0), size);
+    void *p = __real_malloc(size);
+    if (!p)
+        abort();
+    return p;
+}
+
 #endif // HEAP_TAGS
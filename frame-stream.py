@@ -0,0 +1,340 @@
+#!/usr/bin/env python
+"""\
+Stream g-code to the controller over USB serial or WiFi using batch frames
+and character counting flow control.
+
+Lines are packed into PTYPE_CTRL_BATCH frames. The controller holds the text
+of queued batches in a buffer whose capacity it advertises in every ack, the
+host keeps the text of all unacked batches within that capacity so the buffer
+never runs dry while waiting for a reply, as in Grbl's character counting mode.
+
+  frame-stream.py file.nc /dev/ttyACM0
+  frame-stream.py file.nc 192.168.4.1:2222
+  frame-stream.py --simulate          runs the streamer against a simulated controller
+"""
+
+from __future__ import print_function
+import sys
+import argparse
+import collections
+import random
+import socket
+import struct
+import time
+
+HEADER = 0x8668
+FOOTER = 0x55AA
+PTYPE_CTRL_SINGLE = 0xA1
+PTYPE_CTRL_BATCH = 0xA3
+PTYPE_BATCH_ACK = 0x86
+PTYPE_NORMAL_INFO = 0x90
+
+LINE_OK = ord('0')
+LINE_ERROR = ord('1')
+LINE_SKIPPED = ord('2')
+
+# payload has to fit the 544 byte frame buffers of SerialConsole and WifiProvider
+MAX_BATCH_TEXT = 500
+
+
+def crc16_ccitt(data):
+    crc = 0
+    for c in bytearray(data):
+        crc ^= c << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def make_frame(ptype, payload):
+    body = struct.pack('>HB', len(payload) + 3, ptype) + payload
+    return struct.pack('>H', HEADER) + body + struct.pack('>HH', crc16_ccitt(body), FOOTER)
+
+
+class FrameReader(object):
+    """Splits a byte stream into (type, payload) frames, drops anything that does not check out."""
+
+    def __init__(self):
+        self.buf = bytearray()
+
+    def feed(self, data):
+        self.buf += data
+        frames = []
+        while True:
+            i = self.buf.find(struct.pack('>H', HEADER))
+            if i < 0:
+                del self.buf[:-1]
+                return frames
+            del self.buf[:i]
+            if len(self.buf) < 4:
+                return frames
+            length = (self.buf[2] << 8) | self.buf[3]
+            if len(self.buf) < length + 6:
+                return frames
+            frame = bytes(self.buf[:length + 6])
+            crc, footer = struct.unpack('>HH', frame[-4:])
+            if length >= 3 and footer == FOOTER and crc == crc16_ccitt(frame[2:-4]):
+                frames.append((bytearray(frame)[4], frame[5:-4]))
+                del self.buf[:length + 6]
+            else:
+                del self.buf[:2]
+
+
+class SerialLink(object):
+    def __init__(self, dev):
+        import serial
+        self.s = serial.Serial(dev, 115200, timeout=0.05)
+        self.s.reset_input_buffer()
+
+    def write(self, data):
+        self.s.write(data)
+
+    def read(self):
+        return self.s.read(self.s.in_waiting or 1)
+
+
+class TcpLink(object):
+    def __init__(self, addr):
+        host, _, port = addr.partition(':')
+        self.s = socket.create_connection((host, int(port or 2222)))
+        self.s.settimeout(0.05)
+
+    def write(self, data):
+        self.s.sendall(data)
+
+    def read(self):
+        try:
+            return self.s.recv(4096)
+        except socket.timeout:
+            return b''
+
+
+class Streamer(object):
+    def __init__(self, link, verbose=True):
+        self.link = link
+        self.reader = FrameReader()
+        self.verbose = verbose
+        self.capacity = 0
+        self.free = 0
+        self.seq = 0
+        self.unacked = collections.OrderedDict()  # seq -> (first line number, text)
+        self.in_flight = 0
+        self.errors = []
+        self.resent = 0
+        self.max_in_flight = 0
+
+    def send_batch(self, text):
+        self.seq = (self.seq + 1) & 0xFFFF
+        self.link.write(make_frame(PTYPE_CTRL_BATCH, struct.pack('>H', self.seq) + text))
+        return self.seq
+
+    def poll(self):
+        for ptype, payload in self.reader.feed(self.link.read()):
+            if ptype == PTYPE_BATCH_ACK:
+                self.on_ack(payload)
+            elif ptype == PTYPE_NORMAL_INFO and self.verbose:
+                sys.stdout.write(payload.decode('ascii', 'replace'))
+
+    def on_ack(self, payload):
+        seq, self.capacity, self.free = struct.unpack('>HHH', payload[:6])
+        status = bytearray(payload[6:])
+        if seq not in self.unacked:
+            return
+        first, text = self.unacked.pop(seq)
+        self.in_flight -= len(text)
+        for i, st in enumerate(status):
+            if st == LINE_ERROR:
+                self.errors.append(first + i)
+        if status and all(st == LINE_SKIPPED for st in status) and not self.errors:
+            # turned away for lack of room, which only happens if our count went wrong, send it again
+            self.resent += 1
+            self.queue(first, text)
+
+    def queue(self, first, text):
+        seq = self.send_batch(text)
+        self.unacked[seq] = (first, text)
+        self.in_flight += len(text)
+        self.max_in_flight = max(self.max_in_flight, self.in_flight)
+
+    def handshake(self, timeout=5.0):
+        # an empty batch is answered straight away with the buffer capacity
+        seq = self.send_batch(b'')
+        self.unacked[seq] = (0, b'')
+        end = time.time() + timeout
+        while self.capacity == 0:
+            if time.time() > end:
+                raise RuntimeError('no answer to batch handshake, is the firmware too old?')
+            self.poll()
+        if self.verbose:
+            print('controller buffer: %d bytes' % self.capacity)
+
+    def stream(self, lines):
+        self.handshake()
+        limit = min(MAX_BATCH_TEXT, self.capacity // 2)
+        pending = b''
+        first = 1
+        lineno = 0
+        for line in lines:
+            line = line.split(';', 1)[0].strip()
+            if not line:
+                continue
+            lineno += 1
+            data = line.encode('ascii') + b'\n'
+            if pending and len(pending) + len(data) > limit:
+                self.flush(first, pending)
+                pending = b''
+                first = lineno
+            pending += data
+            if self.errors:
+                break
+        if pending and not self.errors:
+            self.flush(first, pending)
+        while self.unacked:
+            self.poll()
+        return lineno
+
+    def flush(self, first, text):
+        # character counting: only send when all unacked text plus this fits the controller buffer
+        while self.in_flight + len(text) > self.capacity and not self.errors:
+            self.poll()
+        if not self.errors:
+            self.queue(first, text)
+
+    def abort(self):
+        self.link.write(make_frame(PTYPE_CTRL_SINGLE, b'\x18'))
+
+
+class SimulatedController(object):
+    """Models CommandBatch: BATCH_BUFFER_SIZE bytes of queued batch text, lines run at a fixed rate,
+    acks go out when the last line of a batch has run, batches that do not fit are skipped."""
+
+    def __init__(self, capacity=1024, lines_per_read=3, fail_line=None):
+        self.capacity = capacity
+        self.lines_per_read = lines_per_read
+        self.fail_line = fail_line
+        self.reader = FrameReader()
+        self.batches = collections.deque()
+        self.queued = 0
+        self.max_queued = 0
+        self.out = b''
+        self.executed = []
+        self.halted = False
+        self.idle_reads = 0
+
+    def write(self, data):
+        for ptype, payload in self.reader.feed(data):
+            if ptype == PTYPE_CTRL_SINGLE and payload == b'\x18':
+                self.halted = True
+            elif ptype == PTYPE_CTRL_BATCH:
+                seq = struct.unpack('>H', payload[:2])[0]
+                text = payload[2:]
+                lines = text.split(b'\n')
+                if lines and lines[-1] == b'':
+                    lines.pop()
+                if not text:
+                    self.ack(seq, b'')
+                elif self.queued + len(text) > self.capacity:
+                    self.ack(seq, bytes(bytearray([LINE_SKIPPED] * len(lines))))
+                else:
+                    self.queued += len(text)
+                    self.max_queued = max(self.max_queued, self.queued)
+                    self.batches.append([seq, len(text), lines, bytearray()])
+
+    def ack(self, seq, status):
+        payload = struct.pack('>HHH', seq, self.capacity, self.capacity - self.queued) + status
+        self.out += make_frame(PTYPE_BATCH_ACK, payload)
+
+    def read(self):
+        # each read by the host is one pass of the firmware main loop
+        if not self.batches:
+            self.idle_reads += 1
+        for _ in range(random.randint(0, self.lines_per_read)):
+            if not self.batches:
+                break
+            batch = self.batches[0]
+            line = batch[2][len(batch[3])]
+            if self.halted:
+                batch[3].append(LINE_SKIPPED)
+            else:
+                self.executed.append(line)
+                if len(self.executed) == self.fail_line:
+                    batch[3].append(LINE_ERROR)
+                    self.halted = True
+                else:
+                    batch[3].append(LINE_OK)
+            if len(batch[3]) == len(batch[2]):
+                self.batches.popleft()
+                self.queued -= batch[1]
+                self.ack(batch[0], bytes(batch[3]))
+        out, self.out = self.out, b''
+        return out
+
+
+def simulate():
+    random.seed(1)
+    program = ['G1 X%d Y%d F%d ; move %d' % (i % 97, i % 89, 1000 + i % 500, i) for i in range(5000)]
+    expected = [l.split(';')[0].strip().encode('ascii') for l in program]
+    ok = True
+
+    for capacity in (256, 1024):
+        sim = SimulatedController(capacity=capacity)
+        st = Streamer(sim, verbose=False)
+        sent = st.stream(program)
+        res = (sent == len(program) and sim.executed == expected and not st.errors and
+               st.resent == 0 and sim.max_queued <= capacity)
+        print('capacity %4d: %d lines, max buffered %d, host waited on an empty buffer %d times - %s' %
+              (capacity, sent, sim.max_queued, sim.idle_reads, 'PASS' if res else 'FAIL'))
+        ok = ok and res
+
+    # an error stops the stream, nothing after the failing line runs
+    sim = SimulatedController(capacity=1024, fail_line=1234)
+    st = Streamer(sim, verbose=False)
+    st.stream(program)
+    res = st.errors == [1234] and len(sim.executed) == 1234
+    print('error on line 1234: reported %s, executed %d - %s' % (st.errors, len(sim.executed), 'PASS' if res else 'FAIL'))
+    ok = ok and res
+
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Stream g-code with batch frames and character counting flow control.')
+    parser.add_argument('gcode_file', nargs='?', type=argparse.FileType('r'),
+            help='g-code filename to be streamed')
+    parser.add_argument('device', nargs='?',
+            help='serial device, or ip[:port] for WiFi')
+    parser.add_argument('-q', '--quiet', action='store_true', default=False,
+            help='suppress output text')
+    parser.add_argument('--simulate', action='store_true', default=False,
+            help='run against a simulated controller and check the flow control')
+    args = parser.parse_args()
+
+    if args.simulate:
+        sys.exit(0 if simulate() else 1)
+
+    if args.gcode_file is None or args.device is None:
+        parser.error('gcode_file and device are required')
+
+    if '/' in args.device or args.device.upper().startswith('COM'):
+        link = SerialLink(args.device)
+    else:
+        link = TcpLink(args.device)
+
+    st = Streamer(link, verbose=not args.quiet)
+    start = time.time()
+    try:
+        n = st.stream(args.gcode_file)
+    except KeyboardInterrupt:
+        print('Interrupted, sending abort...')
+        st.abort()
+        sys.exit(1)
+
+    if st.errors:
+        print('Stopped, error on line(s) %s' % st.errors)
+        sys.exit(1)
+    print('Streamed %d lines in %.1f s, max %d bytes in flight' % (n, time.time() - start, st.max_in_flight))
+
+
+if __name__ == '__main__':
+    main()
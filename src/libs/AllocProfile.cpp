@@ -0,0 +1,90 @@
+#include "AllocProfile.h"
+
+#include "StreamOutput.h"
+#include "platform_memory.h"
+
+#include <algorithm>
+#include <string.h>
+
+static_assert(ALLOCPROFILE_ENTRIES <= 256, "the report orders the entries by a uint8_t index");
+
+AllocProfile::entry_t *AllocProfile::entries = nullptr;
+uint32_t AllocProfile::total = 0;
+uint32_t AllocProfile::dropped = 0;
+bool AllocProfile::on = false;
+
+bool AllocProfile::start()
+{
+    on = false;
+    if (entries == nullptr) {
+        entries = (entry_t *)AHB0.alloc(sizeof(entry_t) * ALLOCPROFILE_ENTRIES);
+        if (entries == nullptr) return false;
+    }
+    memset(entries, 0, sizeof(entry_t) * ALLOCPROFILE_ENTRIES);
+    total = 0;
+    dropped = 0;
+    on = true;
+    return true;
+}
+
+void AllocProfile::stop()
+{
+    on = false;
+}
+
+void AllocProfile::record(uint32_t pc, uint32_t size)
+{
+    if (!on) return;
+    total++;
+
+    uint8_t bucket = 0;
+    while (bucket < 31 && (1UL << bucket) < size) bucket++;
+
+    // linear probing from the hash of the caller and bucket, pc 0 is an unused entry
+    uint32_t h = ((pc >> 1) * 2654435761UL + bucket) % ALLOCPROFILE_ENTRIES;
+    for (int i = 0; i < ALLOCPROFILE_ENTRIES; i++) {
+        entry_t &e = entries[h];
+        if (e.pc == 0) {
+            e.pc = pc;
+            e.bucket = bucket;
+        }
+        if (e.pc == pc && e.bucket == bucket) {
+            e.count++;
+            e.bytes += size;
+            if (size > e.max) e.max = (size > 0xFFFF) ? 0xFFFF : size;
+            return;
+        }
+        if (++h == ALLOCPROFILE_ENTRIES) h = 0;
+    }
+    dropped++;
+}
+
+void AllocProfile::report(StreamOutput *stream)
+{
+    if (entries == nullptr) {
+        stream->printf("no allocation profile, start one with alloc on\r\n");
+        return;
+    }
+
+    // printing may allocate, that would change the table under us
+    bool was_on = on;
+    on = false;
+
+    // most often first, through an index so the table stays hashed
+    uint8_t order[ALLOCPROFILE_ENTRIES];
+    int n = 0;
+    for (int i = 0; i < ALLOCPROFILE_ENTRIES; i++) {
+        if (entries[i].pc != 0) order[n++] = i;
+    }
+    std::sort(order, order + n, [](uint8_t a, uint8_t b) { return entries[a].count > entries[b].count; });
+
+    stream->printf("allocations %lu, %s\r\n", total, was_on ? "still counting" : "stopped");
+    stream->printf("        pc     count      bytes  size\r\n");
+    for (int i = 0; i < n; i++) {
+        const entry_t &e = entries[order[i]];
+        stream->printf("0x%08lX %9lu %10lu  <=%lu max %u\r\n", e.pc, e.count, e.bytes, 1UL << e.bucket, e.max);
+    }
+    if (dropped > 0) stream->printf("%lu allocations not recorded, the table was full\r\n", dropped);
+
+    on = was_on;
+}
@@ -0,0 +1,42 @@
+#ifndef _ALLOCPROFILE_H
+#define _ALLOCPROFILE_H
+
+#include <stdint.h>
+
+class StreamOutput;
+
+// Counts heap allocations by the code that made them, started, stopped and shown by the alloc command.
+// The malloc, realloc and operator new wrappers in build/mbed_custom.cpp record the return address of
+// their caller while it is on, so it works with newlib nano where HEAP_TAGS does not. Each caller and
+// power of two size has an entry in a fixed table, borrowed from AHB0 when it is first turned on and
+// found by hashing, an allocation that finds the table full is only counted as dropped.
+// alloc-symbolize.py turns the addresses in the dump into function names and lines.
+#define ALLOCPROFILE_ENTRIES 128
+
+class AllocProfile {
+    public:
+        // clears the counts and starts counting, false if there is no memory for the table
+        static bool start();
+        static void stop();
+        static bool is_on() { return on; }
+
+        // an allocation of size bytes made by the code that returns to pc
+        static void record(uint32_t pc, uint32_t size);
+        static void report(StreamOutput *stream);
+
+    private:
+        struct entry_t {
+            uint32_t pc;
+            uint32_t count;
+            uint32_t bytes;
+            uint16_t max;       // largest size seen
+            uint8_t bucket;     // sizes up to 1 << bucket
+            uint8_t reserved;
+        };
+        static entry_t *entries;
+        static uint32_t total;
+        static uint32_t dropped;
+        static bool on;
+};
+
+#endif /* _ALLOCPROFILE_H */
@@ -3,10 +3,21 @@
 
 int AppendFileStream::puts(const char *str, int size)
 {
+    int n= strlen(str);
+    pending.append(str, n);
+    if(pending.size() >= APPENDFILESTREAM_BUFFER_SIZE && !flush()) return 0;
+    return n;
+}
+
+bool AppendFileStream::flush()
+{
+    if(pending.empty()) return true;
+
     FILE *fd= fopen(this->fn, "a");
-    if(fd == NULL) return 0;
+    if(fd == NULL) return false;
 
-    int n= fwrite(str, 1, strlen(str), fd);
+    bool ok= fwrite(pending.data(), 1, pending.size(), fd) == pending.size();
     fclose(fd);
-    return n;
+    pending.clear();
+    return ok;
 }
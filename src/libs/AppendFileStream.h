@@ -5,14 +5,23 @@
 #include "string.h"
 #include "stdlib.h"
 
+#include <string>
+
+// output is gathered and appended to the file APPENDFILESTREAM_BUFFER_SIZE bytes at a time,
+// and whatever is left when the stream is deleted
+#define APPENDFILESTREAM_BUFFER_SIZE 1024
+
 class AppendFileStream : public StreamOutput {
     public:
         AppendFileStream(const char *filename) { fn= strdup(filename); }
-        virtual ~AppendFileStream(){ free(fn); }
+        virtual ~AppendFileStream(){ flush(); free(fn); }
         int puts(const char*, int size = 0);
 
     private:
+        bool flush();
+
         char *fn;
+        std::string pending;
 };
 
 #endif
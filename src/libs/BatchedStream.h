@@ -0,0 +1,75 @@
+#ifndef _BATCHEDSTREAM_H_
+#define _BATCHEDSTREAM_H_
+
+#include "StreamOutput.h"
+
+#include <algorithm>
+#include <string>
+
+// Collects output and forwards it to another stream in as few writes as possible,
+// each flush goes out in frames of at most limit bytes, which has to fit the frame payload.
+// With a limit of 0 everything is passed straight through.
+class BatchedStream : public StreamOutput {
+    public:
+        BatchedStream() : target(nullptr), limit(0) {}
+
+        void set_target(StreamOutput *stream, size_t limit)
+        {
+            flush();
+            this->target = stream;
+            this->limit = limit;
+            this->pending.reserve(limit);
+        }
+
+        int printf(const char *format, ...) __attribute__ ((format(printf, 2, 3)))
+        {
+            if (target == nullptr) return 0;
+
+            // every reply of a verbose play comes through here, M503 as well, so it is sized first and formatted in place
+            va_list args;
+            va_start(args, format);
+            int size = vsnprintf(nullptr, 0, format, args);
+            va_end(args);
+            if (size <= 0) return 0;
+
+            if (limit > 0 && pending.size() + size > limit) flush();
+            size_t at = pending.size();
+            pending.resize(at + size + 1);
+            va_start(args, format);
+            vsnprintf(&pending[at], size + 1, format, args);
+            va_end(args);
+            pending.resize(at + size);
+
+            if (limit == 0 || pending.size() > limit) flush();
+            return size;
+        }
+
+        int puts(const char *str, int size = 0)
+        {
+            if (target == nullptr) return 0;
+            size_t n = size == 0 ? strlen(str) : size;
+            if (limit > 0 && pending.size() + n > limit) flush();
+            pending.append(str, n);
+            if (limit == 0 || pending.size() > limit) flush();
+            return n;
+        }
+
+        // in frames of at most limit bytes, a single reply can be longer than that
+        void flush()
+        {
+            if (target == nullptr) return;
+            size_t step = limit > 0 ? limit : pending.size();
+            for (size_t at = 0; at < pending.size(); at += step) {
+                size_t n = std::min(step, pending.size() - at);
+                target->printf("%.*s", (int)n, pending.data() + at);
+            }
+            pending.clear();
+        }
+
+    private:
+        StreamOutput *target;
+        size_t limit;
+        std::string pending;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#include "BootProfile.h"
+
+#include "StreamOutput.h"
+#include "platform_memory.h"
+#include "us_ticker_api.h"
+
+BootProfile::entry_t *BootProfile::entries = nullptr;
+uint16_t BootProfile::count = 0;
+uint16_t BootProfile::dropped = 0;
+uint32_t BootProfile::first = 0;
+
+void BootProfile::record(const char *name, uint32_t start)
+{
+    uint32_t now = us_ticker_read();
+    if (entries == nullptr) {
+        if (count > 0 || dropped > 0) return; // tried already
+        entries = (entry_t *)AHB0.alloc(sizeof(entry_t) * BOOTPROFILE_ENTRIES);
+        if (entries == nullptr) {
+            dropped++;
+            return;
+        }
+        first = start;
+    }
+    if (count >= BOOTPROFILE_ENTRIES) {
+        dropped++;
+        return;
+    }
+
+    // nested steps end first, keep the list in the order they started
+    uint16_t i = count++;
+    while (i > 0 && (int32_t)(entries[i - 1].start - start) > 0) {
+        entries[i] = entries[i - 1];
+        i--;
+    }
+    if ((int32_t)(start - first) < 0) first = start;
+    entries[i].name = name;
+    entries[i].start = start;
+    entries[i].us = now - start;
+}
+
+void BootProfile::report(StreamOutput *stream)
+{
+    if (entries == nullptr) {
+        stream->printf("no boot profile\r\n");
+        return;
+    }
+
+    stream->printf("   start ms  took ms  step\r\n");
+    uint32_t end = first;
+    for (uint16_t i = 0; i < count; i++) {
+        const entry_t &e = entries[i];
+        stream->printf("%11.3f %8.3f  %s\r\n", (e.start - first) / 1000.0F, e.us / 1000.0F, e.name);
+        if ((int32_t)(e.start + e.us - end) > 0) end = e.start + e.us;
+    }
+    stream->printf("last step done %1.3f ms after the first started\r\n", (end - first) / 1000.0F);
+    if (dropped > 0) stream->printf("%u steps not recorded\r\n", dropped);
+}
+
+BootStep::BootStep(const char *name) : name(name), start(us_ticker_read())
+{
+}
+
+BootStep::~BootStep()
+{
+    BootProfile::record(name, start);
+}
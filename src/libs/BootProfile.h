@@ -0,0 +1,44 @@
+#ifndef _BOOTPROFILE_H
+#define _BOOTPROFILE_H
+
+#include <stdint.h>
+
+class StreamOutput;
+
+// Records how long each step of boot took, shown by the boot command.
+// A step is named by a string literal and timed with the microsecond ticker, steps may nest and
+// modules brought up from on_idle record when they are done. Times are relative to the first step,
+// which is the start of init(), so the startup code and static constructors before it are not in it.
+// The entries are borrowed from AHB0 on the first step, without them nothing is recorded.
+#define BOOTPROFILE_ENTRIES 40
+
+class BootProfile {
+    public:
+        // a step that started at start, in us_ticker_read() time, and ends now
+        static void record(const char *name, uint32_t start);
+        static void report(StreamOutput *stream);
+
+    private:
+        struct entry_t {
+            const char *name;
+            uint32_t start;
+            uint32_t us;
+        };
+        static entry_t *entries;
+        static uint16_t count;
+        static uint16_t dropped;
+        static uint32_t first;
+};
+
+// times the scope it is declared in as one step
+class BootStep {
+    public:
+        BootStep(const char *name);
+        ~BootStep();
+
+    private:
+        const char *name;
+        uint32_t start;
+};
+
+#endif /* _BOOTPROFILE_H */
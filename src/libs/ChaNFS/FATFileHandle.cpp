@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include "ff.h"
 #include "FATFileSystem.h"
+#include "platform_memory.h"
 
 namespace mbed {
 
@@ -32,11 +33,22 @@ static const char *FR_ERRORS[] = {
 
 FATFileHandle::FATFileHandle(FIL_t fh) {
     _fh = fh;
+    _cltbl = NULL;
+    _written = fh.fsize;
 }
     
 int FATFileHandle::close() {
     FFSDEBUG("close\n");
+    if(_fh.fsize > _written) {
+        // give back what was reserved and not written
+        if(f_lseek(&_fh, _written) == FR_OK) {
+            f_truncate(&_fh);
+        }
+    }
     int retval = f_close(&_fh);
+    if(_cltbl) {
+        AHB0.dealloc(_cltbl);
+    }
     delete this;
     return retval;
 }
@@ -49,6 +61,9 @@ ssize_t FATFileHandle::write(const void* buffer, size_t length) {
         FFSDEBUG("f_write() failed (%d, %s)", res, FR_ERRORS[res]);
         return -1;
     }
+    if(_fh.fptr > _written) {
+        _written = _fh.fptr;
+    }
     return n;
 }
         
@@ -70,7 +85,7 @@ int FATFileHandle::isatty() {
 off_t FATFileHandle::lseek(off_t position, int whence) {
     FFSDEBUG("lseek(%i,%i)\n",position,whence);
     if(whence == SEEK_END) {
-        position += _fh.fsize;
+        position += _written;
     } else if(whence==SEEK_CUR) {
         position += _fh.fptr;
     }
@@ -96,7 +111,42 @@ int FATFileHandle::fsync() {
 
 off_t FATFileHandle::flen() {
     FFSDEBUG("flen\n");
-    return _fh.fsize;
+    return _written;
+}
+
+bool FATFileHandle::fastseek() {
+    DWORD csize = (DWORD)_fh.fs->csize * 512;
+    if(_cltbl || _fh.fsize <= FASTSEEK_MIN_CLUSTERS * csize) {
+        return _cltbl != NULL;
+    }
+
+    // first try a table for a few fragments, that will do for most files
+    DWORD size = FASTSEEK_TABLE_SIZE;
+    for(;;) {
+        _cltbl = (DWORD *)AHB0.alloc(size * sizeof(DWORD));
+        if(_cltbl == NULL) {
+            break;
+        }
+        _cltbl[0] = size;
+        _fh.cltbl = _cltbl;
+        FRESULT res = f_lseek(&_fh, CREATE_LINKMAP);
+        if(res == FR_OK) {
+            FFSDEBUG("fastseek, %d of %d entries\n", _cltbl[0], size);
+            return true;
+        }
+
+        // on FR_NOT_ENOUGH_CORE the first entry is the size the file needs
+        DWORD needed = _cltbl[0];
+        _fh.cltbl = 0;
+        AHB0.dealloc(_cltbl);
+        _cltbl = NULL;
+        if(res != FR_NOT_ENOUGH_CORE || needed > FASTSEEK_TABLE_MAX || needed <= size) {
+            FFSDEBUG("fastseek failed (%d)\n", res);
+            break;
+        }
+        size = needed;
+    }
+    return false;
 }
 
 } // namespace mbed
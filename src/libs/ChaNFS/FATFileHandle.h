@@ -8,6 +8,19 @@
 #include "FileHandle.h"
 #include "ff.h"
 
+/* Read only files longer than FASTSEEK_MIN_CLUSTERS get a cluster link map table in AHB0 so
+ * seeks do not follow the FAT chain from the start. The table starts at FASTSEEK_TABLE_SIZE
+ * entries and is grown to what the file needs, up to FASTSEEK_TABLE_MAX (two per fragment),
+ * files more fragmented than that seek the normal way.
+ */
+#define FASTSEEK_MIN_CLUSTERS 4
+#define FASTSEEK_TABLE_SIZE   32
+#define FASTSEEK_TABLE_MAX    256
+
+/* Seeking past the end of a file open for writing allocates the clusters up to there, as a
+ * reservation, but like POSIX the file only grows by what is written, the rest is cut off on close.
+ */
+
 namespace mbed {
 
 class FATFileHandle : public FileHandle {
@@ -22,9 +35,14 @@ public:
     virtual int fsync();
     virtual off_t flen();
 
+    /* Build the link map table, returns false if the file seeks the normal way */
+    bool fastseek();
+
 protected:
 
     FIL_t _fh;
+    DWORD *_cltbl;
+    DWORD _written;    // end of the data, a seek past it grows the FatFs file without writing anything
 
 };
 
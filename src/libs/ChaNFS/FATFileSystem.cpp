@@ -109,7 +109,11 @@ FileHandle *FATFileSystem::open(const char* name, int flags) {
     if(flags & O_APPEND) {
         f_lseek(&fh, fh.fsize);
     }
-    return new FATFileHandle(fh);
+    FATFileHandle *handle = new FATFileHandle(fh);
+    if(openmode == FA_READ) {
+        handle->fastseek();
+    }
+    return handle;
 }
 
 int FATFileSystem::remove(const char *filename) {
@@ -0,0 +1,162 @@
+#include "CommandBatch.h"
+
+#include "Kernel.h"
+#include "Conveyor.h"
+#include "PublicData.h"
+#include "SerialMessage.h"
+#include "InputScheduler.h"
+
+#define BATCH_LINES_PER_PASS 16
+
+int CommandBatch::ReplyStream::printf(const char *format, ...)
+{
+    char b[64];
+    char *buffer;
+    va_list args;
+    va_start(args, format);
+    int size = vsnprintf(b, 64, format, args) + 1;
+    va_end(args);
+
+    if (size < 64) {
+        buffer = b;
+    } else {
+        buffer = new char[size];
+        va_start(args, format);
+        vsnprintf(buffer, size, format, args);
+        va_end(args);
+    }
+
+    puts(buffer, size - 1);
+
+    if (buffer != b)
+        delete[] buffer;
+
+    return size - 1;
+}
+
+int CommandBatch::ReplyStream::puts(const char *buf, int size)
+{
+    size_t n = size == 0 ? strlen(buf) : size;
+
+    // a plain ok, with or without its line end
+    if (n >= 2 && strncmp(buf, "ok", 2) == 0) {
+        size_t i = 2;
+        while (i < n && (buf[i] == '\r' || buf[i] == '\n')) i++;
+        if (i == n) return n;
+    }
+
+    // the same tests a host applies to the replies of a single line
+    if (strncmp(buf, "error", 5) == 0 || strncmp(buf, "Error", 5) == 0 ||
+        strncmp(buf, "!!", 2) == 0 || strncmp(buf, "ALARM", 5) == 0) {
+        error = true;
+    }
+    return target->puts(buf, n);
+}
+
+void CommandBatch::add(const uint8_t *payload, uint16_t len)
+{
+    if (len < 2) return;
+
+    batch_t batch;
+    batch.seq = (payload[0] << 8) | payload[1];
+    batch.lines.assign((const char *)&payload[2], len - 2);
+    batch.pos = 0;
+
+    if (batch.lines.empty()) {
+        send_ack(batch);
+        return;
+    }
+
+    if (queued_bytes + batch.lines.size() > BATCH_BUFFER_SIZE) {
+        // count the lines so the host knows exactly what was not run
+        size_t n = 0;
+        for (size_t i = 0; i < batch.lines.size(); ++i) {
+            if (batch.lines[i] == '\n' || i == batch.lines.size() - 1) n++;
+        }
+        batch.status.assign(n, BATCH_LINE_SKIPPED);
+        send_ack(batch);
+        return;
+    }
+
+    batch.status.reserve(32);
+    queued_bytes += batch.lines.size();
+    batches.push_back(batch);
+}
+
+void CommandBatch::send_ack(const batch_t& batch)
+{
+    size_t free = BATCH_BUFFER_SIZE - queued_bytes;
+    std::string ack;
+    ack.reserve(batch.status.size() + 6);
+    ack.push_back((batch.seq >> 8) & 0xFF);
+    ack.push_back(batch.seq & 0xFF);
+    ack.push_back((BATCH_BUFFER_SIZE >> 8) & 0xFF);
+    ack.push_back(BATCH_BUFFER_SIZE & 0xFF);
+    ack.push_back((free >> 8) & 0xFF);
+    ack.push_back(free & 0xFF);
+    ack.append(batch.status);
+    stream->PacketMessage(PTYPE_BATCH_ACK, ack.data(), ack.size());
+}
+
+// everything still queued is acked as skipped, after a halt nothing queued before it may run
+void CommandBatch::skip_all()
+{
+    while (!batches.empty()) {
+        batch_t& batch = batches.front();
+        while (batch.pos < batch.lines.size()) {
+            size_t end = batch.lines.find('\n', batch.pos);
+            batch.pos = (end == std::string::npos) ? batch.lines.size() : end + 1;
+            batch.status.push_back(BATCH_LINE_SKIPPED);
+        }
+        queued_bytes -= batch.lines.size();
+        send_ack(batch);
+        batches.pop_front();
+    }
+}
+
+void CommandBatch::dispatch(uint8_t source)
+{
+    if (batches.empty()) return;
+
+    if (THEKERNEL->is_halted()) {
+        skip_all();
+        return;
+    }
+
+    for (int n = 0; n < BATCH_LINES_PER_PASS && !batches.empty() && !THECONVEYOR->is_queue_full(); ++n) {
+        // not inside a running line nor while held, and a waiting jog goes first
+        if (!THEKERNEL->input->may_run() || THEKERNEL->input->should_yield(source, INPUT_STREAM)) break;
+
+        batch_t& batch = batches.front();
+
+        size_t end = batch.lines.find('\n', batch.pos);
+        if (end == std::string::npos) end = batch.lines.size();
+        size_t len = end - batch.pos;
+        if (len > 0 && batch.lines[end - 1] == '\r') len--;
+
+        if (len > 0) {
+            struct SerialMessage message;
+            message.message = batch.lines.substr(batch.pos, len);
+            message.stream = &reply;
+            message.line = 0;
+            reply.error = false;
+            THEKERNEL->input->execute(source, message);
+            batch.status.push_back(reply.error ? BATCH_LINE_ERROR : BATCH_LINE_OK);
+        } else {
+            // blank lines still get their status so the indices line up
+            batch.status.push_back(BATCH_LINE_OK);
+        }
+        batch.pos = end + 1;
+
+        if (batch.pos >= batch.lines.size()) {
+            queued_bytes -= batch.lines.size();
+            send_ack(batch);
+            batches.pop_front();
+        }
+
+        if (THEKERNEL->is_halted()) {
+            skip_all();
+            break;
+        }
+    }
+}
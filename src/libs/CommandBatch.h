@@ -0,0 +1,67 @@
+#ifndef _COMMANDBATCH_H
+#define _COMMANDBATCH_H
+
+#include "StreamOutput.h"
+
+#include <stdint.h>
+#include <deque>
+#include <string>
+
+// Runs PTYPE_CTRL_BATCH frames: many newline separated console lines in one frame.
+// Lines are dispatched from on_main_loop only while the planner has room, so a batch never blocks the
+// receive path. They run through the InputScheduler as lines of the stream's source, so like any other
+// line they never start inside a running one, wait while it is held and give way to a waiting jog.
+// The plain "ok" of each line is dropped, anything else a line prints is passed on.
+// When every line of a batch has run a single PTYPE_BATCH_ACK goes back with
+//   [seq 2][capacity 2][free 2][one status byte per line, BATCH_LINE_OK, _ERROR or _SKIPPED]
+// Lines are skipped once the machine halts.
+//
+// Flow control is by character counting as in Grbl: batches are held in a buffer of
+// BATCH_BUFFER_SIZE bytes of line text and the host keeps the text of all unacked batches within
+// the advertised capacity, so the buffer stays full without waiting for each ack. An empty batch
+// is acked straight away and tells the host the capacity before it starts. A batch that does not
+// fit is acked straight away with every line skipped so the host can send it again.
+#define BATCH_BUFFER_SIZE 1024
+#define BATCH_LINE_OK      '0'
+#define BATCH_LINE_ERROR   '1'
+#define BATCH_LINE_SKIPPED '2'
+
+class CommandBatch {
+    public:
+        CommandBatch(StreamOutput *stream) : reply(stream), stream(stream), queued_bytes(0) {}
+
+        void add(const uint8_t *payload, uint16_t len);
+        // source is the stream's InputScheduler source
+        void dispatch(uint8_t source);
+        bool empty() const { return batches.empty(); }
+
+    private:
+        struct batch_t {
+            uint16_t seq;
+            std::string lines;
+            size_t pos;
+            std::string status;
+        };
+
+        // passes the output of a line on to the console stream but its "ok", the batch ack stands in for
+        // those, and notes if the line reported an error
+        class ReplyStream : public StreamOutput {
+            public:
+                ReplyStream(StreamOutput *target) : target(target), error(false) {}
+                int printf(const char *format, ...) __attribute__ ((format(printf, 2, 3)));
+                int puts(const char *buf, int size = 0);
+                int type() { return target->type(); }
+                StreamOutput *target;
+                bool error;
+        };
+
+        void send_ack(const batch_t& batch);
+        void skip_all();
+
+        std::deque<batch_t> batches;
+        ReplyStream reply;
+        StreamOutput *stream;
+        size_t queued_bytes;
+};
+
+#endif /* _COMMANDBATCH_H */
@@ -20,6 +20,7 @@ using namespace std;
 #include "libs/ConfigSources/FileConfigSource.h"
 #include "libs/ConfigSources/FirmConfigSource.h"
 #include "StreamOutputPool.h"
+#include "ConfigImage.h"
 
 // Add various config sources. Config can be fetched from several places.
 // All values are read into a cache, that is then used by modules to read their configuration
@@ -76,9 +77,21 @@ void Config::config_cache_load(bool parse)
 
     this->config_cache= new ConfigCache;
     if(parse) {
-        // For each ConfigSource in our stack
+        // what the sources depend on apart from their files, the image checks those
+        uint32_t sum = 1;
         for( ConfigSource *source : this->config_sources ) {
-            source->transfer_values_to_cache(this->config_cache);
+            sum = source->stamp(sum);
+        }
+
+        if(!ConfigImage::load(this->config_cache, sum)) {
+            // For each ConfigSource in our stack
+            for(size_t i = 0; i < this->config_sources.size(); i++) {
+                size_t from = this->config_cache->size();
+                this->config_sources[i]->transfer_values_to_cache(this->config_cache);
+                this->config_cache->set_source(from, i);
+            }
+            this->config_cache->sort();
+            ConfigImage::save(this->config_cache, sum);
         }
     }
 }
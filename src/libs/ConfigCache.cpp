@@ -3,6 +3,22 @@
 
 #include "libs/StreamOutput.h"
 
+#include <algorithm>
+#include <string.h>
+
+// by family first, so all the values of a module family are next to each other
+bool ConfigCache::less(const ConfigValue *a, const ConfigValue *b)
+{
+    if(a->check_sums[0] != b->check_sums[0]) return a->check_sums[0] < b->check_sums[0];
+    if(a->check_sums[1] != b->check_sums[1]) return a->check_sums[1] < b->check_sums[1];
+    return a->check_sums[2] < b->check_sums[2];
+}
+
+bool ConfigCache::less_family(const ConfigValue *a, uint16_t family)
+{
+    return a->check_sums[0] < family;
+}
+
 ConfigCache::ConfigCache()
 {
 }
@@ -19,44 +35,66 @@ void ConfigCache::clear()
     }
     store.clear();
     storage_t().swap(store);   //  makes sure the vector releases its memory
+    vector<string>().swap(files);
+    sorted = false;
 }
 
 void ConfigCache::add(ConfigValue *v)
 {
     store.push_back(v);
+    sorted = false;
 }
 
-void ConfigCache::pop()
+void ConfigCache::sort()
 {
-    auto cv= store.back();
-    store.pop_back();
-    delete cv;
-}
+    if(sorted) return;
 
-// If we find an existing value, replace it, otherwise, push it at the back of the list
-void ConfigCache::replace_or_push_back(ConfigValue *new_value)
-{
-    // For each already existing element
-    for(auto &cv : store) {
-        // If this configvalue matches the checksum
-        if(memcmp(new_value->check_sums, cv->check_sums, sizeof(cv->check_sums)) == 0) {
-            // Replace with the provided value
-            delete cv; // free up old one
-            cv =  new_value;
+    // stable, so of duplicates the one read last is last
+    std::stable_sort(store.begin(), store.end(), less);
+
+    auto out = store.begin();
+    for(auto i = store.begin(); i != store.end(); ++i) {
+        if(i + 1 != store.end() && !less(*i, *(i + 1))) {
+            // Replace with the value that follows
+            delete *i;
             printf("WARNING: duplicate config line replaced\n");
-            return;
+            continue;
         }
+        *out++ = *i;
     }
+    store.erase(out, store.end());
+    sorted = true;
+}
 
-    // Value does not already exists, add to the list
-    store.push_back(new_value);
+void ConfigCache::set_source(size_t from, uint8_t source)
+{
+    for(size_t i = from; i < store.size(); i++) {
+        store[i]->source = source;
+    }
+}
+
+void ConfigCache::pop()
+{
+    auto cv= store.back();
+    store.pop_back();
+    delete cv;
 }
 
 ConfigValue *ConfigCache::lookup(const uint16_t *check_sums) const
 {
-    for( auto &cv : store) {
-        if(memcmp(check_sums, cv->check_sums, sizeof(cv->check_sums)) == 0)
-            return cv;
+    if(sorted) {
+        ConfigValue key;
+        memcpy(key.check_sums, check_sums, sizeof(key.check_sums));
+        auto i = std::lower_bound(store.begin(), store.end(), &key, less);
+        if(i != store.end() && memcmp(check_sums, (*i)->check_sums, sizeof(key.check_sums)) == 0)
+            return *i;
+        return NULL;
+    }
+
+    // the last one added is the one sort would keep
+    for(auto i = store.rbegin(); i != store.rend(); ++i) {
+        if(memcmp(check_sums, (*i)->check_sums, sizeof((*i)->check_sums)) == 0)
+            return *i;
     }
 
     return NULL;
@@ -64,6 +102,14 @@ ConfigValue *ConfigCache::lookup(const uint16_t *check_sums) const
 
 void ConfigCache::collect(uint16_t family, uint16_t cs, vector<uint16_t> *list)
 {
+    if(sorted) {
+        // only look at the family
+        for(auto i = std::lower_bound(store.begin(), store.end(), family, less_family); i != store.end() && (*i)->check_sums[0] == family; ++i) {
+            if((*i)->check_sums[2] == cs) list->push_back((*i)->check_sums[1]);
+        }
+        return;
+    }
+
     for( auto &kv : store ) {
         if( kv->check_sums[2] == cs && kv->check_sums[0] == family ) {
             // We found a module enable for this family, add it's number
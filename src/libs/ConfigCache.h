@@ -10,6 +10,7 @@
 
 using namespace std;
 #include <vector>
+#include <string>
 #include <stdint.h>
 #include <map>
 
@@ -31,15 +32,30 @@ class ConfigCache {
         // collect enabled checksums of the given family
         void collect(uint16_t family, uint16_t cs, vector<uint16_t> *list);
 
-        // If we find an existing value, replace it, otherwise, push it at the back of the list
-        void replace_or_push_back(ConfigValue* new_value);
-
         // used for debugging, dumps the cache to a stream
         void dump(StreamOutput *stream);
 
+        // orders the values by checksums so lookup and collect can do a binary search, until something is added
+        // of values added more than once only the last one is kept
+        void sort();
+        size_t size() const { return store.size(); }
+
+        // marks the values added since the cache had from values as read from the given source
+        void set_source(size_t from, uint8_t source);
+
+        // the config files the values were read from, they decide whether a saved image is still current
+        void add_file(const string& file_name) { files.push_back(file_name); }
+
+        friend class ConfigImage;
+
     private:
+        static bool less(const ConfigValue *a, const ConfigValue *b);
+        static bool less_family(const ConfigValue *a, uint16_t family);
+
         typedef vector<ConfigValue*> storage_t;
         storage_t store;
+        vector<string> files;
+        bool sorted{false};
 };
 
 
@@ -0,0 +1,297 @@
+#include "ConfigImage.h"
+
+#include "ConfigCache.h"
+#include "ConfigValue.h"
+#include "FileHash.h"
+#include "DirHandle.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+
+#define CONFIG_IMAGE_MAGIC    0x49474643 // "CFGI"
+#define CONFIG_IMAGE_VERSION  2
+#define CONFIG_IMAGE_MAX_SIZE 0x10000
+
+struct image_header_t {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t files;     // the config file names follow the header, each ends with a 0
+    uint32_t count;     // then the index, count image_value_t sorted by checksums
+    uint32_t index;     // where the index starts
+    uint32_t sources;   // the stamp of the sources alone
+    uint32_t stamp;     // and with their files
+    uint32_t size;      // of everything after the header, all offsets are from there
+};
+
+struct image_value_t {
+    uint16_t check_sums[3];
+    uint16_t source;
+    uint32_t offset;
+    uint16_t len;
+    uint16_t reserved;
+};
+
+// folds the name, size and date of a file into sum, false if it is not there
+static bool stamp_file(const std::string& path, uint32_t& sum)
+{
+    size_t slash = path.find_last_of('/');
+    if(slash == std::string::npos) return false;
+    std::string dir = (slash == 0) ? "/" : path.substr(0, slash);
+    const char *name = path.c_str() + slash + 1;
+
+    DIR *d = opendir(dir.c_str());
+    if(d == NULL) return false;
+
+    bool found = false;
+    struct dirent *p;
+    while((p = readdir(d)) != NULL) {
+        if(strcasecmp(p->d_name, name) != 0) continue;
+        uint32_t info[3] = { p->d_fsize, p->d_date, p->d_time };
+        sum = adler32((const uint8_t *)path.c_str(), path.size() + 1, sum);
+        sum = adler32((const uint8_t *)info, sizeof(info), sum);
+        found = true;
+        break;
+    }
+    closedir(d);
+    return found;
+}
+
+static int compare(const uint16_t *a, const uint16_t *b)
+{
+    for(int i = 0; i < 3; i++) {
+        if(a[i] != b[i]) return (a[i] < b[i]) ? -1 : 1;
+    }
+    return 0;
+}
+
+// reads the header of an open image and checks the files it was made from are unchanged, which sum is then the stamp of
+static bool read_header(FILE *fp, image_header_t& h, uint32_t& sum)
+{
+    if(fread(&h, 1, sizeof(h), fp) != sizeof(h) || h.magic != CONFIG_IMAGE_MAGIC || h.version != CONFIG_IMAGE_VERSION || h.size > CONFIG_IMAGE_MAX_SIZE) {
+        return false;
+    }
+
+    sum = h.sources;
+    std::string name;
+    for(uint16_t i = 0; i < h.files; i++) {
+        name.clear();
+        int c;
+        while((c = fgetc(fp)) > 0) name.push_back(c);
+        if(c != 0 || !stamp_file(name, sum)) return false;
+    }
+    return true;
+}
+
+// binary search of the index of an open image, the record found is left in v and its position returned,
+// 0 if there is none and -1 if the image could not be read
+static long find(FILE *fp, const image_header_t& h, const uint16_t *check_sums, image_value_t& v)
+{
+    uint32_t lo = 0, hi = h.count;
+    while(lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        long pos = sizeof(h) + h.index + mid * sizeof(v);
+        if(fseek(fp, pos, SEEK_SET) != 0 || fread(&v, 1, sizeof(v), fp) != sizeof(v)) return -1;
+        int c = compare(check_sums, v.check_sums);
+        if(c == 0) return pos;
+        if(c < 0) hi = mid;
+        else lo = mid + 1;
+    }
+    return 0;
+}
+
+bool ConfigImage::load(ConfigCache *cache, uint32_t sum)
+{
+    FILE *fp = fopen(CONFIG_IMAGE_FILE, "rb");
+    if(fp == NULL) return false;
+    setvbuf(fp, NULL, _IONBF, 0);
+
+    image_header_t h;
+    if(fread(&h, 1, sizeof(h), fp) != sizeof(h) || h.magic != CONFIG_IMAGE_MAGIC || h.version != CONFIG_IMAGE_VERSION || h.size > CONFIG_IMAGE_MAX_SIZE || h.sources != sum) {
+        fclose(fp);
+        return false;
+    }
+
+    char *buf = (char *)malloc(h.size);
+    if(buf == NULL) {
+        fclose(fp);
+        return false;
+    }
+    bool ok = fread(buf, 1, h.size, fp) == h.size && h.index <= h.size && h.count <= (h.size - h.index) / sizeof(image_value_t);
+    fclose(fp);
+
+    // the files the values came from must not have changed since
+    const char *p = buf, *end = buf + h.index;
+    for(uint16_t i = 0; ok && i < h.files; i++) {
+        const char *eos = (const char *)memchr(p, 0, end - p);
+        ok = eos != NULL && stamp_file(std::string(p, eos - p), sum);
+        if(ok) cache->add_file(std::string(p, eos - p));
+        p = ok ? eos + 1 : end;
+    }
+    ok = ok && sum == h.stamp;
+
+    bool in_order = true;
+    for(uint32_t i = 0; ok && i < h.count; i++) {
+        image_value_t v;
+        memcpy(&v, buf + h.index + i * sizeof(v), sizeof(v));
+        if(v.offset > h.size || h.size - v.offset < v.len) { ok = false; break; }
+
+        ConfigValue *cv = new ConfigValue;
+        memcpy(cv->check_sums, v.check_sums, sizeof(v.check_sums));
+        cv->found = true;
+        cv->source = v.source;
+        cv->value.assign(buf + v.offset, v.len);
+        if(!cache->store.empty() && !ConfigCache::less(cache->store.back(), cv)) in_order = false;
+        cache->store.push_back(cv);
+    }
+    free(buf);
+
+    if(!ok) {
+        cache->clear();
+        return false;
+    }
+    if(in_order) cache->sorted = true;
+    else cache->sort();
+    return true;
+}
+
+bool ConfigImage::save(const ConfigCache *cache, uint32_t sum)
+{
+    image_header_t h;
+    h.magic = CONFIG_IMAGE_MAGIC;
+    h.version = CONFIG_IMAGE_VERSION;
+    h.files = cache->files.size();
+    h.count = cache->store.size();
+    h.sources = sum;
+    h.index = 0;
+
+    for(auto &f : cache->files) {
+        if(!stamp_file(f, sum)) return false;
+        h.index += f.size() + 1;
+    }
+    h.stamp = sum;
+    h.size = h.index + h.count * sizeof(image_value_t);
+    for(auto &cv : cache->store) {
+        h.size += cv->value.size();
+    }
+    if(h.size > CONFIG_IMAGE_MAX_SIZE) return false;
+
+    FILE *fp = fopen(CONFIG_IMAGE_FILE, "wb");
+    if(fp == NULL) return false;
+
+    bool ok = fwrite(&h, 1, sizeof(h), fp) == sizeof(h);
+    for(auto &f : cache->files) {
+        ok = ok && fwrite(f.c_str(), 1, f.size() + 1, fp) == f.size() + 1;
+    }
+    uint32_t offset = h.index + h.count * sizeof(image_value_t);
+    for(auto &cv : cache->store) {
+        image_value_t v;
+        memcpy(v.check_sums, cv->check_sums, sizeof(v.check_sums));
+        v.source = cv->source;
+        v.offset = offset;
+        v.len = cv->value.size();
+        v.reserved = 0;
+        offset += v.len;
+        ok = ok && fwrite(&v, 1, sizeof(v), fp) == sizeof(v);
+    }
+    for(auto &cv : cache->store) {
+        ok = ok && fwrite(cv->value.data(), 1, cv->value.size(), fp) == cv->value.size();
+    }
+    fclose(fp);
+
+    if(!ok) ::remove(CONFIG_IMAGE_FILE);
+    return ok;
+}
+
+void ConfigImage::remove()
+{
+    ::remove(CONFIG_IMAGE_FILE);
+}
+
+bool ConfigImage::is_current()
+{
+    FILE *fp = fopen(CONFIG_IMAGE_FILE, "rb");
+    if(fp == NULL) return false;
+
+    image_header_t h;
+    uint32_t sum;
+    bool ok = read_header(fp, h, sum) && sum == h.stamp;
+    fclose(fp);
+    return ok;
+}
+
+bool ConfigImage::get(const uint16_t *check_sums, bool& found, std::string& value, uint8_t& source)
+{
+    FILE *fp = fopen(CONFIG_IMAGE_FILE, "rb");
+    if(fp == NULL) return false;
+
+    image_header_t h;
+    uint32_t sum;
+    if(!read_header(fp, h, sum) || sum != h.stamp) {
+        fclose(fp);
+        return false;
+    }
+
+    image_value_t v;
+    long pos = find(fp, h, check_sums, v);
+    bool ok = pos >= 0;
+    found = pos > 0;
+    if(found) {
+        value.resize(v.len);
+        source = v.source;
+        ok = v.len == 0 || (fseek(fp, sizeof(h) + v.offset, SEEK_SET) == 0 && fread(&value[0], 1, v.len, fp) == v.len);
+    }
+    fclose(fp);
+    return ok;
+}
+
+bool ConfigImage::update(uint8_t source, const std::vector<ConfigSetting>& settings)
+{
+    FILE *fp = fopen(CONFIG_IMAGE_FILE, "r+b");
+    if(fp == NULL) return false;
+
+    // the config files have changed, the stamp is what they are now
+    image_header_t h;
+    uint32_t sum;
+    bool ok = read_header(fp, h, sum);
+    h.stamp = sum;
+
+    for(auto &s : settings) {
+        if(!ok) break;
+        if(!s.written) continue;
+
+        uint16_t check_sums[3];
+        get_checksums(check_sums, s.key);
+        image_value_t v;
+        long pos = find(fp, h, check_sums, v);
+        if(pos <= 0 || s.value.size() > 0xFFFF) {
+            // a new key would have to be inserted in the index, the image is made again on next boot
+            ok = false;
+            break;
+        }
+        if(v.source > source) continue; // overridden by a later source
+
+        if(s.value.size() > v.len) {
+            // does not fit where the old value was, goes at the end
+            if(h.size + s.value.size() > CONFIG_IMAGE_MAX_SIZE) {
+                ok = false;
+                break;
+            }
+            v.offset = h.size;
+            h.size += s.value.size();
+        }
+        v.len = s.value.size();
+        v.source = source;
+        ok = fseek(fp, sizeof(h) + v.offset, SEEK_SET) == 0 && fwrite(s.value.data(), 1, v.len, fp) == v.len &&
+             fseek(fp, pos, SEEK_SET) == 0 && fwrite(&v, 1, sizeof(v), fp) == sizeof(v);
+    }
+
+    ok = ok && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&h, 1, sizeof(h), fp) == sizeof(h);
+    fclose(fp);
+
+    if(!ok) ::remove(CONFIG_IMAGE_FILE);
+    return ok;
+}
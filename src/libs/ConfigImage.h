@@ -0,0 +1,37 @@
+#ifndef _CONFIGIMAGE_H
+#define _CONFIGIMAGE_H
+
+#include "ConfigSource.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class ConfigCache;
+
+// The parsed configuration saved to the sd card, so boot does not have to parse the text files again.
+// The image holds the config files the values were read from, a stamp and an index of the values sorted
+// by checksums, each with the source it came from. The stamp is an adler32 over what the sources depend
+// on and the name, size and date of each of those files, the image is only used while it still matches.
+// Boot reads it in one go, after boot single values are looked up in it with a binary search on the card,
+// and writes through config-set are applied to it so it stays current.
+#define CONFIG_IMAGE_FILE "/sd/.config.bin"
+
+class ConfigImage {
+    public:
+        // fills the empty cache from the image if it is current for the sources stamped into sum
+        static bool load(ConfigCache *cache, uint32_t sum);
+        // saves the sorted cache for the sources stamped into sum
+        static bool save(const ConfigCache *cache, uint32_t sum);
+        // the config files were changed by us, parse them again next time
+        static void remove();
+
+        // whether the config files are still what the image was made from
+        static bool is_current();
+        // looks a value up, false if the image can not tell
+        static bool get(const uint16_t *check_sums, bool& found, std::string& value, uint8_t& source);
+        // applies settings just written to a source that was current before, false if the image had to be removed
+        static bool update(uint8_t source, const std::vector<ConfigSetting>& settings);
+};
+
+#endif /* _CONFIGIMAGE_H */
@@ -2,6 +2,7 @@
 #include "ConfigSource.h"
 #include "ConfigValue.h"
 #include "ConfigCache.h"
+#include "FileHash.h"
 
 #include "stdio.h"
 
@@ -52,8 +53,8 @@ ConfigValue* ConfigSource::process_line_from_ascii_config(const string &buffer,
 {
     ConfigValue *result = process_line(buffer);
     if(result != NULL) {
-        // Append the newly found value to the cache we were passed
-        cache->replace_or_push_back(result);
+        // Append the newly found value to the cache we were passed, a later duplicate replaces it when the cache is sorted
+        cache->add(result);
         return result;
     }
     return NULL;
@@ -71,3 +72,15 @@ string ConfigSource::process_line_from_ascii_config(const string &buffer, uint16
     }
     return value;
 }
+
+void ConfigSource::write_all(std::vector<ConfigSetting>& settings)
+{
+    for(auto &s : settings) {
+        s.written = this->write(s.key, s.value);
+    }
+}
+
+uint32_t ConfigSource::stamp(uint32_t sum)
+{
+    return adler32((const uint8_t *)&this->name_checksum, sizeof(this->name_checksum), sum);
+}
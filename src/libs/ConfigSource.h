@@ -9,10 +9,20 @@
 #define CONFIGSOURCE_H
 
 #include <string>
+#include <vector>
+#include <stdint.h>
 
 class ConfigValue;
 class ConfigCache;
 
+// One setting of a batch written to a source, written tells whether the source took it
+struct ConfigSetting {
+    ConfigSetting(const std::string& key, const std::string& value) : key(key), value(value), written(false) {}
+    std::string key;
+    std::string value;
+    bool written;
+};
+
 class ConfigSource {
     public:
         ConfigSource(){}
@@ -22,7 +32,11 @@ class ConfigSource {
         virtual void transfer_values_to_cache( ConfigCache* ) = 0;
         virtual bool is_named( uint16_t check_sum ) = 0;
         virtual bool write( std::string setting, std::string value ) = 0;
+        // writes several settings, sources that can should do it in one pass over their file
+        virtual void write_all( std::vector<ConfigSetting>& settings );
         virtual std::string read( uint16_t check_sums[3] ) = 0;
+        // folds what the values depend on, apart from the files they were read from, into an adler32 sum
+        virtual uint32_t stamp( uint32_t sum );
 
     protected:
         virtual ConfigValue* process_line_from_ascii_config(const std::string& line, ConfigCache* cache);
@@ -11,6 +11,7 @@
 #include "ConfigCache.h"
 #include "checksumm.h"
 #include "utils.h"
+#include "FileHash.h"
 #include <malloc.h>
 
 using namespace std;
@@ -66,6 +67,7 @@ void FileConfigSource::transfer_values_to_cache( ConfigCache *cache, const char
 
     // Open the config file ( find it if we haven't already found it )
     FILE *lp = fopen(file_name, "r");
+    cache->add_file(file_name);
 
     int ln= 1;
     // For each line
@@ -120,6 +122,14 @@ void FileConfigSource::transfer_values_to_cache( ConfigCache *cache, const char
     fclose(lp);
 }
 
+// Which file is used, its contents and those of its includes are checked by ConfigImage
+uint32_t FileConfigSource::stamp( uint32_t sum )
+{
+    sum = ConfigSource::stamp(sum);
+    string file = this->has_config_file() ? this->config_file : "";
+    return adler32((const uint8_t *)file.c_str(), file.size() + 1, sum);
+}
+
 // Return true if the check_sums match
 bool FileConfigSource::is_named( uint16_t check_sum )
 {
@@ -128,57 +138,78 @@ bool FileConfigSource::is_named( uint16_t check_sum )
 
 // OverWrite or append a config setting to the file
 bool FileConfigSource::write( string setting, string value )
+{
+    vector<ConfigSetting> settings;
+    settings.push_back(ConfigSetting(setting, value));
+    this->write_all(settings);
+    return settings[0].written;
+}
+
+// OverWrite or append several config settings in one pass over the file
+void FileConfigSource::write_all( vector<ConfigSetting>& settings )
 {
     if( !this->has_config_file() ) {
-        return false;
+        return;
     }
 
-    uint16_t setting_checksums[3];
-    get_checksums(setting_checksums, setting );
+    vector<bool> done(settings.size(), false);
+    size_t left = settings.size();
+    uint16_t (*setting_checksums)[3] = new uint16_t[settings.size()][3];
+    for(size_t i = 0; i < settings.size(); i++) {
+        get_checksums(setting_checksums[i], settings[i].key );
+    }
 
     // Open the config file ( find it if we haven't already found it )
     FILE *lp = fopen(this->get_config_file().c_str(), "r+");
 
     // search each line for a match
-    while(!feof(lp)) {
+    while(left > 0 && !feof(lp)) {
         string line;
-        fpos_t bol, eol;
-        fgetpos( lp, &bol ); // get start of line
-        if(readLine(line, 0, lp)) {
-            fgetpos( lp, &eol ); // get end of line
-            if(!process_line_from_ascii_config(line, setting_checksums).empty()) {
-                // found it
-                unsigned int free_space = eol - bol - 4; // length of line
-                // check we have enough space for this insertion
-                if( (setting.length() + value.length() + 3) > free_space ) {
-                    //THEKERNEL->streams->printf("ERROR: Not enough room for value\r\n");
-                    fclose(lp);
-                    return false;
-                }
-
-                // Update line, leaves whatever was at end of line there just overwrites the key and value
-                fseek(lp, bol, SEEK_SET);
-                fputs(setting.c_str(), lp);
-                fputs(" ", lp);
-                fputs(value.c_str(), lp);
-                fputs(" #", lp);
-                fclose(lp);
-                return true;
+        long bol = ftell(lp); // get start of line
+        if(!readLine(line, 0, lp)) break;
+        long eol = ftell(lp); // get end of line
+
+        for(size_t i = 0; i < settings.size(); i++) {
+            if(done[i] || process_line_from_ascii_config(line, setting_checksums[i]).empty()) continue;
+
+            // found it, only the first line with the key is changed
+            done[i] = true;
+            left--;
+            unsigned int free_space = eol - bol - 4; // length of line
+            // check we have enough space for this insertion
+            if( (settings[i].key.length() + settings[i].value.length() + 3) > free_space ) {
+                //THEKERNEL->streams->printf("ERROR: Not enough room for value\r\n");
+                break;
             }
-        }else break;
-    }
 
-    // not found so append the new value
+            // Update line, leaves whatever was at end of line there just overwrites the key and value
+            fseek(lp, bol, SEEK_SET);
+            fputs(settings[i].key.c_str(), lp);
+            fputs(" ", lp);
+            fputs(settings[i].value.c_str(), lp);
+            fputs(" #", lp);
+            fseek(lp, eol, SEEK_SET);
+            settings[i].written = true;
+            break;
+        }
+    }
     fclose(lp);
+    delete [] setting_checksums;
+
+    if(left == 0) return;
+
+    // not found so append the new values
     lp = fopen(this->get_config_file().c_str(), "a");
-    fputs("\n", lp);
-    fputs(setting.c_str(), lp);
-    fputs("         ", lp);
-    fputs(value.c_str(), lp);
-    fputs("         # added\n", lp);
+    for(size_t i = 0; i < settings.size(); i++) {
+        if(done[i]) continue;
+        fputs("\n", lp);
+        fputs(settings[i].key.c_str(), lp);
+        fputs("         ", lp);
+        fputs(settings[i].value.c_str(), lp);
+        fputs("         # added\n", lp);
+        settings[i].written = true;
+    }
     fclose(lp);
-
-    return true;
 }
 
 // Return the value for a specific checksum
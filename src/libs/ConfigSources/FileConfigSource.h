@@ -24,7 +24,9 @@ public:
     void transfer_values_to_cache( ConfigCache *cache, const char * file_name );
     bool is_named( uint16_t check_sum );
     bool write( string setting, string value );
+    void write_all( vector<ConfigSetting>& settings );
     string read( uint16_t check_sums[3] );
+    uint32_t stamp( uint32_t sum );
     bool has_config_file();
     void try_config_file(string candidate);
     string get_config_file();
@@ -11,6 +11,7 @@
 #include "ConfigCache.h"
 #include <malloc.h>
 #include "utils.h"
+#include "FileHash.h"
 
 using namespace std;
 #include <string>
@@ -71,6 +72,12 @@ bool FirmConfigSource::is_named( uint16_t check_sum ){
     return check_sum == this->name_checksum;
 }
 
+// The firmware's own defaults, these change with the firmware and the machine model
+uint32_t FirmConfigSource::stamp( uint32_t sum ){
+    sum = ConfigSource::stamp(sum);
+    return adler32((const uint8_t *)this->start, this->end - this->start, sum);
+}
+
 // Write a config setting to the file *** FirmConfigSource is read only ***
 bool FirmConfigSource::write( string setting, string value ){
     //THEKERNEL->streams->printf("ERROR: FirmConfigSource is read only\r\n");
@@ -26,6 +26,7 @@ public:
     bool is_named( uint16_t check_sum );
     bool write( string setting, string value );
     string read( uint16_t check_sums[3] );
+    uint32_t stamp( uint32_t sum );
 
 private:
     const char *start, *end;
@@ -21,6 +21,7 @@ void ConfigValue:: clear()
 {
     this->found = false;
     this->default_set = false;
+    this->source = 0;
     this->check_sums[0] = 0x0000;
     this->check_sums[1] = 0x0000;
     this->check_sums[2] = 0x0000;
@@ -33,6 +34,7 @@ ConfigValue::ConfigValue(uint16_t *cs) {
     memcpy(this->check_sums, cs, sizeof(this->check_sums));
     this->found = false;
     this->default_set = false;
+    this->source = 0;
     this->value= "";
 }
 
@@ -40,6 +42,7 @@ ConfigValue::ConfigValue(const ConfigValue& to_copy)
 {
     this->found = to_copy.found;
     this->default_set = to_copy.default_set;
+    this->source = to_copy.source;
     memcpy(this->check_sums, to_copy.check_sums, sizeof(this->check_sums));
     this->value.assign(to_copy.value);
 }
@@ -49,6 +52,7 @@ ConfigValue& ConfigValue::operator= (const ConfigValue& to_copy)
     if( this != &to_copy ){
         this->found = to_copy.found;
         this->default_set = to_copy.default_set;
+        this->source = to_copy.source;
         memcpy(this->check_sums, to_copy.check_sums, sizeof(this->check_sums));
         this->value.assign(to_copy.value);
     }
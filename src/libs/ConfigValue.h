@@ -31,6 +31,7 @@ class ConfigValue{
 
 
         friend class ConfigCache;
+        friend class ConfigImage;
         friend class Config;
         friend class ConfigSource;
         friend class Configurator;
@@ -42,8 +43,9 @@ class ConfigValue{
         int default_int;
         float default_double;
         uint16_t check_sums[3];
-        bool found;
-        bool default_set;
+        bool found:1;
+        bool default_set:1;
+        uint8_t source;         // index of the config source it was read from
 };
 
 
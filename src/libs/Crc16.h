@@ -0,0 +1,19 @@
+#ifndef _CRC16_H
+#define _CRC16_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC-16/CCITT as used by the framed protocol: polynomial 0x1021, initial value 0, no reflection.
+// crc16_ccitt() works through four bytes per step with four 256 entry tables held in flash (slice-by-4),
+// crc16_ccitt_update() is the single byte step for parsers that see one byte at a time.
+extern const uint16_t crc_table[256];
+
+uint16_t crc16_ccitt(const uint8_t *data, size_t len, uint16_t crc = 0);
+
+inline uint16_t crc16_ccitt_update(uint16_t crc, uint8_t c)
+{
+    return (crc << 8) ^ crc_table[((crc >> 8) ^ c) & 0xFF];
+}
+
+#endif /* _CRC16_H */
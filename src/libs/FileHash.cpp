@@ -0,0 +1,93 @@
+#include "FileHash.h"
+
+#include "Kernel.h"
+#include "md5.h"
+#include "platform_memory.h"
+
+#include <stdio.h>
+
+#define ADLER_MOD  65521
+#define ADLER_NMAX 5552 // largest n such that 255n(n+1)/2 + (n+1)(ADLER_MOD-1) fits in 32 bits
+
+typedef void (*hash_update_t)(void *ctx, const uint8_t *data, size_t len);
+
+static bool hash_file(const std::string& filename, hash_update_t update, void *ctx)
+{
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if (fp == NULL) return false;
+
+    // fall back to a single sector on the stack if AHB0 is too full
+    uint8_t sector[512];
+    uint8_t *buf = (uint8_t *)AHB0.alloc(FILEHASH_CHUNK_SIZE);
+    size_t bufsz = FILEHASH_CHUNK_SIZE;
+    if (buf == NULL) {
+        buf = sector;
+        bufsz = sizeof(sector);
+    }
+
+    // no stdio buffer, reads go straight from FatFs into buf
+    setvbuf(fp, NULL, _IONBF, 0);
+
+    size_t n;
+    while ((n = fread(buf, 1, bufsz, fp)) > 0) {
+        update(ctx, buf, n);
+        THEKERNEL->call_event(ON_IDLE);
+    }
+
+    fclose(fp);
+    if (buf != sector) AHB0.dealloc(buf);
+    return true;
+}
+
+static void md5_update(void *ctx, const uint8_t *data, size_t len)
+{
+    static_cast<MD5 *>(ctx)->update(data, len);
+}
+
+static void adler32_update(void *ctx, const uint8_t *data, size_t len)
+{
+    uint32_t *sum = static_cast<uint32_t *>(ctx);
+    *sum = adler32(data, len, *sum);
+}
+
+bool md5_file(const std::string& filename, std::string& hexdigest)
+{
+    MD5 md5;
+    if (!hash_file(filename, md5_update, &md5)) return false;
+    hexdigest = md5.finalize().hexdigest();
+    return true;
+}
+
+bool adler32_file(const std::string& filename, uint32_t& sum)
+{
+    sum = 1;
+    return hash_file(filename, adler32_update, &sum);
+}
+
+uint32_t adler32(const uint8_t *data, size_t len, uint32_t sum)
+{
+    uint32_t a = sum & 0xFFFF;
+    uint32_t b = sum >> 16;
+
+    while (len > 0) {
+        // defer the modulo for as long as the sums can not overflow
+        size_t n = len < ADLER_NMAX ? len : ADLER_NMAX;
+        len -= n;
+        while (n >= 4) {
+            a += data[0]; b += a;
+            a += data[1]; b += a;
+            a += data[2]; b += a;
+            a += data[3]; b += a;
+            data += 4;
+            n -= 4;
+        }
+        while (n-- > 0) {
+            a += *data++;
+            b += a;
+        }
+        a %= ADLER_MOD;
+        b %= ADLER_MOD;
+    }
+
+    return (b << 16) | a;
+}
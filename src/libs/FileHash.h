@@ -0,0 +1,22 @@
+#ifndef _FILEHASH_H
+#define _FILEHASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+// Hashing of whole files for md5sum and file verification.
+// Files are read unbuffered in FILEHASH_CHUNK_SIZE chunks into a buffer borrowed from AHB0,
+// so FatFs can transfer whole sectors straight into it, ON_IDLE is called between chunks.
+#define FILEHASH_CHUNK_SIZE 4096
+
+// MD5 of the file as a hex string, returns false if the file could not be opened
+bool md5_file(const std::string& filename, std::string& hexdigest);
+
+// Adler-32 of the file, much cheaper than MD5 and good enough for internal integrity checks
+bool adler32_file(const std::string& filename, uint32_t& sum);
+
+// running Adler-32, start with sum = 1
+uint32_t adler32(const uint8_t *data, size_t len, uint32_t sum);
+
+#endif /* _FILEHASH_H */
@@ -0,0 +1,74 @@
+#include "FrameParser.h"
+
+#include "PublicData.h"
+#include "Crc16.h"
+
+FrameParser::FrameParser(uint8_t *buf, uint16_t size) : buf(buf), size(size)
+{
+    frames = crc_errors = framing_errors = skipped = 0;
+    reset();
+}
+
+void FrameParser::reset()
+{
+    state = WAIT_HEADER;
+    pos = 0;
+    data_len = 0;
+    crc = 0;
+    buf[0] = buf[1] = 0;
+}
+
+bool FrameParser::feed(uint8_t c)
+{
+    switch (state) {
+        case WAIT_HEADER:
+            buf[0] = buf[1];
+            buf[1] = c;
+            if (((buf[0] << 8) | buf[1]) == HEADER) {
+                state = READ_LENGTH;
+                pos = 2;
+                crc = 0;
+            } else if (c != ((HEADER >> 8) & 0xFF)) {
+                skipped++;
+            }
+            return false;
+
+        case READ_LENGTH:
+            buf[pos++] = c;
+            crc = crc16_ccitt_update(crc, c);
+            if (pos == 4) {
+                data_len = (buf[2] << 8) | buf[3];
+                // type and crc are always there, and the whole frame has to fit
+                if (data_len < 3 || data_len + 6 > size) {
+                    framing_errors++;
+                    reset();
+                } else {
+                    state = READ_BODY;
+                }
+            }
+            return false;
+
+        case READ_BODY:
+            buf[pos++] = c;
+            // the crc covers length, type and payload, the crc is kept up to date as bytes arrive
+            if (pos <= data_len + 2) {
+                crc = crc16_ccitt_update(crc, c);
+            }
+            if (pos < data_len + 6) return false;
+
+            state = WAIT_HEADER;
+            buf[1] = 0;
+            if (((buf[pos - 2] << 8) | buf[pos - 1]) != FOOTER) {
+                framing_errors++;
+                return false;
+            }
+            if (((buf[pos - 4] << 8) | buf[pos - 3]) != crc) {
+                crc_errors++;
+                return false;
+            }
+            frames++;
+            return true;
+    }
+
+    return false;
+}
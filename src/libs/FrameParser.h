@@ -0,0 +1,40 @@
+#ifndef _FRAMEPARSER_H
+#define _FRAMEPARSER_H
+
+#include <stdint.h>
+
+// Incremental parser for the HEADER/FOOTER framed protocol, see PublicData.h
+//   [header 2][length 2][type 1][payload][crc 2][footer 2], length = payload + 3, the crc covers length..payload
+// Bytes are fed one at a time as they arrive so a frame can be assembled across any number of calls,
+// nothing ever waits for more bytes. The frame is held in a buffer owned by the caller and is only valid
+// until the next call to feed().
+class FrameParser {
+    public:
+        FrameParser(uint8_t *buf, uint16_t size);
+
+        // returns true when the buffer holds a complete frame with a good footer and crc
+        bool feed(uint8_t c);
+        void reset();
+        bool in_frame() const { return state != WAIT_HEADER; }
+
+        uint8_t type() const { return buf[4]; }
+        const uint8_t *payload() const { return &buf[5]; }
+        uint16_t payload_len() const { return data_len - 3; }
+
+        uint32_t frames;
+        uint32_t crc_errors;
+        uint32_t framing_errors;
+        uint32_t skipped;       // bytes outside of any frame, other than a lone first header byte
+
+    private:
+        enum STATE_T { WAIT_HEADER, READ_LENGTH, READ_BODY };
+
+        uint8_t *buf;
+        uint16_t size;
+        uint16_t pos;
+        uint16_t data_len;
+        uint16_t crc;
+        STATE_T state;
+};
+
+#endif /* _FRAMEPARSER_H */
@@ -0,0 +1,196 @@
+#include "InputScheduler.h"
+
+#include "Kernel.h"
+#include "StreamOutput.h"
+
+#include "us_ticker_api.h"
+
+#define INPUT_LINES_PER_PASS 8
+
+InputScheduler::InputScheduler()
+{
+    depth = 0;
+    last = 0;
+    held = false;
+}
+
+void InputScheduler::on_module_loaded()
+{
+    this->register_for_event(ON_MAIN_LOOP);
+    this->register_for_event(ON_IDLE);
+}
+
+void InputScheduler::on_main_loop(void *argument)
+{
+    dispatch();
+}
+
+// keeps the lines moving while a module waits, nothing runs while one of them is running
+void InputScheduler::on_idle(void *argument)
+{
+    dispatch();
+}
+
+uint8_t InputScheduler::add_source(const char *name)
+{
+    source_t s = source_t();
+    s.name = name;
+    sources.push_back(s);
+    return sources.size() - 1;
+}
+
+uint8_t InputScheduler::classify(const std::string& line)
+{
+    size_t i = line.find_first_not_of(" \t");
+    if (i != std::string::npos && line.compare(i, 2, "$J") == 0) return INPUT_JOG;
+    return INPUT_STREAM;
+}
+
+bool InputScheduler::has_room(uint8_t source)
+{
+    source_t &s = sources[source];
+    if (s.queue.size() < INPUT_QUEUE_SIZE) return true;
+    s.full++;
+    return false;
+}
+
+bool InputScheduler::idle(uint8_t source) const
+{
+    const source_t &s = sources[source];
+    return s.queue.empty() && !s.busy;
+}
+
+void InputScheduler::submit(uint8_t source, StreamOutput *stream, const std::string& line)
+{
+    source_t &s = sources[source];
+    SerialMessage message;
+    message.stream = stream;
+    message.message = line;
+    message.line = 0;
+    s.queue.push_back(message);
+    s.priority.push_back(classify(line));
+    s.queued_us.push_back(us_ticker_read());
+    if (s.queue.size() > s.max_queued) s.max_queued = s.queue.size();
+}
+
+// has a line at its head that may run now
+bool InputScheduler::ready(uint8_t source) const
+{
+    const source_t &s = sources[source];
+    if (s.busy || s.queue.empty()) return false;
+    // never inside a running line, see InputScheduler.h
+    return depth == 0;
+}
+
+int InputScheduler::pick()
+{
+    int n = sources.size();
+    int best = -1;
+    bool boosted = false;
+
+    // round robin from the one after the last served, so the first of equal priority wins
+    for (int k = 1; k <= n; ++k) {
+        int i = (last + k) % n;
+        if (!ready(i)) continue;
+        if (sources[i].skipped >= INPUT_FAIR_LIMIT) {
+            best = i;
+            boosted = true;
+            break;
+        }
+        if (best < 0 || sources[i].priority.front() > sources[best].priority.front()) best = i;
+    }
+    if (best < 0) return -1;
+
+    for (int i = 0; i < n; ++i) {
+        if (i == best || !ready(i)) continue;
+        sources[i].skipped++;
+        sources[i].passed_over++;
+    }
+    if (boosted) sources[best].boosts++;
+    last = best;
+    return best;
+}
+
+void InputScheduler::run(uint8_t source, SerialMessage& message)
+{
+    sources[source].busy = true;
+    sources[source].skipped = 0;
+    depth++;
+
+    THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message);
+
+    depth--;
+    sources[source].busy = false;
+    sources[source].lines++;
+}
+
+bool InputScheduler::may_run() const
+{
+    return depth == 0 && !held && !THEKERNEL->is_uploading();
+}
+
+void InputScheduler::dispatch()
+{
+    if (!may_run()) return;
+
+    for (int k = 0; k < INPUT_LINES_PER_PASS; ++k) {
+        int i = pick();
+        if (i < 0) return;
+
+        // taken off the queue before it runs, the source may queue more while it does
+        source_t &s = sources[i];
+        SerialMessage message = s.queue.front();
+        uint32_t waited = us_ticker_read() - s.queued_us.front();
+        s.queue.pop_front();
+        s.priority.pop_front();
+        s.queued_us.pop_front();
+        if (waited > s.max_wait_us) s.max_wait_us = waited;
+
+        run(i, message);
+    }
+}
+
+bool InputScheduler::should_yield(uint8_t source, uint8_t priority)
+{
+    source_t &s = sources[source];
+    bool waiting = false;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        if (i != source && ready(i) && sources[i].priority.front() > priority) waiting = true;
+    }
+    if (!waiting) return false;
+
+    if (s.skipped >= INPUT_FAIR_LIMIT) {
+        s.boosts++;
+        return false;
+    }
+    s.skipped++;
+    s.passed_over++;
+    return true;
+}
+
+void InputScheduler::execute(uint8_t source, SerialMessage& message)
+{
+    run(source, message);
+}
+
+void InputScheduler::report(StreamOutput *out) const
+{
+    for (size_t i = 0; i < sources.size(); ++i) {
+        const source_t &s = sources[i];
+        out->printf("%-6s %7lu lines, queued %u (max %u), passed over %lu, boosted %lu, full %lu, max wait %lu us\r\n",
+                    s.name, s.lines, (unsigned)s.queue.size(), s.max_queued, s.passed_over, s.boosts, s.full, s.max_wait_us);
+    }
+}
+
+void InputScheduler::reset_stats()
+{
+    for (size_t i = 0; i < sources.size(); ++i) {
+        source_t &s = sources[i];
+        s.lines = 0;
+        s.passed_over = 0;
+        s.boosts = 0;
+        s.full = 0;
+        s.max_queued = 0;
+        s.max_wait_us = 0;
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef _INPUTSCHEDULER_H
+#define _INPUTSCHEDULER_H
+
+#include "Module.h"
+#include "SerialMessage.h"
+
+#include <deque>
+#include <vector>
+#include <stdint.h>
+
+class StreamOutput;
+
+// Lines from the host streams and the file player all go through here on their way to ON_CONSOLE_LINE_RECEIVED.
+// Each source has its own queue, the line at its head is run by priority, jog before streamed lines before the
+// file being played, round robin between sources of the same priority. A source passed over INPUT_FAIR_LIMIT
+// times in a row is served next whatever its priority, so nothing waits forever.
+// Nothing is run from inside a running line, it may be waiting in ON_IDLE for room in the queue with its block
+// planned but not yet queued, a jog run then would plan over it. A jog goes first once that line is done.
+// A source never has more than one line running, lines from one source always run in order.
+// Realtime commands never get this far, see Realtime.h.
+enum INPUT_PRIORITY {
+    INPUT_FILE,
+    INPUT_STREAM,
+    INPUT_JOG,
+    NUM_INPUT_PRIORITIES
+};
+
+#define INPUT_QUEUE_SIZE  4
+#define INPUT_FAIR_LIMIT  8
+
+class InputScheduler : public Module {
+    public:
+        InputScheduler();
+
+        void on_module_loaded();
+        void on_main_loop(void *argument);
+        void on_idle(void *argument);
+
+        uint8_t add_source(const char *name);
+        static uint8_t classify(const std::string& line);
+
+        // false when the source's queue is full, it should stop reading input until there is room
+        bool has_room(uint8_t source);
+        void submit(uint8_t source, StreamOutput *stream, const std::string& line);
+        // nothing queued or running from the source
+        bool idle(uint8_t source) const;
+
+        // for sources that produce their own lines (the player): true when the caller should wait as something
+        // of higher priority is waiting, otherwise run the line with execute()
+        bool should_yield(uint8_t source, uint8_t priority);
+        void execute(uint8_t source, SerialMessage& message);
+
+        // runs waiting lines, at most a few per call
+        void dispatch();
+        // a line may start now, not inside another nor while held or uploading, what dispatch() checks first
+        bool may_run() const;
+        // lines wait in their queues while held, a dry run holds them as it is using Robot to plan a file
+        void hold(bool flg) { held = flg; }
+        bool is_held() const { return held; }
+
+        void report(StreamOutput *out) const;
+        void reset_stats();
+
+    private:
+        struct source_t {
+            const char *name;
+            std::deque<SerialMessage> queue;
+            std::deque<uint8_t> priority;
+            std::deque<uint32_t> queued_us;
+            bool busy;
+            uint16_t skipped;           // times in a row it was passed over with a line waiting
+            uint32_t lines;
+            uint32_t passed_over;
+            uint32_t boosts;            // times it was served out of turn because of INPUT_FAIR_LIMIT
+            uint32_t full;              // times it was told to stop reading
+            uint16_t max_queued;
+            uint32_t max_wait_us;
+        };
+
+        int pick();
+        void run(uint8_t source, SerialMessage& message);
+        bool ready(uint8_t source) const;
+
+        std::vector<source_t> sources;
+        uint8_t depth;                  // lines running, one unless a module runs a line from inside another
+        uint8_t last;                   // for the round robin
+        bool held;
+};
+
+#endif /* _INPUTSCHEDULER_H */
@@ -9,7 +9,9 @@
 #include "libs/Module.h"
 #include "libs/Config.h"
 #include "libs/nuts_bolts.h"
+#include "libs/Crc16.h"
 #include "libs/SlowTicker.h"
+#include "libs/InputScheduler.h"
 #include "libs/Adc.h"
 #include "libs/StreamOutputPool.h"
 #include <mri.h>
@@ -39,6 +41,8 @@
 #include "mbed.h"
 #include "utils.h"
 #include "WifiPublicAccess.h"
+#include "BootProfile.h"
+#include "us_ticker_api.h"
 
 #ifndef NO_TOOLS_LASER
 #include "Laser.h"
@@ -96,11 +100,13 @@ Kernel::Kernel()
     this->i2c = new mbed::I2C(P0_27, P0_28);
     this->i2c->frequency(200000);
     
+    uint32_t start = us_ticker_read();
     this->factory_set = new(AHB0) FACTORY_SET();
     // read Factory setting data from eeprom
     this->read_Factory_data();
     // read Factory settings data from sd
     this->read_Factroy_SD();
+    BootProfile::record("factory settings", start);
 
     // serial first at fixed baud rate (DEFAULT_SERIAL_BAUD_RATE) so config can report errors to serial
     // Set to UART0, this will be changed to use the same UART as MRI if it's enabled
@@ -111,7 +117,9 @@ Kernel::Kernel()
     this->config = new(AHB0) Config();
 
     // Pre-load the config cache, do after setting up serial so we can report errors to serial
+    start = us_ticker_read();
     this->config->config_cache_load();
+    BootProfile::record("config", start);
 
     // now config is loaded we can do normal setup for serial based on config
     delete this->serial;
@@ -166,6 +174,8 @@ Kernel::Kernel()
     // we expect ok per line now not per G code, setting this to false will return to the old (incorrect) way of ok per G code
     this->ok_per_line = this->config->value( ok_per_line_checksum )->by_default(true)->as_bool();
 
+    // before the streams, they add themselves to it as they load
+    this->add_module( this->input = new(AHB0) InputScheduler() );
     this->add_module( this->serial );
 
     // HAL stuff
@@ -181,7 +191,8 @@ Kernel::Kernel()
     NVIC_SetPriority(TIMER1_IRQn, 1);
     NVIC_SetPriority(TIMER2_IRQn, 4);
     NVIC_SetPriority(TIMER3_IRQn, 4);
-    NVIC_SetPriority(PendSV_IRQn, 3);
+    // realtime commands write their replies from PendSV, so it must not hold up the UART and USB interrupts
+    NVIC_SetPriority(PendSV_IRQn, 6);
 
     // Set other priorities lower than the timers
     NVIC_SetPriority(ADC_IRQn, 5);
@@ -208,17 +219,19 @@ Kernel::Kernel()
     this->step_ticker->set_frequency( this->base_stepping_frequency );
     this->step_ticker->set_unstep_time( microseconds_per_step_pulse );
 
+    start = us_ticker_read();
     this->eeprom_data = new(AHB0) EEPROM_data();
     // read eeprom data
     this->read_eeprom_data();
     // check eeprom data
     this->check_eeprom_data();
+    BootProfile::record("eeprom", start);
 
     // Core modules
-    this->add_module( this->conveyor       = new(AHB0) Conveyor()      );
-    this->add_module( this->gcode_dispatch = new(AHB0) GcodeDispatch() );
-    this->add_module( this->robot          = new(AHB0) Robot()         );
-    this->add_module( this->simpleshell    = new(AHB0) SimpleShell()   );
+    this->add_module( this->conveyor       = new(AHB0) Conveyor(),      "conveyor" );
+    this->add_module( this->gcode_dispatch = new(AHB0) GcodeDispatch(), "gcode dispatch" );
+    this->add_module( this->robot          = new(AHB0) Robot(),         "robot" );
+    this->add_module( this->simpleshell    = new(AHB0) SimpleShell(),   "shell" );
 
     this->planner = new(AHB0) Planner();
     this->configurator = new(AHB0) Configurator();
@@ -257,31 +270,12 @@ std::string Kernel::get_query_string()
 
     std::string str;
     bool running = false;
-    bool ok = false;
 
     uint8_t state = this->get_state();
 
-    str.append("<");
-    if (state == SLEEP) {
-    	str.append("Sleep");
-    } else if (state == SUSPEND) {
-    	str.append("Pause");
-    } else if (state == WAIT) {
-        str.append("Wait");
-    } else if (state == TOOL) {
-		str.append("Tool");
-    } else if (state == ALARM) {
-        str.append("Alarm");
-    } else if (state == HOME) {
-        running = true;
-        str.append("Home");
-    } else if (state == HOLD) {
-        str.append("Hold");
-    } else if (state == IDLE) {
-        str.append("Idle");
-    } else if (state == RUN) {
+    str.append("<").append(get_state_name(state));
+    if (state == HOME || state == RUN) {
         running = true;
-        str.append("Run");
     }
 
     size_t n;
@@ -358,6 +352,36 @@ std::string Kernel::get_query_string()
         str.append(buf, n);
     }
 
+    str.append(get_query_tail(state));
+    return str;
+}
+
+const char *Kernel::get_state_name(uint8_t state)
+{
+    switch (state) {
+        case SLEEP:   return "Sleep";
+        case SUSPEND: return "Pause";
+        case WAIT:    return "Wait";
+        case TOOL:    return "Tool";
+        case ALARM:   return "Alarm";
+        case HOME:    return "Home";
+        case HOLD:    return "Hold";
+        case IDLE:    return "Idle";
+        case RUN:     return "Run";
+    }
+    return "";
+}
+
+// the slower half of the query string, feedrate, spindle, tool and so on
+std::string Kernel::get_query_tail(uint8_t state)
+{
+    std::string str;
+    bool ok = false;
+    size_t n;
+    char buf[128];
+
+    bool running = (state == HOME || state == RUN);
+
     // current feedrate and requested fr and override
     float fr= running ? robot->from_millimeters(conveyor->get_current_feedrate()*60.0F) : 0;
     float frr= robot->from_millimeters(robot->get_feed_rate());
@@ -638,9 +662,11 @@ std::string Kernel::get_diagnose_string()
 }
 
 // Add a module to Kernel. We don't actually hold a list of modules we just call its on_module_loaded
-void Kernel::add_module(Module* module)
+void Kernel::add_module(Module* module, const char *name)
 {
+    uint32_t start = us_ticker_read();
     module->on_module_loaded();
+    if(name != nullptr) BootProfile::record(name, start);
 }
 
 // Adds a hook for a given module and event
@@ -716,8 +742,7 @@ void Kernel::read_eeprom_data()
 	this->i2c->stop();
 	this->i2c->stop();
 
-    wait(0.05);
-
+    // no wait needed here, only a write leaves the eeprom busy
     memcpy(this->eeprom_data, i2c_buffer, size);
 }
 
@@ -877,8 +902,7 @@ void Kernel::read_Factory_data()
 	this->i2c->stop();
 	this->i2c->stop();
 
-    wait(0.05);
-	
+	// no wait needed here, only a write leaves the eeprom busy
 	if( Check_Factory_Data((unsigned char*)i2c_buffer, sizeof(FACTORY_SET)+2 ) )
 	{
     	memcpy(this->factory_set, &i2c_buffer[2], size);
@@ -1142,54 +1166,6 @@ bool Kernel::Check_Factory_Data(unsigned char *data, unsigned int len)
 	}
 }
 
-unsigned int Kernel::crc16_ccitt(unsigned char *data, unsigned int len)
-{
-	static const unsigned short crc_table[] = {
-		0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
-		0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
-		0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
-		0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
-		0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
-		0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
-		0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
-		0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
-		0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
-		0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
-		0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
-		0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
-		0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
-		0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
-		0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
-		0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
-		0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
-		0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
-		0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
-		0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
-		0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
-		0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
-		0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
-		0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
-		0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
-		0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
-		0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
-		0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
-		0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
-		0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
-		0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
-		0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
-	};
-
-	unsigned char tmp;
-	unsigned short crc = 0;
-
-	for (unsigned int i = 0; i < len; i ++) {
-        tmp = ((crc >> 8) ^ data[i]) & 0xff;
-        crc = ((crc << 8) ^ crc_table[tmp]) & 0xffff;
-	}
-
-	return crc & 0xffff;
-}
-
 
 int Kernel::iic_page_write(unsigned char u8PageNum, unsigned char u8len, unsigned char *pu8Array)
 {
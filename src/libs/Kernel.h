@@ -28,6 +28,7 @@ class Module;
 class Conveyor;
 class SlowTicker;
 class SerialConsole;
+class InputScheduler;
 class StreamOutputPool;
 class GcodeDispatch;
 class Robot;
@@ -121,7 +122,8 @@ class Kernel {
         static Kernel* instance; // the Singleton instance of Kernel usable anywhere
         const char* config_override_filename(){ return "/sd/config-override"; }
 
-        void add_module(Module* module);
+        // a named module has the time its on_module_loaded takes recorded in the boot profile
+        void add_module(Module* module, const char *name= nullptr);
         void register_for_event(_EVENT_ENUM id_event, Module *module);
         void call_event(_EVENT_ENUM id_event, void * argument= nullptr);
 
@@ -130,6 +132,8 @@ class Kernel {
 
         bool is_using_leds() const { return use_leds; }
         bool is_halted() const { return halted; }
+        // stops the step ticker at once, ON_HALT still has to be called from the main loop
+        void set_halted(bool f) { halted = f; }
         bool is_grbl_mode() const { return grbl_mode; }
         bool is_ok_per_line() const { return ok_per_line; }
 
@@ -193,14 +197,17 @@ class Kernel {
         bool Check_Factory_Data(unsigned char *data, unsigned int len);
         bool Factroy_readLine(std::string& line, int lineno, FILE *fp);
         bool process_line(const std::string &buffer, uint16_t *check_sum, unsigned char *value);
-        unsigned int crc16_ccitt(unsigned char *data, unsigned int len);
 
         std::string get_query_string();
+        // everything in the query string after the positions, ends with ">\n"
+        std::string get_query_tail(uint8_t state);
+        static const char *get_state_name(uint8_t state);
 
         std::string get_diagnose_string();
 
         // These modules are available to all other modules
         SerialConsole*    serial;
+        InputScheduler*   input;
         StreamOutputPool* streams;
         GcodeDispatch*    gcode_dispatch;
         Robot*            robot;
@@ -232,11 +239,12 @@ class Kernel {
         // When a module asks to be called for a specific event ( a hook ), this is where that request is remembered
         mbed::I2C* i2c;
         std::array<std::vector<Module*>, NUMBER_OF_DEFINED_EVENTS> hooks;
+        // set by realtime commands from PendSV, so kept out of the bitfield where a write would clobber its neighbours
+        volatile bool halted;
+        volatile bool feed_hold;
         struct {
             bool use_leds:1;
-            bool halted:1;
             bool grbl_mode:1;
-            bool feed_hold:1;
             bool ok_per_line:1;
             volatile bool enable_feed_hold:1;
             bool bad_mcu:1;
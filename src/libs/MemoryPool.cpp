@@ -40,11 +40,13 @@ MemoryPool* MemoryPool::first = NULL;
 
 MemoryPool::MemoryPool(void* base, uint16_t size)
 {
-    this->base = base;
-    this->size = size;
+    // chunk sizes are multiples of 4, so with an aligned base every allocation is word aligned
+    uint16_t skew = (4 - ((uintptr_t) base & 3)) & 3;
+    this->base = ((uint8_t*) base) + skew;
+    this->size = (size - skew) & ~3;
 
-    ((_poolregion*) base)->used = 0;
-    ((_poolregion*) base)->next = size;
+    ((_poolregion*) this->base)->used = 0;
+    ((_poolregion*) this->base)->next = this->size;
 
     // insert ourselves into head of LL
     next = first;
@@ -98,8 +100,8 @@ void* MemoryPool::alloc(size_t nbytes)
             // mark it as used
             p->used = 1;
 
-            // if there's free space at the end of this block
-            if (p->next > nsize)
+            // if there's free space at the end of this block, more than just a header as the walks stop at one of those
+            if (p->next > nsize + sizeof(_poolregion))
             {
                 // q = p->next
                 _poolregion* q = (_poolregion*) (((uint8_t*) p) + nsize);
@@ -247,3 +249,27 @@ uint32_t MemoryPool::free()
         p = (_poolregion*) (((uint8_t*) p) + p->next);
     } while (1);
 }
+
+uint32_t MemoryPool::largest_free()
+{
+    uint32_t largest = 0;
+
+    _poolregion* p = (_poolregion*) base;
+
+    do {
+        if (p->used == 0 && p->next > largest)
+            largest = p->next;
+        if (offset(p) + p->next >= size)
+            return largest;
+        if (p->next <= sizeof(_poolregion))
+            return largest;
+        p = (_poolregion*) (((uint8_t*) p) + p->next);
+    } while (1);
+}
+
+void MemoryPool::stats(StreamOutput* str)
+{
+    uint32_t f = free();
+    uint32_t l = largest_free();
+    str->printf("Pool at %p: %lub free, largest chunk %lub, fragmentation %lu%%\n", base, f, l, (f > 0) ? 100 - (l * 100 / f) : 0);
+}
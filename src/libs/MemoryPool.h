@@ -22,6 +22,7 @@ class StreamOutput;
 class MemoryPool
 {
 public:
+    // base is rounded up and size down to whole words
     MemoryPool(void* base, uint16_t size);
     ~MemoryPool();
 
@@ -29,10 +30,13 @@ public:
     void  dealloc(void* p);
 
     void  debug(StreamOutput*);
+    // free space and how fragmented it is
+    void  stats(StreamOutput*);
 
     bool  has(void*);
 
     uint32_t free(void);
+    uint32_t largest_free(void);
 
     MemoryPool* next;
 
@@ -13,6 +13,7 @@
 #define FOOTER        0x55AA
 #define PTYPE_CTRL_SINGLE	0xA1
 #define	PTYPE_CTRL_MULTI	0xA2
+#define PTYPE_CTRL_BATCH	0xA3	// [seq 2][line\nline\n...], answered by one PTYPE_BATCH_ACK
 #define PTYPE_FILE_START	0xB0
 #define PTYPE_FILE_MD5		0xB1
 #define PTYPE_FILE_VIEW		0xB2
@@ -26,6 +27,7 @@
 #define PTYPE_LOAD_INFO		0x83
 #define PTYPE_LOAD_FINISH	0x84
 #define PTYPE_LOAD_ERROR	0x85
+#define PTYPE_BATCH_ACK		0x86	// [seq 2][capacity 2][free 2][one status per line], see CommandBatch.h
 
 #define PTYPE_NORMAL_INFO	0x90
 
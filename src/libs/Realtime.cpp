@@ -0,0 +1,306 @@
+#include "Realtime.h"
+
+#include "Kernel.h"
+#include "Robot.h"
+#include "StepperMotor.h"
+#include "StreamOutput.h"
+#include "PublicData.h"
+#include "Crc16.h"
+
+#include "us_ticker_api.h"
+#include "LPC17xx.h"
+
+#include <string>
+#include <string.h>
+
+Realtime *Realtime::instance = nullptr;
+
+// the fixed part of a realtime frame, byte 5 is the command and 6-7 the crc
+static const uint8_t frame_template[REALTIME_FRAME_SIZE] = {
+    (HEADER >> 8) & 0xFF, HEADER & 0xFF, 0x00, 0x04, PTYPE_CTRL_SINGLE, 0, 0, 0, (FOOTER >> 8) & 0xFF, FOOTER & 0xFF
+};
+
+bool Realtime::is_command(char c)
+{
+    return c == '?' || c == '!' || c == '~' || c == 'X' - 'A' + 1;
+}
+
+bool RealtimeFilter::could_match() const
+{
+    for (uint8_t i = 0; i < held; ++i) {
+        if (i == 5) {
+            if (!Realtime::is_command(buf[i])) return false;
+        } else if (i != 6 && i != 7 && buf[i] != frame_template[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int RealtimeFilter::feed(uint8_t c, uint8_t *out, char &cmd)
+{
+    int n = 0;
+    cmd = 0;
+    buf[held++] = c;
+
+    while (held > 0) {
+        if (could_match()) {
+            if (held < REALTIME_FRAME_SIZE) break;
+            if (crc16_ccitt(&buf[2], 4) == ((buf[6] << 8) | buf[7])) {
+                cmd = buf[5];
+                held = 0;
+                break;
+            }
+        }
+        // no realtime frame starts at buf[0], pass it on and try again from the next byte
+        out[n++] = buf[0];
+        held--;
+        memmove(buf, buf + 1, held);
+    }
+    return n;
+}
+
+void RealtimeLatency::add(uint32_t us)
+{
+    count++;
+    last_us = us;
+    total_us += us;
+    if (us > max_us) max_us = us;
+}
+
+Realtime::Realtime(StreamOutput *stream) : stream(stream)
+{
+    memset(latency, 0, sizeof(latency));
+    checked_us = 0;
+    refreshes = 0;
+    current = 0;
+    writing = 0;
+    for (int i = 0; i < 4; ++i) {
+        pending[i] = false;
+        posted_us[i] = 0;
+    }
+    deferred_us = 0;
+    halt_main = false;
+    query_deferred = false;
+    queried = false;
+    have_snapshot = false;
+    instance = this;
+}
+
+void Realtime::post(char c)
+{
+    int i = c == '?' ? QUERY : c == '!' ? HOLD : c == '~' ? RESUME : ABORT;
+    posted_us[i] = us_ticker_read();
+    pending[i] = true;
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+void Realtime::handle()
+{
+    if (pending[ABORT]) {
+        pending[ABORT] = false;
+        // the step ticker stops on its next tick, flushing the queue and telling the modules is left to ON_HALT
+        THEKERNEL->set_halted(true);
+        halt_main = true;
+        latency[ABORT].add(us_ticker_read() - posted_us[ABORT]);
+    }
+
+    if (pending[HOLD]) {
+        pending[HOLD] = false;
+        if (THEKERNEL->is_feed_hold_enabled()) THEKERNEL->set_feed_hold(true);
+        latency[HOLD].add(us_ticker_read() - posted_us[HOLD]);
+    }
+
+    if (pending[RESUME]) {
+        pending[RESUME] = false;
+        if (THEKERNEL->is_feed_hold_enabled()) THEKERNEL->set_feed_hold(false);
+        latency[RESUME].add(us_ticker_read() - posted_us[RESUME]);
+    }
+
+    if (pending[QUERY]) {
+        pending[QUERY] = false;
+        queried = true;
+        if (writing != 0 || !have_snapshot || THEKERNEL->is_uploading()) {
+            deferred_us = posted_us[QUERY];
+            query_deferred = true;
+        } else {
+            send_status();
+            latency[QUERY].add(us_ticker_read() - posted_us[QUERY]);
+        }
+    }
+}
+
+bool Realtime::take_halt()
+{
+    if (!halt_main) return false;
+    halt_main = false;
+    return true;
+}
+
+bool Realtime::take_query()
+{
+    if (!query_deferred) return false;
+    query_deferred = false;
+    latency[DEFERRED].add(us_ticker_read() - deferred_us);
+    return true;
+}
+
+void Realtime::live_position(float *pos)
+{
+    Robot *robot = THEKERNEL->robot;
+    uint8_t n = robot->get_number_registered_motors();
+    for (uint8_t i = 0; i < 5; ++i) {
+        pos[i] = i < n ? robot->actuators[i]->get_current_position() : 0;
+    }
+}
+
+void Realtime::on_idle()
+{
+    uint32_t now = us_ticker_read();
+    if (have_snapshot && now - checked_us < REALTIME_REFRESH_US) return;
+    checked_us = now;
+
+    if (have_snapshot && !queried && THEKERNEL->get_state() == snapshot[current].state) return;
+    // cleared first, a query answered while this runs asks for the next one
+    queried = false;
+    refresh();
+}
+
+// the same positions get_query_string() reports, kept as offsets from the actuators so PendSV can add them to live ones
+void Realtime::refresh()
+{
+    Robot *robot = THEKERNEL->robot;
+    snapshot_t &s = snapshot[current ^ 1];
+
+    s.state = THEKERNEL->get_state();
+    s.scale = robot->inch_mode ? 1.0F / 25.4F : 1.0F;
+
+    float live[5];
+    live_position(live);
+
+    float mpos[5];
+    if (s.state == HOME || s.state == RUN) {
+        robot->get_current_machine_position(mpos);
+        if (robot->compensationTransform) robot->compensationTransform(mpos, true, false);
+        mpos[A_AXIS] = live[A_AXIS];
+        mpos[B_AXIS] = live[B_AXIS];
+    } else {
+        robot->get_axis_position(mpos, 5);
+    }
+
+    Robot::wcs_t w = robot->mcs2wcs(mpos);
+    float wpos[5] = { std::get<X_AXIS>(w), std::get<Y_AXIS>(w), std::get<Z_AXIS>(w), std::get<A_AXIS>(w), std::get<B_AXIS>(w) };
+    for (int i = 0; i < 5; ++i) {
+        s.mpos_offset[i] = mpos[i] - live[i];
+        s.wpos_offset[i] = wpos[i] - live[i];
+    }
+
+    std::string tail = THEKERNEL->get_query_tail(s.state);
+    size_t n = tail.size() < sizeof(s.tail) - 1 ? tail.size() : sizeof(s.tail) - 1;
+    memcpy(s.tail, tail.data(), n);
+    s.tail[n] = 0;
+    // a truncated tail still has to close the status
+    if (n < tail.size()) strcpy(&s.tail[n - 2], ">\n");
+
+    current ^= 1;
+    have_snapshot = true;
+    refreshes++;
+}
+
+// %1.4f without printf, newlib's float formatting is not safe to use from an interrupt
+static char *put_fixed(char *p, float v)
+{
+    if (v < 0) {
+        *p++ = '-';
+        v = -v;
+    }
+    if (v > 400000.0F) v = 400000.0F;
+    uint32_t f = (uint32_t)(v * 10000.0F + 0.5F);
+    uint32_t whole = f / 10000, frac = f % 10000;
+
+    char digits[8];
+    int n = 0;
+    do {
+        digits[n++] = '0' + whole % 10;
+        whole /= 10;
+    } while (whole != 0);
+    while (n > 0) *p++ = digits[--n];
+
+    *p++ = '.';
+    for (uint32_t d = 1000; d != 0; d /= 10) {
+        *p++ = '0' + (frac / d) % 10;
+    }
+    return p;
+}
+
+static char *put_axes(char *p, const char *label, const float *pos, float scale)
+{
+    size_t l = strlen(label);
+    memcpy(p, label, l);
+    p += l;
+    for (int i = 0; i < 5; ++i) {
+        if (i > 0) *p++ = ',';
+        // A and B are reported unconverted, as in get_query_string()
+        p = put_fixed(p, i < 3 ? pos[i] * scale : pos[i]);
+    }
+    return p;
+}
+
+void Realtime::send_status()
+{
+    const snapshot_t &s = snapshot[current];
+
+    // the snapshot can be from before the last query, an abort or hold since then is shown straight away
+    uint8_t state = s.state;
+    if (THEKERNEL->is_halted()) {
+        state = ALARM;
+    } else if (THEKERNEL->get_feed_hold() && (state == RUN || state == IDLE)) {
+        state = HOLD;
+    }
+
+    float live[5], mpos[5], wpos[5];
+    live_position(live);
+    for (int i = 0; i < 5; ++i) {
+        mpos[i] = live[i] + s.mpos_offset[i];
+        wpos[i] = live[i] + s.wpos_offset[i];
+    }
+
+    char *start = (char *)&frame[5];
+    char *p = start;
+    *p++ = '<';
+    const char *name = Kernel::get_state_name(state);
+    size_t l = strlen(name);
+    memcpy(p, name, l);
+    p += l;
+    p = put_axes(p, "|MPos:", mpos, s.scale);
+    p = put_axes(p, "|WPos:", wpos, s.scale);
+    l = strlen(s.tail);
+    memcpy(p, s.tail, l);
+    p += l;
+
+    size_t total_length = p - start;
+    size_t len = total_length + 3;
+    frame[0] = (HEADER >> 8) & 0xFF;
+    frame[1] = HEADER & 0xFF;
+    frame[2] = (len >> 8) & 0xFF;
+    frame[3] = len & 0xFF;
+    frame[4] = PTYPE_STATUS_RES;
+    uint16_t crc = crc16_ccitt(&frame[2], len);
+    frame[total_length + 5] = (crc >> 8) & 0xFF;
+    frame[total_length + 6] = crc & 0xFF;
+    frame[total_length + 7] = (FOOTER >> 8) & 0xFF;
+    frame[total_length + 8] = FOOTER & 0xFF;
+
+    stream->puts((char *)frame, len + 6);
+}
+
+void Realtime::report(StreamOutput *out)
+{
+    static const char *names[NUM_LATENCIES] = { "status", "hold", "resume", "abort", "status (deferred)" };
+    for (int i = 0; i < NUM_LATENCIES; ++i) {
+        const RealtimeLatency &l = latency[i];
+        out->printf("%-17s %5lu, last %lu us, avg %lu us, max %lu us\r\n", names[i], l.count, l.last_us,
+                    l.count ? l.total_us / l.count : 0, l.max_us);
+    }
+    out->printf("snapshot refreshes %lu\r\n", refreshes);
+}
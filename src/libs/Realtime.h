@@ -0,0 +1,107 @@
+#ifndef _REALTIME_H
+#define _REALTIME_H
+
+#include <stdint.h>
+
+class StreamOutput;
+
+// Realtime commands, '?' status, '!' feed hold, '~' resume and Ctrl-X abort, each sent as a PTYPE_CTRL_SINGLE frame.
+// RealtimeFilter sits between the serial rx interrupt and the ring buffer and takes these frames out of the byte
+// stream as they arrive. Realtime then acts on them from PendSV, which runs as soon as the rx interrupt returns
+// rather than whenever the main loop next gets round to parsing frames.
+#define REALTIME_FRAME_SIZE 10
+
+class RealtimeFilter {
+    public:
+        RealtimeFilter() : held(0) {}
+
+        // c is held back while it could still be part of a realtime frame. Returns the number of bytes released
+        // to out, which needs room for REALTIME_FRAME_SIZE. A completed realtime frame releases nothing and its
+        // command byte is returned in cmd instead, cmd is 0 otherwise.
+        int feed(uint8_t c, uint8_t *out, char &cmd);
+
+    private:
+        bool could_match() const;
+
+        uint8_t buf[REALTIME_FRAME_SIZE];
+        uint8_t held;
+};
+
+struct RealtimeLatency {
+    uint32_t count;
+    uint32_t last_us;
+    uint32_t max_us;
+    uint32_t total_us;
+
+    void add(uint32_t us);
+};
+
+// The status reply is built in PendSV from the live actuator positions plus a snapshot the main loop keeps: the
+// state, the offsets from actuator to machine and work positions, and the rest of the query string. The snapshot
+// is double buffered, the main loop only ever writes the copy PendSV is not using. Every REALTIME_REFRESH_US it
+// is rebuilt if a query was answered or deferred since the last time, hosts poll so the next one finds it fresh,
+// or if the state has changed. An idle machine nobody asks about is left alone.
+#define REALTIME_REFRESH_US 50000
+#define REALTIME_TAIL_SIZE  256
+
+class Realtime {
+    public:
+        enum { QUERY, HOLD, RESUME, ABORT, DEFERRED, NUM_LATENCIES };
+
+        Realtime(StreamOutput *stream);
+
+        static Realtime *getInstance() { return instance; }
+        static bool is_command(char c);
+
+        // from the rx interrupt
+        void post(char c);
+        // from PendSV
+        void handle();
+
+        // from the main loop, keeps the snapshot fresh while it is being used
+        void on_idle();
+        // the parts left to the main loop: ON_HALT after an abort, and status queries that came in while the
+        // stream was busy writing and have to be answered the slow way
+        bool take_halt();
+        bool take_query();
+
+        // the stream's own writes are bracketed by these so PendSV never writes in the middle of one
+        void begin_write() { writing++; }
+        void end_write() { writing--; }
+
+        void report(StreamOutput *out);
+
+        RealtimeLatency latency[NUM_LATENCIES];
+        uint32_t refreshes;             // of the snapshot
+
+    private:
+        struct snapshot_t {
+            uint8_t state;
+            float scale;                // from_millimeters for X Y Z
+            float mpos_offset[5];       // machine position - actuator position
+            float wpos_offset[5];       // work position - actuator position
+            char tail[REALTIME_TAIL_SIZE];
+        };
+
+        static Realtime *instance;
+
+        void refresh();
+        void send_status();
+        static void live_position(float *pos);
+
+        StreamOutput *stream;
+        snapshot_t snapshot[2];
+        uint8_t frame[5 + 160 + REALTIME_TAIL_SIZE + 4];
+        uint32_t checked_us;
+        volatile uint32_t posted_us[4];
+        volatile uint32_t deferred_us;
+        volatile uint8_t current;
+        volatile uint8_t writing;
+        volatile bool pending[4];
+        volatile bool halt_main;
+        volatile bool query_deferred;
+        volatile bool queried;          // since the last refresh
+        bool have_snapshot;
+};
+
+#endif /* _REALTIME_H */
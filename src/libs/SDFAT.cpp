@@ -1,12 +1,13 @@
 #include "SDFAT.h"
 
-SDFAT::SDFAT(const char *n, MSD_Disk *disk) : mbed::FATFileSystem(n)
+SDFAT::SDFAT(const char *n, MSD_Disk *disk) : mbed::FATFileSystem(n), cache(disk)
 {
     d = disk;
 }
 
 int SDFAT::disk_initialize()
 {
+    cache.invalidate();
     return d->disk_initialize();
 }
 
@@ -17,12 +18,13 @@ int SDFAT::disk_status()
 
 int SDFAT::disk_read(char *buffer, uint32_t sector, uint32_t count)
 {
-    return d->disk_read(buffer, sector, count);
+    cache.set_fat(_fs.fatbase, _fs.fs_type ? _fs.fsize * _fs.n_fats : 0);
+    return cache.read(buffer, sector, count);
 }
 
 int SDFAT::disk_write(const char *buffer, uint32_t sector, uint32_t count)
 {
-    return d->disk_write(buffer, sector, count);
+    return cache.write(buffer, sector, count);
 }
 
 int SDFAT::disk_sync()
@@ -35,6 +37,7 @@ int SDFAT::disk_sectors()
     return d->disk_sectors();
 }
 int SDFAT::remount() {
+    cache.invalidate();
     f_mount(_fsid, NULL);
     f_mount(_fsid, &_fs);
     
@@ -3,6 +3,7 @@
 
 #include "disk.h"
 #include "FATFileSystem.h"
+#include "SectorCache.h"
 
 class SDFAT : public mbed::FATFileSystem {
 public:
@@ -17,6 +18,9 @@ public:
 
     int remount();
 
+    // reads and writes go through this
+    SectorCache cache;
+
 protected:
     MSD_Disk *d;
 };
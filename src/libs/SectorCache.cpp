@@ -0,0 +1,188 @@
+#include "SectorCache.h"
+
+#include "disk.h"
+#include "StreamOutput.h"
+#include "platform_memory.h"
+
+#include <string.h>
+
+SectorCache::SectorCache(MSD_Disk *disk) : disk(disk), fat_base(0), fat_count(0), next(0), tick(0), tried(false)
+{
+    memset(lines, 0, sizeof(lines));
+    memset(fat, 0, sizeof(fat));
+    reset_stats();
+}
+
+SectorCache::~SectorCache()
+{
+    for (int i = 0; i < SECTORCACHE_LINES; ++i) if (lines[i].buf != NULL) AHB0.dealloc(lines[i].buf);
+    for (int i = 0; i < SECTORCACHE_FAT_SECTORS; ++i) if (fat[i].buf != NULL) AHB0.dealloc(fat[i].buf);
+}
+
+bool SectorCache::setup()
+{
+    if (!tried) {
+        tried = true;
+        for (int i = 0; i < SECTORCACHE_LINES; ++i) {
+            lines[i].buf = (char *)AHB0.alloc(SECTORCACHE_LINE_SECTORS * SECTORCACHE_SECTOR_SIZE);
+            lines[i].sectors = (lines[i].buf == NULL) ? 0 : SECTORCACHE_LINE_SECTORS;
+        }
+        for (int i = 0; i < SECTORCACHE_FAT_SECTORS; ++i) {
+            fat[i].buf = (char *)AHB0.alloc(SECTORCACHE_SECTOR_SIZE);
+            fat[i].sectors = (fat[i].buf == NULL) ? 0 : 1;
+        }
+    }
+    return lines[0].buf != NULL || fat[0].buf != NULL;
+}
+
+uint32_t SectorCache::memory() const
+{
+    uint32_t sectors = 0;
+    for (int i = 0; i < SECTORCACHE_LINES; ++i) sectors += lines[i].sectors;
+    for (int i = 0; i < SECTORCACHE_FAT_SECTORS; ++i) sectors += fat[i].sectors;
+    return sectors * SECTORCACHE_SECTOR_SIZE;
+}
+
+void SectorCache::set_fat(uint32_t base, uint32_t count)
+{
+    fat_base = base;
+    fat_count = count;
+}
+
+bool SectorCache::is_fat(uint32_t sector) const
+{
+    return fat_count > 0 && sector >= fat_base && sector - fat_base < fat_count;
+}
+
+void SectorCache::invalidate()
+{
+    for (int i = 0; i < SECTORCACHE_LINES; ++i) lines[i].count = 0;
+    for (int i = 0; i < SECTORCACHE_FAT_SECTORS; ++i) fat[i].count = 0;
+    next = 0;
+}
+
+SectorCache::line_t *SectorCache::find(uint32_t sector, uint32_t count)
+{
+    line_t *set = (count == 1 && is_fat(sector)) ? fat : lines;
+    int n = (set == fat) ? SECTORCACHE_FAT_SECTORS : SECTORCACHE_LINES;
+    for (int i = 0; i < n; ++i) {
+        line_t &l = set[i];
+        if (l.count > 0 && sector >= l.start && sector + count <= l.start + l.count) return &l;
+    }
+    return NULL;
+}
+
+// an empty one, else the least recently used
+SectorCache::line_t *SectorCache::victim(line_t *set, int n)
+{
+    line_t *best = NULL;
+    for (int i = 0; i < n; ++i) {
+        line_t &l = set[i];
+        if (l.buf == NULL) continue;
+        if (l.count == 0) return &l;
+        if (best == NULL || tick - l.used > tick - best->used) best = &l;
+    }
+    return best;
+}
+
+int SectorCache::read_fat(char *buffer, uint32_t sector)
+{
+    line_t *l = find(sector, 1);
+    if (l != NULL) {
+        fat_hits++;
+    } else {
+        l = victim(fat, SECTORCACHE_FAT_SECTORS);
+        l->count = 0;
+        int res = disk->disk_read(l->buf, sector, 1);
+        if (res != 0) return res;
+        l->start = sector;
+        l->count = 1;
+        fat_misses++;
+    }
+    l->used = ++tick;
+    memcpy(buffer, l->buf, SECTORCACHE_SECTOR_SIZE);
+    return 0;
+}
+
+int SectorCache::read(char *buffer, uint32_t sector, uint32_t count)
+{
+    if (lines[0].buf == NULL && fat[0].buf == NULL) return disk->disk_read(buffer, sector, count);
+
+    if (count == 1 && is_fat(sector) && fat[0].buf != NULL) return read_fat(buffer, sector);
+
+    bool sequential = (sector == next);
+    next = sector + count;
+    if (count > SECTORCACHE_LINE_SECTORS || lines[0].buf == NULL) {
+        bypassed += count;
+        return disk->disk_read(buffer, sector, count);
+    }
+
+    line_t *l = find(sector, count);
+    if (l != NULL) {
+        hits += count;
+    } else {
+        l = victim(lines, SECTORCACHE_LINES);
+        l->count = 0;
+        uint32_t n = sequential ? l->sectors : count;
+        int res = disk->disk_read(l->buf, sector, n);
+        if (res != 0 && n > count) {
+            // the read ahead may run past the end of the card
+            n = count;
+            res = disk->disk_read(l->buf, sector, n);
+        }
+        if (res != 0) return res;
+        l->start = sector;
+        l->count = n;
+        misses += count;
+        prefetched += n - count;
+    }
+    l->used = ++tick;
+    memcpy(buffer, l->buf + (sector - l->start) * SECTORCACHE_SECTOR_SIZE, count * SECTORCACHE_SECTOR_SIZE);
+    return 0;
+}
+
+// brings cached copies of the sectors written up to date, or drops them if the write failed
+void SectorCache::update(line_t *set, int n, const char *buffer, uint32_t sector, uint32_t count, bool ok)
+{
+    for (int i = 0; i < n; ++i) {
+        line_t &l = set[i];
+        if (l.count == 0 || sector >= l.start + l.count || sector + count <= l.start) continue;
+        if (!ok) {
+            l.count = 0;
+            continue;
+        }
+        uint32_t from = (sector > l.start) ? sector : l.start;
+        uint32_t to = (sector + count < l.start + l.count) ? sector + count : l.start + l.count;
+        memcpy(l.buf + (from - l.start) * SECTORCACHE_SECTOR_SIZE, buffer + (from - sector) * SECTORCACHE_SECTOR_SIZE,
+               (to - from) * SECTORCACHE_SECTOR_SIZE);
+    }
+}
+
+int SectorCache::write(const char *buffer, uint32_t sector, uint32_t count)
+{
+    int res = disk->disk_write(buffer, sector, count);
+    update(lines, SECTORCACHE_LINES, buffer, sector, count, res == 0);
+    update(fat, SECTORCACHE_FAT_SECTORS, buffer, sector, count, res == 0);
+    return res;
+}
+
+void SectorCache::report(StreamOutput *out) const
+{
+    int lines_ok = 0, fat_ok = 0;
+    for (int i = 0; i < SECTORCACHE_LINES; ++i) if (lines[i].buf != NULL) lines_ok++;
+    for (int i = 0; i < SECTORCACHE_FAT_SECTORS; ++i) if (fat[i].buf != NULL) fat_ok++;
+
+    uint32_t reads = hits + misses;
+    uint32_t fat_reads = fat_hits + fat_misses;
+    out->printf("data  %d lines, %lu hits, %lu misses (%lu%% hit), %lu read ahead, %lu bypassed\r\n",
+                lines_ok, hits, misses, reads ? (unsigned long)((uint64_t)hits * 100 / reads) : 0UL, prefetched, bypassed);
+    out->printf("fat   %d sectors, %lu hits, %lu misses (%lu%% hit)\r\n",
+                fat_ok, fat_hits, fat_misses, fat_reads ? (unsigned long)((uint64_t)fat_hits * 100 / fat_reads) : 0UL);
+}
+
+void SectorCache::reset_stats()
+{
+    hits = misses = prefetched = 0;
+    fat_hits = fat_misses = 0;
+    bypassed = 0;
+}
@@ -0,0 +1,75 @@
+#ifndef _SECTORCACHE_H
+#define _SECTORCACHE_H
+
+#include <stdint.h>
+
+class MSD_Disk;
+class StreamOutput;
+
+// Sector cache between FatFs and the card.
+// Data sectors are kept in SECTORCACHE_LINES lines of SECTORCACHE_LINE_SECTORS sectors, replaced least
+// recently used first. A read that misses right after the previous one ended is taken as sequential and
+// fills a whole line, so the sectors after it are already there when FatFs asks for them; reads larger
+// than a line go straight to the card. FAT sectors have SECTORCACHE_FAT_SECTORS slots of their own so
+// streaming data never pushes them out. Writes go through to the card and update any cached copy.
+// The buffers are borrowed from AHB0 by setup(), which main calls once the block queue has its ring, until then
+// everything goes straight to the card. The cache makes do with what it gets.
+#define SECTORCACHE_SECTOR_SIZE  512
+#define SECTORCACHE_LINES        3
+#define SECTORCACHE_LINE_SECTORS 4
+#define SECTORCACHE_FAT_SECTORS  2
+
+class SectorCache {
+    public:
+        SectorCache(MSD_Disk *disk);
+        ~SectorCache();
+
+        // borrows the buffers, false if there was no room for any
+        bool setup();
+        // bytes of AHB0 the buffers take
+        uint32_t memory() const;
+
+        int read(char *buffer, uint32_t sector, uint32_t count);
+        int write(const char *buffer, uint32_t sector, uint32_t count);
+
+        // where the FATs are, count 0 until the volume is mounted
+        void set_fat(uint32_t base, uint32_t count);
+        // forget everything, for a new card or a remount
+        void invalidate();
+
+        void report(StreamOutput *out) const;
+        void reset_stats();
+
+        uint32_t hits;          // sectors read from the cache
+        uint32_t misses;        // sectors read from the card
+        uint32_t prefetched;    // sectors read ahead of being asked for
+        uint32_t fat_hits;
+        uint32_t fat_misses;
+        uint32_t bypassed;      // sectors of reads too big to cache
+
+    private:
+        struct line_t {
+            char *buf;
+            uint32_t start;
+            uint16_t count;     // valid sectors from start, 0 if empty
+            uint16_t sectors;   // room in buf
+            uint32_t used;
+        };
+
+        bool is_fat(uint32_t sector) const;
+        int read_fat(char *buffer, uint32_t sector);
+        line_t *find(uint32_t sector, uint32_t count);
+        line_t *victim(line_t *lines, int n);
+        void update(line_t *lines, int n, const char *buffer, uint32_t sector, uint32_t count, bool ok);
+
+        MSD_Disk *disk;
+        line_t lines[SECTORCACHE_LINES];
+        line_t fat[SECTORCACHE_FAT_SECTORS];
+        uint32_t fat_base;
+        uint32_t fat_count;
+        uint32_t next;          // the sector after the last read
+        uint32_t tick;
+        bool tried;
+};
+
+#endif /* _SECTORCACHE_H */
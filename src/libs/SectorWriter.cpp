@@ -0,0 +1,86 @@
+#include "SectorWriter.h"
+
+#include "platform_memory.h"
+
+#include <string.h>
+
+SectorWriter::SectorWriter() : total(0), direct(0), fd(NULL), stage(NULL), stage_size(0), staged(0)
+{
+}
+
+SectorWriter::~SectorWriter()
+{
+    if (stage != NULL && stage != sector) AHB0.dealloc(stage);
+}
+
+void SectorWriter::attach(FILE *fd)
+{
+    this->fd = fd;
+    total = direct = 0;
+    staged = 0;
+
+    // no stdio buffer, every write goes straight to FatFs
+    setvbuf(fd, NULL, _IONBF, 0);
+
+    if (stage == NULL) {
+        // fall back to a single sector if AHB0 is too full
+        stage = (uint8_t *)AHB0.alloc(SECTORWRITER_STAGE_SIZE);
+        stage_size = SECTORWRITER_STAGE_SIZE;
+        if (stage == NULL) {
+            stage = sector;
+            stage_size = sizeof(sector);
+        }
+    }
+}
+
+bool SectorWriter::reserve(uint32_t size)
+{
+    if (fd == NULL || total > 0) return false;
+
+    // FatFs allocates the clusters up to a seek past the end of a file open for writing
+    if (fseek(fd, size, SEEK_SET) != 0) return false;
+    return fseek(fd, 0, SEEK_SET) == 0;
+}
+
+bool SectorWriter::write_out(const uint8_t *data, size_t len)
+{
+    return fwrite(data, 1, len, fd) == len;
+}
+
+bool SectorWriter::write(const uint8_t *data, size_t len)
+{
+    if (fd == NULL) return false;
+
+    while (len > 0) {
+        // the file position is a multiple of the stage size whenever nothing is staged
+        if (staged == 0 && len >= stage_size) {
+            size_t n = len - len % stage_size;
+            if (!write_out(data, n)) return false;
+            direct += n;
+            total += n;
+            data += n;
+            len -= n;
+            continue;
+        }
+
+        size_t n = stage_size - staged;
+        if (n > len) n = len;
+        memcpy(&stage[staged], data, n);
+        staged += n;
+        total += n;
+        data += n;
+        len -= n;
+        if (staged == stage_size && !flush()) return false;
+    }
+    return true;
+}
+
+bool SectorWriter::flush()
+{
+    if (fd == NULL) return false;
+    if (staged == 0) return true;
+
+    bool ok = write_out(stage, staged);
+    staged = 0;
+    return ok;
+}
@@ -0,0 +1,44 @@
+#ifndef _SECTORWRITER_H
+#define _SECTORWRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Writes a stream of arbitrary sized chunks to a file in whole sectors.
+// The file is made unbuffered and written in SECTORWRITER_STAGE_SIZE blocks at offsets that are a
+// multiple of it, so no block crosses a cluster and FatFs sends each one to the card as a single
+// multi-block write. Whenever nothing is staged, the whole blocks of a chunk go from the caller's
+// buffer straight to FatFs. Only the rest is copied, into a stage buffer borrowed from AHB0, and
+// that is written out once it is full or on flush().
+// When the final size is known up front reserve() allocates the file's clusters in one go.
+#define SECTORWRITER_SECTOR_SIZE 512
+#define SECTORWRITER_STAGE_SIZE  4096
+
+class SectorWriter {
+    public:
+        SectorWriter();
+        ~SectorWriter();
+
+        // takes over writing to fd, which must not have been written to yet
+        void attach(FILE *fd);
+        // grows the file to size before anything is written, what is not written is cut off on close
+        bool reserve(uint32_t size);
+        bool write(const uint8_t *data, size_t len);
+        // writes out whatever is staged, call before closing the file
+        bool flush();
+
+        uint32_t total;         // bytes written
+        uint32_t direct;        // of which went out without being copied
+
+    private:
+        bool write_out(const uint8_t *data, size_t len);
+
+        FILE *fd;
+        uint8_t *stage;
+        size_t stage_size;
+        size_t staged;
+        uint8_t sector[SECTORWRITER_SECTOR_SIZE];
+};
+
+#endif /* _SECTORWRITER_H */
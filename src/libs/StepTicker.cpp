@@ -15,6 +15,7 @@
 #include "StreamOutputPool.h"
 #include "Block.h"
 #include "Conveyor.h"
+#include "Realtime.h"
 
 #include "system_LPC17xx.h" // mbed.h lib
 #include <math.h>
@@ -121,6 +122,10 @@ extern "C" void TIMER0_IRQHandler (void)
 extern "C" void PendSV_Handler(void)
 {
     StepTicker::getInstance()->handle_finish();
+
+    // realtime commands taken out of the serial input by the rx interrupt
+    Realtime *rt = Realtime::getInstance();
+    if (rt != nullptr) rt->handle();
 }
 
 // slightly lower priority than TIMER0, the whole end of block/start of block is done here allowing the timer to continue ticking
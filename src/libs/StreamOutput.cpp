@@ -1,4 +1,5 @@
 #include "StreamOutput.h"
+#include "Crc16.h"
 
 
 extern unsigned char fbuff[4096];
@@ -6,32 +7,24 @@ extern unsigned char fbuff[4096];
 #define FOOTER        0x55AA
 #define PTYPE_NORMAL_INFO	0x90
 
-extern const unsigned short crc_table[256];
 NullStreamOutput StreamOutput::NullStream;
-unsigned int StreamOutput::crc16_ccitt(unsigned char *data, unsigned int len)
+void StreamOutput::PacketMessage(char cmd, const char* s, int size)
 {
-	unsigned char tmp;
-	unsigned short crc = 0;
-
-	for (unsigned int i = 0; i < len; i ++) {
-        tmp = ((crc >> 8) ^ data[i]) & 0xff;
-        crc = ((crc << 8) ^ crc_table[tmp]) & 0xffff;
-	}
-
-	return crc & 0xffff;
+	size_t total_length = size == 0 ? strlen(s) : size;
+	memcpy(&fbuff[5], s, total_length);
+	puts((char *)fbuff, frame_payload(cmd, total_length));
 }
 
-void StreamOutput::PacketMessage(char cmd, const char* s, int size)
+// wraps the payload already at fbuff[5] into a frame, returns the length of the whole frame
+size_t StreamOutput::frame_payload(char cmd, size_t total_length)
 {
 	int crc = 0;
     unsigned int len = 0;
-	size_t total_length = size == 0 ? strlen(s) : size;
 	
 	fbuff[0] = (HEADER>>8)&0xFF;
 	fbuff[1] = HEADER&0xFF;
 	fbuff[4] = cmd;
 	
-	memcpy(&fbuff[5], s, total_length);
 	len = total_length + 3;
 	fbuff[2] = (len>>8)&0xFF;
 	fbuff[3] = len&0xFF;
@@ -41,7 +34,7 @@ void StreamOutput::PacketMessage(char cmd, const char* s, int size)
 	fbuff[total_length+7] = (FOOTER>>8)&0xFF;
 	fbuff[total_length+8] = FOOTER&0xFF;
 	
-	puts((char *)fbuff, len+6);
+	return len+6;
 }
 int StreamOutput::printf(const char *format, ...)
 {
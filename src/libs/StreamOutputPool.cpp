@@ -0,0 +1,22 @@
+#include "StreamOutputPool.h"
+
+#define PTYPE_NORMAL_INFO	0x90
+
+extern unsigned char fbuff[4096];
+
+int StreamOutputPool::printf(const char *format, ...)
+{
+    // the message is formatted straight into the payload of the frame, header and crc go around it
+    // in place, so there is no intermediate buffer and no heap allocation for long messages
+    const size_t max_len = sizeof(fbuff) - 9;
+    va_list args;
+    va_start(args, format);
+    int size = vsnprintf((char *)&fbuff[5], max_len + 1, format, args);
+    va_end(args);
+
+    if (size <= 0) return 0;
+    size_t len = (size_t)size > max_len ? max_len : size;
+
+    puts((char *)fbuff, frame_payload(PTYPE_NORMAL_INFO, len));
+    return size;
+}
@@ -22,11 +22,15 @@ public:
     StreamOutputPool(){
     }
 
+    // formatted and framed once, every stream is handed the same bytes
+    int printf(const char *format, ...) __attribute__ ((format(printf, 2, 3)));
+
     int puts(const char* s, int size)
     {
         int r = 0;
         for(set<StreamOutput*>::iterator i = this->streams.begin(); i != this->streams.end(); i++)
         {
+            if (!(*i)->connected()) continue;
             int k = (*i)->puts(s,size);
             if (k > r)
                 r = k;
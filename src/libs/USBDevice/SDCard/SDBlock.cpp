@@ -0,0 +1,118 @@
+/* SD/MMC File System Library
+ * Copyright (c) 2016 Neil Thiessen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SDDma.h"
+#include "SDCRC.h"
+#include "us_ticker_api.h"
+
+namespace SDBlock
+{
+
+namespace
+{
+bool waitToken(SDBus& bus)
+{
+    //Wait for up to 500ms for a token to arrive
+    uint32_t start = us_ticker_read();
+    char token;
+    do {
+        token = bus.transfer(0xFF);
+    } while (token == (char)0xFF && us_ticker_read() - start < 500000);
+
+    //Check if a valid start block token was received
+    return token == (char)0xFE;
+}
+
+bool waitReady(SDBus& bus)
+{
+    //Wait for up to 500ms for the card to stop holding DO low
+    uint32_t start = us_ticker_read();
+    do {
+        if (bus.transfer(0xFF) == (char)0xFF)
+            return true;
+    } while (us_ticker_read() - start < 500000);
+    return false;
+}
+
+unsigned short readCrc(SDBus& bus)
+{
+    unsigned short crc = (bus.transfer(0xFF) & 0xFF) << 8;
+    crc |= bus.transfer(0xFF) & 0xFF;
+    return crc;
+}
+}
+
+bool read(SDBus& bus, char* buffer, int length, bool crc)
+{
+    if (!waitToken(bus))
+        return false;
+
+    bus.start(NULL, buffer, length);
+    while (!bus.done());
+
+    //Return the validity of the CRC16 checksum (if enabled)
+    unsigned short received = readCrc(bus);
+    return (!crc || received == SDCRC::crc16(buffer, length));
+}
+
+int readMultiple(SDBus& bus, char* buffer, int count, bool crc)
+{
+    unsigned short received = 0;
+    for (int i = 0; i < count; i++) {
+        char* block = buffer + (i << 9);
+        bool arrived = waitToken(bus);
+        if (arrived)
+            bus.start(NULL, block, 512);
+
+        //Check the previous block while this one comes in
+        bool good = (i == 0 || !crc || received == SDCRC::crc16(block - 512, 512));
+
+        if (arrived) {
+            while (!bus.done());
+            received = readCrc(bus);
+        }
+
+        if (!good)
+            return i - 1;
+        if (!arrived)
+            return i;
+    }
+
+    if (count > 0 && crc && received != SDCRC::crc16(buffer + ((count - 1) << 9), 512))
+        return count - 1;
+    return count;
+}
+
+char write(SDBus& bus, const char* buffer, char token, bool crc)
+{
+    //Wait for up to 500ms for the card to become ready
+    if (!waitReady(bus))
+        return false;
+
+    //Send the start block token, then the block, with the CRC16 worked out (if enabled) while it goes
+    bus.transfer(token);
+    bus.start(buffer, NULL, 512);
+    unsigned short sum = crc ? SDCRC::crc16(buffer, 512) : 0xFFFF;
+    while (!bus.done());
+
+    bus.transfer(sum >> 8);
+    bus.transfer(sum);
+
+    //Return the data response token
+    return (bus.transfer(0xFF) & 0x1F);
+}
+
+}
@@ -0,0 +1,88 @@
+/* SD/MMC File System Library
+ * Copyright (c) 2016 Neil Thiessen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SDDma.h"
+
+//Channels 6 and 7 are the lowest priority ones, receive gets the higher of the two so its FIFO never overruns
+#define SD_DMA_RX LPC_GPDMACH6
+#define SD_DMA_TX LPC_GPDMACH7
+#define SD_DMA_RX_BIT (1 << 6)
+#define SD_DMA_TX_BIT (1 << 7)
+
+#define SSP_SR_TNF (1 << 1)
+#define SSP_SR_RNE (1 << 2)
+
+namespace
+{
+//Sent when there is nothing to send, and where unwanted bytes go
+const char m_Dummy = 0xFF;
+char m_Sink;
+}
+
+SDGPDMA::SDGPDMA(LPC_SSP_TypeDef* ssp) : m_Ssp(ssp), m_Busy(false)
+{
+    //Power up the GPDMA and enable it, little endian
+    LPC_SC->PCONP |= (1 << 29);
+    LPC_GPDMA->DMACConfig = 1;
+}
+
+char SDGPDMA::transfer(char out)
+{
+    while (!(m_Ssp->SR & SSP_SR_TNF));
+    m_Ssp->DR = out;
+    while (!(m_Ssp->SR & SSP_SR_RNE));
+    return m_Ssp->DR;
+}
+
+void SDGPDMA::start(const char* tx, char* rx, int length)
+{
+    //DMA request lines 0 and 1 are SSP0 transmit and receive, 2 and 3 SSP1
+    uint32_t conn = (m_Ssp == LPC_SSP0) ? 0 : 2;
+
+    LPC_GPDMA->DMACIntTCClear = SD_DMA_RX_BIT | SD_DMA_TX_BIT;
+    LPC_GPDMA->DMACIntErrClr = SD_DMA_RX_BIT | SD_DMA_TX_BIT;
+
+    //Everything clocked in is read out of the FIFO, so done() is simply the receive channel finishing
+    SD_DMA_RX->DMACCSrcAddr = (uint32_t)&m_Ssp->DR;
+    SD_DMA_RX->DMACCDestAddr = (uint32_t)(rx != NULL ? rx : &m_Sink);
+    SD_DMA_RX->DMACCLLI = 0;
+    SD_DMA_RX->DMACCControl = (length & 0xFFF)  //Transfer size, single byte bursts and widths
+                            | ((rx != NULL) ? (1 << 27) : 0);   //Destination increment
+    SD_DMA_TX->DMACCSrcAddr = (uint32_t)(tx != NULL ? tx : &m_Dummy);
+    SD_DMA_TX->DMACCDestAddr = (uint32_t)&m_Ssp->DR;
+    SD_DMA_TX->DMACCLLI = 0;
+    SD_DMA_TX->DMACCControl = (length & 0xFFF)
+                            | ((tx != NULL) ? (1 << 26) : 0);   //Source increment
+
+    m_Ssp->DMACR = 0x3;
+    SD_DMA_RX->DMACCConfig = 1 | ((conn + 1) << 1) | (2 << 11);   //Enabled, from the SSP, peripheral to memory
+    SD_DMA_TX->DMACCConfig = 1 | (conn << 6) | (1 << 11);         //Enabled, to the SSP, memory to peripheral
+    m_Busy = true;
+}
+
+bool SDGPDMA::done()
+{
+    if (!m_Busy)
+        return true;
+
+    //The enable bit clears itself when the channel has moved the whole block
+    if ((SD_DMA_RX->DMACCConfig & 1) || (SD_DMA_TX->DMACCConfig & 1))
+        return false;
+
+    m_Ssp->DMACR = 0;
+    m_Busy = false;
+    return true;
+}
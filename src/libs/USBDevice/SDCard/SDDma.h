@@ -0,0 +1,91 @@
+/* SD/MMC File System Library
+ * Copyright (c) 2016 Neil Thiessen
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SD_DMA_H
+#define SD_DMA_H
+
+#include "mbed.h"
+
+/** The data phase of SD block transfers.
+ *  SDBus is the card's SPI bus as the block code sees it: single bytes for tokens and responses, and whole
+ *  blocks started with start() that move without the CPU until done(). SDGPDMA does this with the LPC17xx
+ *  GPDMA, tests drive the SDBlock functions with a bus of their own that plays the card.
+ */
+class SDBus
+{
+public:
+    virtual ~SDBus() {}
+
+    /** Clock one byte out and return the byte clocked in
+     */
+    virtual char transfer(char out) = 0;
+
+    /** Start clocking a block of bytes
+     *
+     * @param tx The bytes to send, NULL sends 0xFF.
+     * @param rx Where to put the bytes received, NULL drops them.
+     * @param length The number of bytes, at most 4095.
+     */
+    virtual void start(const char* tx, char* rx, int length) = 0;
+
+    /** Whether the block started last has been clocked completely
+     */
+    virtual bool done() = 0;
+};
+
+/** SDBus on an LPC17xx SSP with two GPDMA channels, one feeding the transmit FIFO and one emptying the
+ *  receive FIFO, so bytes go out back to back instead of one round trip per byte.
+ */
+class SDGPDMA : public SDBus
+{
+public:
+    /** @param ssp The SSP the card is on, it must already be set up for 8 bit frames.
+     */
+    SDGPDMA(LPC_SSP_TypeDef* ssp);
+
+    virtual char transfer(char out);
+    virtual void start(const char* tx, char* rx, int length);
+    virtual bool done();
+
+private:
+    LPC_SSP_TypeDef* m_Ssp;
+    bool m_Busy;
+};
+
+namespace SDBlock
+{
+
+/** Read the data block of a CMD17, from the start token to the CRC
+ *
+ * @returns 'true' if the block arrived and, when crc is set, its CRC16 matched.
+ */
+bool read(SDBus& bus, char* buffer, int length, bool crc);
+
+/** Read count blocks of a CMD18. The CRC of each block is checked while the next one is being clocked in.
+ *
+ * @returns The number of blocks read correctly from the start of buffer.
+ */
+int readMultiple(SDBus& bus, char* buffer, int count, bool crc);
+
+/** Write one 512 byte data block with the given start token. The CRC is worked out while the block goes out.
+ *
+ * @returns The data response token, 0x05 if the card accepted the block.
+ */
+char write(SDBus& bus, const char* buffer, char token, bool crc);
+
+}
+
+#endif
@@ -21,6 +21,7 @@
 
 SDFileSystem::SDFileSystem(PinName mosi, PinName miso, PinName sclk, PinName cs, int hz) : 
 	  m_Spi(mosi, miso, sclk),
+      m_Dma((sclk == P0_7) ? LPC_SSP1 : LPC_SSP0),
       m_Cs(cs),
       m_Cd(NC),
       m_FREQ(hz)
@@ -33,6 +34,7 @@ SDFileSystem::SDFileSystem(PinName mosi, PinName miso, PinName sclk, PinName cs,
     m_Crc = false;
     m_LargeFrames = false;
     m_WriteValidation = true;
+    m_UseDma = true;
     m_Status = STA_NOINIT;
 
     //Enable the internal pull-up resistor on MISO
@@ -134,6 +136,18 @@ void SDFileSystem::write_validation(bool enabled)
     m_WriteValidation = enabled;
 }
 
+bool SDFileSystem::dma()
+{
+    //Return whether or not data blocks are moved by DMA
+    return m_UseDma;
+}
+
+void SDFileSystem::dma(bool enabled)
+{
+    //Set whether or not data blocks are moved by DMA
+    m_UseDma = enabled;
+}
+
 int SDFileSystem::unmount()
 {
     //Unmount the filesystem
@@ -429,7 +443,7 @@ uint32_t SDFileSystem::disk_sectors()
 }
 uint64_t SDFileSystem::disk_size() { return ((uint64_t)disk_sectors() << 9); }
 uint32_t SDFileSystem::disk_blocksize() { return (1<<9); }
-bool SDFileSystem::disk_canDMA() { return false; }
+bool SDFileSystem::disk_canDMA() { return m_UseDma; }
 	
 bool SDFileSystem::busy()
 {
@@ -604,6 +618,10 @@ bool SDFileSystem::readData(char* buffer, int length)
     char token;
     unsigned short crc;
 
+    //Let the GPDMA move the block if enabled
+    if (m_UseDma)
+        return SDBlock::read(m_Dma, buffer, length, m_Crc);
+
     //Wait for up to 500ms for a token to arrive
     m_Timer.start();
     do {
@@ -650,6 +668,10 @@ bool SDFileSystem::readData(char* buffer, int length)
 
 char SDFileSystem::writeData(const char* buffer, char token)
 {
+    //Let the GPDMA move the block if enabled, the CRC16 is worked out while it goes
+    if (m_UseDma)
+        return SDBlock::write(m_Dma, buffer, token, m_Crc);
+
     //Calculate the CRC16 checksum for the data block (if enabled)
     unsigned short crc = (m_Crc) ? SDCRC::crc16(buffer, 512) : 0xFFFF;
 
@@ -728,19 +750,33 @@ inline bool SDFileSystem::readBlocks(char* buffer, unsigned int lba, unsigned in
 
         //Send CMD18(block) to read multiple blocks
         if (writeCommand(CMD18, (m_CardType == CARD_SDHC) ? lba : lba << 9) == 0x00) {
-            //Try to read all of the data blocks
-            do {
-                //Read the next block, and break on errors
-                if (!readData(buffer, 512)) {
-                    f++;
-                    break;
-                }
+            if (m_UseDma) {
+                //Read as many blocks as possible, each one's CRC16 is checked while the next arrives
+                int n = SDBlock::readMultiple(m_Dma, buffer, count, m_Crc);
 
                 //Update the variables
-                lba++;
-                buffer += 512;
-                f = 0;
-            } while (--count);
+                lba += n;
+                buffer += n << 9;
+                count -= n;
+                if (n > 0)
+                    f = 0;
+                if (count != 0)
+                    f++;
+            } else {
+                //Try to read all of the data blocks
+                do {
+                    //Read the next block, and break on errors
+                    if (!readData(buffer, 512)) {
+                        f++;
+                        break;
+                    }
+
+                    //Update the variables
+                    lba++;
+                    buffer += 512;
+                    f = 0;
+                } while (--count);
+            }
 
             //Send CMD12(0x00000000) to stop the transmission
             if (writeCommand(CMD12, 0x00000000) != 0x00) {
@@ -779,11 +815,11 @@ inline bool SDFileSystem::writeBlock(const char* buffer, unsigned int lba)
             char token = writeData(buffer, 0xFE);
             deselect();
 
-            //Check the data response token
-            if (token == 0x0A) {
+            //Check the data response token, xxx0sss1 with the status 101 for a CRC error and 110 for a write error
+            if (token == 0x0B) {
                 //A CRC error occured, try again
                 continue;
-            } else if (token == 0x0C) {
+            } else if (token == 0x0D) {
                 //A write error occured, get out
                 break;
             }
@@ -829,6 +865,11 @@ inline bool SDFileSystem::writeBlocks(const char* buffer, unsigned int lba, unsi
             }
         }
 
+        //ACMD22 counts the blocks written since this CMD25
+        const char* startBuffer = currentBuffer;
+        unsigned int startLba = currentLba;
+        int startCount = currentCount;
+
         //Select the card, and wait for ready
         if(!select())
             break;
@@ -881,7 +922,7 @@ inline bool SDFileSystem::writeBlocks(const char* buffer, unsigned int lba, unsi
                 deselect();
 
                 //Check the error token
-                if (token == 0x0A) {
+                if (token == 0x0B) {
                     //Determine the number of well written blocks if possible
                     unsigned int writtenBlocks = 0;
                     if (m_CardType != CARD_MMC && select()) {
@@ -901,9 +942,9 @@ inline bool SDFileSystem::writeBlocks(const char* buffer, unsigned int lba, unsi
                     }
 
                     //Roll back the variables based on the number of well written blocks
-                    currentBuffer = buffer + (writtenBlocks << 9);
-                    currentLba = lba + writtenBlocks;
-                    currentCount = count - writtenBlocks;
+                    currentBuffer = startBuffer + (writtenBlocks << 9);
+                    currentLba = startLba + writtenBlocks;
+                    currentCount = startCount - writtenBlocks;
 
                     //Try again
                     continue;
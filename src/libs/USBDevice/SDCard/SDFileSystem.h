@@ -20,6 +20,7 @@
 #include "mbed.h"
 #include "gpio.h"
 #include "disk.h"
+#include "SDDma.h"
 //#include "FATFileSystem.h"
 
 /** SDFileSystem class.
@@ -162,6 +163,20 @@ public:
      */
     void write_validation(bool enabled);
 
+    /** Get whether or not data blocks are moved by DMA
+     *
+     * @returns
+     *   'true' if data blocks are moved by the GPDMA,
+     *   'false' if every byte goes through the CPU.
+     */
+    bool dma();
+
+    /** Set whether or not data blocks are moved by DMA
+     *
+     * @param enabled Whether or not to use the GPDMA for data blocks.
+     */
+    void dma(bool enabled);
+
     virtual int unmount();
     virtual int disk_initialize();
     virtual int disk_write(const char *buffer, uint32_t sector, uint32_t count);
@@ -201,6 +216,7 @@ private:
     //Member variables
     Timer m_Timer;
     mbed::SPI m_Spi;
+    SDGPDMA m_Dma;
     GPIO m_Cs;
     InterruptIn m_Cd;
     int m_CdAssert;
@@ -209,6 +225,7 @@ private:
     bool m_Crc;
     bool m_LargeFrames;
     bool m_WriteValidation;
+    bool m_UseDma;
     int m_Status;
 
     //Internal methods
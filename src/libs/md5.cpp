@@ -145,9 +145,14 @@ void MD5::init()
 // decodes input (unsigned char) into output (uint4). Assumes len is a multiple of 4.
 void MD5::decode(uint4 output[], const uint1 input[], size_type len)
 {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // the Cortex-M3 is little endian and handles unaligned loads, so this is a plain copy
+    memcpy(output, input, len);
+#else
     for (unsigned int i = 0, j = 0; j < len; i++, j += 4)
         output[i] = ((uint4)input[j]) | (((uint4)input[j + 1]) << 8) |
                     (((uint4)input[j + 2]) << 16) | (((uint4)input[j + 3]) << 24);
+#endif
 }
 
 //////////////////////////////
@@ -248,9 +253,6 @@ void MD5::transform(const uint1 block[blocksize])
     state[1] += b;
     state[2] += c;
     state[3] += d;
-
-    // Zeroize sensitive information.
-    memset(x, 0, sizeof x);
 }
 
 //////////////////////////////
@@ -23,6 +23,7 @@
 #include "modules/utils/simpleshell/SimpleShell.h"
 #include "modules/utils/configurator/Configurator.h"
 #include "modules/utils/player/Player.h"
+#include "modules/utils/jobanalyzer/JobAnalyzer.h"
 #include "modules/utils/mainbutton/MainButton.h"
 #include "modules/communication/SerialConsole2.h"
 #include "libs/USBDevice/MSCFileSystem.h"
@@ -50,11 +51,13 @@
 
 #include "libs/Watchdog.h"
 
+#include "BootProfile.h"
 #include "version.h"
 #include "system_LPC17xx.h"
 #include "platform_memory.h"
 
 #include "mbed.h"
+#include "us_ticker_api.h"
 
 // disable MSD
 #define DISABLEMSD
@@ -90,6 +93,7 @@ GPIO leds[4] = {
 };
 
 void init() {
+    BootStep step("init");
 
     // Default pins to low status
     for (int i = 0; i < 4; i++){
@@ -128,12 +132,16 @@ void init() {
     vCharge = 1;
     */
 
+    uint32_t start = us_ticker_read();
     Kernel* kernel = new Kernel();
+    BootProfile::record("kernel", start);
 
     // kernel->streams->printf("Smoothie Running @%ldMHz\r\n", SystemCoreClock / 1000000);
     SimpleShell::version_command("", kernel->streams);
 
+    start = us_ticker_read();
     bool sdok = (sd.disk_initialize() == 0);
+    BootProfile::record("sd card", start);
     if(!sdok) kernel->streams->printf("SDCard failed to initialize\r\n");
 
     #ifdef NONETWORK
@@ -160,27 +168,30 @@ void init() {
 #endif
 
     // Create and add main modules
-    kernel->add_module( new(AHB0) Player() );
+    kernel->add_module( new(AHB0) Player(), "player" );
+    kernel->add_module( new(AHB0) JobAnalyzer(), "job analyzer" );
 
     // ATC Handler
-    kernel->add_module( new(AHB0) ATCHandler() );
+    kernel->add_module( new(AHB0) ATCHandler(), "atc" );
 
     // MSC File System Handler
 //    kernel->add_module( new(AHB0) MSCFileSystem("ud") );
 
     // Serial Console 2
-    kernel->add_module( new(AHB0) SerialConsole2() );
+    kernel->add_module( new(AHB0) SerialConsole2(), "serial console 2" );
 
-    kernel->add_module( new(AHB0) MainButton() );
-    // Wifi Provider
-    kernel->add_module( new(AHB0) WifiProvider() );
+    kernel->add_module( new(AHB0) MainButton(), "main button" );
+    // Wifi Provider, the module itself is brought up from on_idle and records "wifi up" when it is
+    kernel->add_module( new(AHB0) WifiProvider(), "wifi" );
 
 
     // these modules can be completely disabled in the Makefile by adding to EXCLUDE_MODULES
     #ifndef NO_TOOLS_SWITCH
+    start = us_ticker_read();
     SwitchPool *sp= new SwitchPool();
     sp->load_tools();
     delete sp;
+    BootProfile::record("switches", start);
     #endif
 
     #ifndef NO_TOOLS_EXTRUDER
@@ -192,29 +203,33 @@ void init() {
 
     // #ifndef NO_TOOLS_TEMPERATURECONTROL
     // Note order is important here must be after extruder so Tn as a parameter will get executed first
+    start = us_ticker_read();
     TemperatureControlPool *tp= new(AHB0) TemperatureControlPool();
     tp->load_tools();
     delete tp;
+    BootProfile::record("temperature control", start);
 
     // #endif
     #ifndef NO_TOOLS_ENDSTOPS
-    kernel->add_module( new(AHB0) Endstops() );
+    kernel->add_module( new(AHB0) Endstops(), "endstops" );
     #endif
     #ifndef NO_TOOLS_LASER
-    kernel->add_module( new(AHB0) Laser() );
+    kernel->add_module( new(AHB0) Laser(), "laser" );
     #endif
 
     #ifndef NO_TOOLS_SPINDLE
+    start = us_ticker_read();
     SpindleMaker *sm = new(AHB0) SpindleMaker();
     sm->load_spindle();
     delete sm;
+    BootProfile::record("spindle", start);
     //kernel->add_module( new(AHB0) Spindle() );
     #endif
     #ifndef NO_UTILS_PANEL
     // kernel->add_module( new(AHB0) Panel() );
     #endif
     #ifndef NO_TOOLS_ZPROBE
-    kernel->add_module( new(AHB0) ZProbe() );
+    kernel->add_module( new(AHB0) ZProbe(), "zprobe" );
     #endif
     #ifndef NO_TOOLS_SCARACAL
     kernel->add_module( new(AHB0) SCARAcal() );
@@ -227,7 +242,7 @@ void init() {
 //    #endif
     #ifndef NO_TOOLS_TEMPERATURESWITCH
     // Must be loaded after TemperatureControl
-    kernel->add_module( new(AHB0) TemperatureSwitch() );
+    kernel->add_module( new(AHB0) TemperatureSwitch(), "temperature switch" );
     #endif
     #ifndef NO_TOOLS_DRILLINGCYCLES
     kernel->add_module( new(AHB0) Drillingcycles() );
@@ -282,6 +297,7 @@ void init() {
         leds[3]= sdok?1:0; // 4th led indicates sdcard is available (TODO maye should indicate config was found)
     }
 
+    start = us_ticker_read();
     if(sdok) {
         // load config override file if present
         // NOTE only Mxxx commands that set values should be put in this file. The file is generated by M500
@@ -299,9 +315,12 @@ void init() {
             fclose(fp);
         }
     }
+    BootProfile::record("config override", start);
 
     // start the timers and interrupts
     THEKERNEL->conveyor->start(THEROBOT->get_number_registered_motors());
+    // the sector cache only gets what the block queue left of AHB0
+    mounter.cache.setup();
     THEKERNEL->step_ticker->start();
     THEKERNEL->slow_ticker->start();
 }
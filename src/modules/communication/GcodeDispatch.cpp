@@ -17,6 +17,8 @@
 #include "libs/StreamOutputPool.h"
 #include "libs/FileStream.h"
 #include "libs/AppendFileStream.h"
+#include "libs/SectorWriter.h"
+#include "libs/ConfigImage.h"
 #include "Config.h"
 #include "checksumm.h"
 #include "ConfigValue.h"
@@ -239,6 +241,9 @@ try_again:
 							// open file
 							upload_fd = fopen(this->upload_filename.c_str(), "w");
 							if(upload_fd != NULL) {
+								// lines are gathered into whole sectors before they go to the card
+								upload_writer = new SectorWriter();
+								upload_writer->attach(upload_fd);
 								this->uploading = true;
 								new_message.stream->printf("Writing to file: %s\r\nok\r\n", this->upload_filename.c_str());
 							} else {
@@ -438,11 +443,19 @@ try_again:
 				// we are uploading and it is the upload stream so so save it
 				if(single_command.substr(0, 3) == "M29") {
 					// done uploading, close file
-					fclose(upload_fd);
-					upload_fd = NULL;
+					bool written = true;
+					if(upload_fd != NULL) {
+						written = upload_writer->flush();
+						fclose(upload_fd);
+						upload_fd = NULL;
+						ConfigImage::remove();
+					}
+					delete upload_writer;
+					upload_writer = nullptr;
 					uploading = false;
 					upload_filename.clear();
 					upload_stream= nullptr;
+					if(!written) new_message.stream->printf("Error:error writing to file.\r\n");
 					new_message.stream->printf("Done saving file.\r\nok\r\n");
 					continue;
 				}
@@ -454,11 +467,13 @@ try_again:
 				}
 
 				single_command.append("\n");
-				if(fwrite(single_command.c_str(), 1, single_command.size(), upload_fd) != single_command.size()) {
+				if(!upload_writer->write((const uint8_t *)single_command.c_str(), single_command.size())) {
 					// error writing to file
 					new_message.stream->printf("Error:error writing to file.\r\n");
 					fclose(upload_fd);
 					upload_fd = NULL;
+					delete upload_writer;
+					upload_writer = nullptr;
 					continue;
 
 				} else {
@@ -13,6 +13,7 @@
 #include <string>
 
 class StreamOutput;
+class SectorWriter;
 
 class GcodeDispatch : public Module
 {
@@ -26,6 +27,7 @@ public:
 private:
     std::string upload_filename;
     FILE *upload_fd;
+    SectorWriter *upload_writer{nullptr};
     StreamOutput* upload_stream{nullptr};
     uint8_t modal_group_1;
     struct {
@@ -17,6 +17,8 @@ using std::string;
 #include "libs/SerialMessage.h"
 #include "libs/StreamOutput.h"
 #include "libs/StreamOutputPool.h"
+#include "libs/InputScheduler.h"
+#include "libs/Crc16.h"
 #include "ATCHandlerPublicAccess.h"
 #include "PublicDataRequest.h"
 #include "PublicData.h"
@@ -25,12 +27,15 @@ using std::string;
 extern unsigned char xbuff[XBUFF_LENGTH];
 extern unsigned char fbuff[4096];
 __attribute__((section("AHBSRAM1"), aligned(4))) char Serialbuff[544];
-extern const unsigned short crc_table[256];
 
 // Serial reading module
 // Treats every received line as a command and passes it ( via event call ) to the command dispatcher.
 // The command dispatcher will then ask other modules if they can do something with it
-SerialConsole::SerialConsole( PinName rx_pin, PinName tx_pin, int baud_rate ){
+SerialConsole::SerialConsole( PinName rx_pin, PinName tx_pin, int baud_rate ) : realtime(this), parser((uint8_t *)Serialbuff, sizeof(Serialbuff)), batch(this) {
+    this->last_rx_us = 0;
+    this->rx_overflows = 0;
+    this->input_source = 0;
+    this->draining = false;
     this->serial = new mbed::Serial( rx_pin, tx_pin );
     this->serial->baud(baud_rate);
 }
@@ -50,11 +55,13 @@ void SerialConsole::on_module_loaded() {
 
     // Add to the pack of streams kernel can call to, for example for broadcasting
     THEKERNEL->streams->append_stream(this);
+
+    this->input_source = THEKERNEL->input->add_source("serial");
 }
 
 void SerialConsole::attach_irq(bool enable_irq) {
 	if (enable_irq) {
-	    this->serial->attach(nullptr, mbed::Serial::RxIrq);
+	    this->serial->attach(this, &SerialConsole::on_serial_char_received, mbed::Serial::RxIrq);
 	} else {
 	    this->serial->attach(nullptr, mbed::Serial::RxIrq);
 	}
@@ -74,138 +81,102 @@ void SerialConsole::on_set_public_data(void *argument) {
 
 
 // Called on Serial::RxIrq interrupt, meaning we have received a char
+// only moves the bytes into the ring buffer, anything slower would hold up the step ticker and other interrupts.
+// Realtime command frames are picked out on the way and handed to PendSV instead.
 void SerialConsole::on_serial_char_received() {
-	uint8_t headerBuffer[2];
-    uint32_t received = 0;
-    uint32_t timeout_ms = 100000;	//100 ms
-    uint32_t starttime = 0;
-    
-	if (this->serial->readable()) 
-	{
-	    // wait head
-	    starttime = us_ticker_read();
-	    while ((received < 2) && ((us_ticker_read() - starttime) < timeout_ms) ) {
-	    	if (this->serial->readable()) {
-	    		headerBuffer[0] = headerBuffer[1];
-	    		char byte = this->serial->getc();
-				received++;
-	            headerBuffer[1] = byte;
-	            if (received >= 2 && (headerBuffer[0] != ((HEADER >> 8) & 0xFF) || 
-	                                 headerBuffer[1] != (HEADER & 0xFF))) {
-	                received = 1;
-	            }
-	        } 
-	    }
-	    
-	    if (received < 2){
-//	    	PacketMessage(PTYPE_NORMAL_INFO, "ALARM: Abort receive header\r\n", 0);
-	    	return;
-	    }
-	    
-	    // receive length	    
-	    starttime = us_ticker_read();
-	    while ((received < 4) && ((us_ticker_read() - starttime) < timeout_ms) ) {
-	    	if (this->serial->readable()) {
-	        	char byte = this->serial->getc();
-	        	Serialbuff[received] = byte;
-	            received ++;
-	        } 
-	    }
-	    
-	    if (received < 4){
-//	    	PacketMessage(PTYPE_NORMAL_INFO, "ALARM: Abort receive length\r\n", 0);
-	    	return;
-	    }
-	    
-	    uint16_t data_len = (Serialbuff[2]<<8) | Serialbuff[3];
-	    uint16_t total_len = 4 + data_len + 2; // header + data + crc + tail
-	    
-	    if (data_len > 513 || total_len > sizeof(Serialbuff)){
-//	    	PacketMessage(PTYPE_NORMAL_INFO, "ALARM: Abort receive datalen error\r\n", 0);
-	    	 return; 
-	    }
-	    
-	    starttime = us_ticker_read();
-	    while ((received < total_len) && ((us_ticker_read() - starttime) < timeout_ms) ) {	    	
-	    	if (this->serial->readable()) {
-	        	char byte = this->serial->getc();
-	        	Serialbuff[received] = byte;
-	            received ++;
-	        }
-	    }
-	    
-	    if (received < total_len) {
-//	    	PacketMessage(PTYPE_NORMAL_INFO, "ALARM: Abort receive data body\r\n", 0);
-	    	return;
-	    }
-	    
-	    // check tail
-	    uint16_t tail = (Serialbuff[total_len-2]<<8) | Serialbuff[total_len-1];
-	    if (tail != FOOTER) {
-//	    	PacketMessage(PTYPE_NORMAL_INFO, "ALARM: Abort receive footer\r\n", 0);
-	    	return;
-	    }
-/*	    
-	    // check CRC
-	    uint16_t received_crc = (Serialbuff[total_len-4] << 8) | Serialbuff[total_len-3];
-		uint16_t calculated_crc = crc16_ccitt((unsigned char *)&Serialbuff[2], data_len);
-	    if (received_crc != calculated_crc) {
-//	    	PacketMessage(PTYPE_NORMAL_INFO, "ALARM: Abort receive wrong crc\r\n", 0);
-	        return;
-	    }
-*/	    
-		uint8_t cmdType = Serialbuff[4];
-        switch(cmdType) {
-            case PTYPE_CTRL_SINGLE: { 
-                if(Serialbuff[5] == '?') {
-	            	query_flag = true;
-	        	}
-	        	else if(Serialbuff[5] == 'X' - 'A' + 1) {
-	            	halt_flag = true;
-	        	}
-	        	else if(THEKERNEL->is_feed_hold_enabled()) {
-		            if(Serialbuff[5] == '!') { // safe pause
-		                THEKERNEL->set_feed_hold(true);
-		            }
-		            else if(Serialbuff[5] == '~') { // safe resume
-		                THEKERNEL->set_feed_hold(false);
-		            }
-		        }
-                break;
-            }
-            case PTYPE_CTRL_MULTI: {
-                struct SerialMessage message;
-                message.message.assign(Serialbuff+5, data_len-3);
-                message.stream = this;
-                THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message );
-                break;
-            }
-            case PTYPE_FILE_START: {
-                struct SerialMessage message;
-                message.message.assign(Serialbuff+5,data_len-3);
-                message.stream = this;
-                THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message );
-                break;
+    uint8_t out[REALTIME_FRAME_SIZE];
+    char cmd;
+    while (this->serial->readable()) {
+        int n = this->rt_filter.feed(this->serial->getc(), out, cmd);
+        for (int i = 0; i < n; ++i) {
+            if (this->rx_buffer.next_block_index(this->rx_buffer.head) == this->rx_buffer.tail) {
+                this->rx_overflows++;
+                continue;
             }
-            	
-            default:
-            	break;
+            this->rx_buffer.push_back(out[i]);
         }
-	    
-	}
+        if (cmd != 0) {
+            this->realtime.post(cmd);
+        }
+    }
 }
 
-unsigned int SerialConsole::crc16_ccitt(unsigned char *data, unsigned int len)
-{
-	unsigned char tmp;
-	unsigned short crc = 0;
+// next received byte, buffered ones first as the interrupt is turned off during file transfers
+bool SerialConsole::read_byte(char &c) {
+    if (this->rx_buffer.head != this->rx_buffer.tail) {
+        this->rx_buffer.pop_front(c);
+        return true;
+    }
+    if (this->serial->readable()) {
+        c = this->serial->getc();
+        return true;
+    }
+    return false;
+}
 
-	for (unsigned int i = 0; i < len; i ++) {
-        tmp = ((crc >> 8) ^ data[i]) & 0xff;
-        crc = ((crc << 8) ^ crc_table[tmp]) & 0xffff;
-	}
+// feeds whatever has been received to the frame parser, never waits for more
+// stops while the input scheduler has no room for another line, what is left stays in the ring buffer
+void SerialConsole::process_rx() {
+    char c;
+    bool got = false;
+    if (this->draining) {
+        if (!THEKERNEL->input->idle(this->input_source)) return;
+        this->draining = false;
+    }
+    while (THEKERNEL->input->has_room(this->input_source) && this->read_byte(c)) {
+        got = true;
+        if (this->parser.feed(c)) {
+            this->handle_frame();
+            if (this->draining) break;
+        }
+    }
+
+    uint32_t now = us_ticker_read();
+    if (got) {
+        this->last_rx_us = now;
+    } else if (this->parser.in_frame() && now - this->last_rx_us > 100000) {
+        // drop a partial frame after 100ms of silence so a lost byte cannot swallow the next frame
+        this->parser.reset();
+    }
+}
 
-	return crc & 0xffff;
+void SerialConsole::handle_frame() {
+    const char *payload = (const char *)this->parser.payload();
+    switch(this->parser.type()) {
+        case PTYPE_CTRL_SINGLE: {
+            if(payload[0] == '?') {
+                query_flag = true;
+            }
+            else if(payload[0] == 'X' - 'A' + 1) {
+                halt_flag = true;
+            }
+            else if(THEKERNEL->is_feed_hold_enabled()) {
+                if(payload[0] == '!') { // safe pause
+                    THEKERNEL->set_feed_hold(true);
+                }
+                else if(payload[0] == '~') { // safe resume
+                    THEKERNEL->set_feed_hold(false);
+                }
+            }
+            break;
+        }
+        case PTYPE_CTRL_BATCH:
+            this->batch.add(this->parser.payload(), this->parser.payload_len());
+            break;
+
+        case PTYPE_CTRL_MULTI:
+            THEKERNEL->input->submit(this->input_source, this, std::string(payload, this->parser.payload_len()));
+            break;
+
+        case PTYPE_FILE_START:
+            // the upload reads the rest of the transfer itself, nothing more may be parsed until it has run
+            THEKERNEL->input->submit(this->input_source, this, std::string(payload, this->parser.payload_len()));
+            this->draining = true;
+            break;
+
+        default:
+            break;
+    }
 }
 
 void SerialConsole::PacketMessage(char cmd, const char* s, int size)
@@ -290,9 +261,10 @@ void SerialConsole::on_idle(void * argument)
 {	
 	if (THEKERNEL->is_uploading()) return;
 	
-	on_serial_char_received();
+	process_rx();
+	realtime.on_idle();
 
-    if (query_flag ) {
+    if (realtime.take_query() || query_flag) {
         query_flag = false;
         PacketMessage(PTYPE_STATUS_RES,THEKERNEL->get_query_string().c_str(),0);
     }
@@ -302,7 +274,7 @@ void SerialConsole::on_idle(void * argument)
     	PacketMessage(PTYPE_DIAG_RES,THEKERNEL->get_diagnose_string().c_str(),0);
     }
 
-    if (halt_flag) {
+    if (realtime.take_halt() || halt_flag) {
         halt_flag= false;
         THEKERNEL->set_halt_reason(MANUAL);
         THEKERNEL->call_event(ON_HALT, nullptr);
@@ -316,16 +288,18 @@ void SerialConsole::on_idle(void * argument)
 
 // Actual event calling must happen in the main loop because if it happens in the interrupt we will loose data
 void SerialConsole::on_main_loop(void * argument){
-    
-
+    // not from on_idle, which runs inside lines, the input scheduler says when a batch line may start
+    batch.dispatch(this->input_source);
 }
 
 int SerialConsole::puts(const char* s, int size)
 {
     size_t n = size == 0 ? strlen(s) : size;
+    this->realtime.begin_write();
     for (size_t i = 0; i < n; ++i) {
         this->_putc(s[i]);
     }
+    this->realtime.end_write();
     return n;
 }
 
@@ -337,8 +311,8 @@ int SerialConsole::gets(char** buf, int size)
     uint16_t expectedLength = 0;
     uint16_t checksum;
     
-	while (this->serial->readable()) {
-		char byte = this->serial->getc();
+	char byte;
+	while (this->read_byte(byte)) {
 		switch(this->currentState) {
             case WAIT_HEADER:
                 headerBuffer[0] = headerBuffer[1];
@@ -445,10 +419,12 @@ int SerialConsole::_putc(int c)
 
 int SerialConsole::_getc()
 {
-    return this->serial->getc();
+    char c;
+    while (!this->read_byte(c)) ;
+    return c;
 }
 
 bool SerialConsole::ready()
 {
-    return this->serial->readable();
+    return this->rx_buffer.head != this->rx_buffer.tail || this->serial->readable();
 }
@@ -16,6 +16,9 @@
 using std::string;
 #include "libs/RingBuffer.h"
 #include "libs/StreamOutput.h"
+#include "libs/FrameParser.h"
+#include "libs/CommandBatch.h"
+#include "libs/Realtime.h"
 
 
 #define baud_rate_setting_checksum CHECKSUM("baud_rate")
@@ -39,7 +42,7 @@ class SerialConsole : public Module, public StreamOutput {
         int gets(char** buf, int size = 0);
         bool ready();
         char getc_result;
-		void reset(void){ptrData=0;ptr_xbuff=0;currentState = WAIT_HEADER;};
+		void reset(void){ptrData=0;ptr_xbuff=0;currentState = WAIT_HEADER;parser.reset();};
 		int printfcmd(const char cmd, const char *format, ...);
 		int printf(const char *format, ...) __attribute__ ((format(printf, 2, 3)));
 
@@ -47,7 +50,9 @@ class SerialConsole : public Module, public StreamOutput {
    		
     	void PacketMessage(char cmd, const char* s, int size);
     	int CheckFilePacket(char** buf);
-	    unsigned int crc16_ccitt(unsigned char *data, unsigned int len);
+    	void process_rx();
+    	void handle_frame();
+    	bool read_byte(char &c);
         mbed::Serial* serial;
         struct {
           bool query_flag:1;
@@ -55,6 +60,18 @@ class SerialConsole : public Module, public StreamOutput {
           bool diagnose_flag:1;
         };
     	ParseState currentState = WAIT_HEADER;    
+
+        // filled by the rx interrupt, frames are assembled from it in on_idle
+        RingBuffer<char,512> rx_buffer;
+        // realtime frames never reach the ring buffer, they are acted on from PendSV
+        RealtimeFilter rt_filter;
+        Realtime realtime;
+        FrameParser parser;
+        uint32_t last_rx_us;
+        uint32_t rx_overflows;
+        CommandBatch batch;
+        uint8_t input_source;
+        bool draining;
     	
 	    int ptrData;
 	    int ptr_xbuff;
@@ -21,8 +21,13 @@ BlockQueue::BlockQueue(unsigned int length)
     head_i = tail_i = 0;
     isr_tail_i = tail_i;
     void *v= AHB0.alloc(sizeof(Block) * length);
+    if (v == nullptr) {
+        // an empty queue, resize() can try again with less
+        ring = nullptr;
+        this->length = 0;
+        return;
+    }
     ring = new(v) Block[length];
-    // TODO: handle allocation failure
     this->length = length;
 }
 
@@ -182,10 +187,10 @@ bool BlockQueue::resize(unsigned int length)
 
         // Note: we don't use realloc so we can fall back to the existing ring if allocation fails
         void *v= AHB0.alloc(sizeof(Block) * length);
-        Block* newring = new(v) Block[length];
 
-        if (newring != nullptr)
+        if (v != nullptr)
         {
+            Block* newring = new(v) Block[length];
             Block* oldring = ring;
 
             __disable_irq();
@@ -63,6 +63,7 @@ Conveyor::Conveyor()
     running = false;
     allow_fetch = false;
     flush= false;
+    dry_run= false;
 }
 
 void Conveyor::on_module_loaded()
@@ -80,7 +81,21 @@ void Conveyor::on_module_loaded()
 void Conveyor::start(uint8_t n)
 {
     Block::init(n); // set the number of motors which determines how big the tick info vector is
-    queue.resize(queue_size);
+
+    // the ring comes out of AHB0 with everything else, fewer blocks are better than none
+    size_t wanted = queue_size;
+    while(!queue.resize(queue_size)) {
+        if(queue_size <= 2) {
+            THEKERNEL->streams->printf("Error: no room in AHB0 for the block queue, reduce what is configured\n");
+            queue_size = 0;
+            THEKERNEL->call_event(ON_HALT, nullptr);
+            return;
+        }
+        queue_size /= 2;
+    }
+    if(queue_size != wanted) {
+        THEKERNEL->streams->printf("WARNING: block queue reduced to %u blocks, not enough room in AHB0 for %u\n", (unsigned)queue_size, (unsigned)wanted);
+    }
     running = true;
 }
 
@@ -131,6 +146,12 @@ void Conveyor::wait_for_idle(bool wait_for_motors)
 {
     // wait for the job queue to empty, this means cycling everything on the block queue into the job queue
     // forcing them to be jobs
+    if(dry_run) {
+        // nothing will consume the queue, so account for it now
+        drain_dry_run();
+        return;
+    }
+
     running = false; // stops on_idle calling check_queue
     while (!queue.is_empty()) {
         check_queue(true); // forces queue to be made available to stepticker
@@ -153,6 +174,11 @@ void Conveyor::wait_for_idle(bool wait_for_motors)
  */
 void Conveyor::queue_head_block()
 {
+    // in dry run the oldest block is done once it can no longer be replanned
+    while (dry_run && queue.is_full()) {
+        retire_dry_run_block();
+    }
+
     // upstream caller will block on this until there is room in the queue
     while (queue.is_full() && !THEKERNEL->is_halted()) {
         //check_queue();
@@ -168,10 +194,47 @@ void Conveyor::queue_head_block()
 
     queue.produce_head();
 
+    if(dry_run) return;
+
     // not sure if this is the correct place but we need to turn on the motors if they were not already on
     THEKERNEL->call_event(ON_ENABLE, (void*)1); // turn all enable pins on
 }
 
+// must only be called when the queue is empty, ie after wait_for_idle()
+void Conveyor::set_dry_run(bool flg)
+{
+    if(flg) {
+        memset(&dry_run_stats, 0, sizeof(dry_run_stats));
+        allow_fetch = false;
+    } else {
+        drain_dry_run();
+    }
+    dry_run = flg;
+}
+
+// retires every queued block, the last one decelerates to the minimum planner speed as it would at the end of a job
+void Conveyor::drain_dry_run()
+{
+    while (!queue.is_empty()) {
+        retire_dry_run_block();
+    }
+}
+
+// the step ticker never sees dry run blocks so tail and isr_tail move together
+void Conveyor::retire_dry_run_block()
+{
+    Block *block = queue.tail_ref();
+    dry_run_stats.total_secs += block->total_move_ticks / (float)THEKERNEL->step_ticker->get_frequency();
+    if(block->nominal_speed > 0.0F) {
+        dry_run_stats.nominal_secs += block->millimeters / block->nominal_speed;
+    }
+    dry_run_stats.blocks++;
+
+    block->clear();
+    queue.isr_tail_i = queue.next(queue.isr_tail_i);
+    queue.consume_tail();
+}
+
 void Conveyor::check_queue(bool force)
 {
     static uint32_t last_time_check = us_ticker_read();
@@ -186,7 +249,7 @@ void Conveyor::check_queue(bool force)
     // we do this to allow an idle system to pre load the queue a bit so the first few blocks run smoothly.
     if(force || queue.is_full() || (us_ticker_read() - last_time_check) >= (queue_delay_time_ms * 1000)) {
         last_time_check = us_ticker_read(); // reset timeout
-        if(!flush) allow_fetch = true;
+        if(!flush && !dry_run) allow_fetch = true;
         return;
     }
 }
@@ -34,13 +34,27 @@ public:
     void dump_queue(void);
     void flush_queue(void);
     float get_current_feedrate() const { return current_feedrate; }
+    size_t get_queue_size() const { return queue_size; }
     void force_queue() { check_queue(true); }
 
+    // in dry run mode blocks are planned as usual but retired here instead of being handed to the step ticker,
+    // the time they would have taken is accumulated in dry_run_stats
+    struct dry_run_stats_t {
+        float total_secs;       // time of all retired blocks including acceleration
+        float nominal_secs;     // time the same blocks would take at their nominal feedrate
+        uint32_t blocks;
+    };
+    void set_dry_run(bool flg);
+    bool is_dry_run() const { return dry_run; }
+    void drain_dry_run();
+    const dry_run_stats_t& get_dry_run_stats() const { return dry_run_stats; }
+
     friend class Planner; // for queue
 
 private:
     void check_queue(bool force= false);
     void queue_head_block(void);
+    void retire_dry_run_block(void);
 
     using  Queue_t= BlockQueue;
     Queue_t queue;  // Queue of Blocks
@@ -48,11 +62,13 @@ private:
     uint32_t queue_delay_time_ms;
     size_t queue_size;
     float current_feedrate{0}; // actual nominal feedrate that current block is running at in mm/sec
+    dry_run_stats_t dry_run_stats;
 
     struct {
         volatile bool running:1;
         volatile bool allow_fetch:1;
         bool flush:1;
+        bool dry_run:1;
     };
 
 };
@@ -1490,7 +1490,8 @@ bool Robot::append_milestone(const float target[], float rate_mm_s, unsigned int
     }
 
     // check soft endstops only for homed axis that are enabled
-    if(soft_endstop_enabled && !THEKERNEL->is_zprobing()) {
+    // a dry run only plans, it must never halt the machine
+    if(soft_endstop_enabled && !THEKERNEL->is_zprobing() && !THECONVEYOR->is_dry_run()) {
         for (int i = 0; i <= Z_AXIS; ++i) {
             if(!is_homed(i)) continue;
             if( (!isnan(soft_endstop_min[i]) && transformed_target[i] < soft_endstop_min[i]) || (!isnan(soft_endstop_max[i]) && transformed_target[i] > soft_endstop_max[i]) ) {
@@ -40,6 +40,10 @@ class Robot : public Module {
         float get_seconds_per_minute() const { return seconds_per_minute; }
         float get_z_maxfeedrate() const { return this->max_speeds[Z_AXIS]; }
         float get_default_acceleration() const { return default_acceleration; }
+        float get_seek_rate() const { return seek_rate; }
+        float get_modal_feed_rate() const { return feed_rate; }
+        float get_soft_endstop_min(int axis) const { return soft_endstop_min[axis]; }
+        float get_soft_endstop_max(int axis) const { return soft_endstop_max[axis]; }
         void loadToolOffset(const float offset[N_PRIMARY_AXIS]);
         void saveToolOffset(const float offset[N_PRIMARY_AXIS], const float cur_tool_mz);
         float get_feed_rate() const;
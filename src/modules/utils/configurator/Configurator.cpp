@@ -19,6 +19,7 @@
 #include "FileConfigSource.h"
 #include "ConfigValue.h"
 #include "ConfigCache.h"
+#include "ConfigImage.h"
 
 #define CONF_NONE       0
 #define CONF_ROM        1
@@ -27,19 +28,32 @@
 
 
 // Output a ConfigValue from the specified ConfigSource to the stream
+// Answered from the config image while it is current, which saves parsing the config files for every key asked for
 void Configurator::config_get_command( string parameters, StreamOutput *stream )
 {
     string source = shift_parameter(parameters);
     string setting = shift_parameter(parameters);
+    bool found;
+    string value;
+    uint8_t from;
     if (setting == "") { // output settings from the config-cache
         setting = source;
         source = "";
         uint16_t setting_checksums[3];
         get_checksums(setting_checksums, setting );
+        if(ConfigImage::get(setting_checksums, found, value, from)) {
+            if(found) {
+                stream->printf( "cached: %s is set to %s\r\n", setting.c_str(), value.c_str() );
+            } else {
+                stream->printf( "cached: %s is not in config\r\n", setting.c_str());
+            }
+            return;
+        }
+
         THEKERNEL->config->config_cache_load(); // need to load config cache first as it is unloaded after booting
         ConfigValue *cv = THEKERNEL->config->value(setting_checksums);
         if(cv != NULL && cv->found) {
-            string value = cv->as_string();
+            value = cv->as_string();
             stream->printf( "cached: %s is set to %s\r\n", setting.c_str(), value.c_str() );
         } else {
             stream->printf( "cached: %s is not in config\r\n", setting.c_str());
@@ -52,7 +66,12 @@ void Configurator::config_get_command( string parameters, StreamOutput *stream )
         get_checksums(setting_checksums, setting );
         for(unsigned int i = 0; i < THEKERNEL->config->config_sources.size(); i++) {
             if( THEKERNEL->config->config_sources[i]->is_named(source_checksum) ) {
-                string value = THEKERNEL->config->config_sources[i]->read(setting_checksums);
+                // the image has the value of the last source that sets it, unless that is a later one this source does not have it
+                if(!ConfigImage::get(setting_checksums, found, value, from) || (found && from > i)) {
+                    value = THEKERNEL->config->config_sources[i]->read(setting_checksums);
+                } else if(!found || from < i) {
+                    value.clear();
+                }
                 if(value.empty()) {
                     stream->printf( "%s: %s is not in config\r\n", source.c_str(), setting.c_str() );
                 } else {
@@ -64,24 +83,45 @@ void Configurator::config_get_command( string parameters, StreamOutput *stream )
     }
 }
 
-// Write the specified setting to the specified ConfigSource
+// Write the specified settings to the specified ConfigSource, all in one pass over its file
 void Configurator::config_set_command( string parameters, StreamOutput *stream )
 {
     string source = shift_parameter(parameters);
-    string setting = shift_parameter(parameters);
-    string value = shift_parameter(parameters);
-    if(source.empty() || setting.empty() || value.empty()) {
-        stream->printf( "Usage: config-set source setting value # where source is sd, setting is the key and value is the new value\r\n" );
+    vector<ConfigSetting> settings;
+    while(!parameters.empty()) {
+        string setting = shift_parameter(parameters);
+        string value = shift_parameter(parameters);
+        if(setting.empty() || value.empty()) {
+            settings.clear();
+            break;
+        }
+        settings.push_back(ConfigSetting(setting, value));
+    }
+    if(source.empty() || settings.empty()) {
+        stream->printf( "Usage: config-set source setting value [setting value ...] # where source is sd, setting is the key and value is the new value\r\n" );
         return;
     }
 
     uint16_t source_checksum = get_checksum(source);
     for(unsigned int i = 0; i < THEKERNEL->config->config_sources.size(); i++) {
         if( THEKERNEL->config->config_sources[i]->is_named(source_checksum) ) {
-            if(THEKERNEL->config->config_sources[i]->write(setting, value)) {
-                stream->printf( "%s: %s has been set to %s\r\n", source.c_str(), setting.c_str(), value.c_str() );
-            } else {
-                stream->printf( "%s: %s not enough space to overwrite existing key/value\r\n", source.c_str(), setting.c_str() );
+            bool current = ConfigImage::is_current();
+            THEKERNEL->config->config_sources[i]->write_all(settings);
+
+            bool written = false;
+            for(auto &s : settings) {
+                if(s.written) {
+                    stream->printf( "%s: %s has been set to %s\r\n", source.c_str(), s.key.c_str(), s.value.c_str() );
+                    written = true;
+                } else {
+                    stream->printf( "%s: %s not enough space to overwrite existing key/value\r\n", source.c_str(), s.key.c_str() );
+                }
+            }
+
+            // keep the image in step with the file, or have it made again on next boot
+            if(written) {
+                if(current) ConfigImage::update(i, settings);
+                else ConfigImage::remove();
             }
             return;
         }
@@ -0,0 +1,798 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "JobAnalyzer.h"
+#include "libs/Kernel.h"
+#include "Robot.h"
+#include "libs/nuts_bolts.h"
+#include "libs/utils.h"
+#include "libs/SerialMessage.h"
+#include "libs/StreamOutput.h"
+#include "checksumm.h"
+#include "Config.h"
+#include "ConfigValue.h"
+#include "PublicDataRequest.h"
+#include "PublicData.h"
+#include "PlayerPublicAccess.h"
+#include "platform_memory.h"
+#include "us_ticker_api.h"
+
+#include <math.h>
+#include <float.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define job_analyzer_enable_checksum  CHECKSUM("job_analyzer_enable")
+#define job_analyzer_slice_checksum   CHECKSUM("job_analyzer_slice_us")
+
+// one sector per read, several reads fit in a slice
+#define JOB_ANALYZER_CHUNK 512
+
+// the md5 sent with the upload of a file in gcodes/, empty if there is none
+static string upload_md5(const string& filename)
+{
+    if (filename.find("gcodes/") == string::npos) return "";
+    FILE *fd_md5 = fopen(change_to_md5_path(filename).c_str(), "r");
+    if (fd_md5 == NULL) return "";
+    char buf[33];
+    size_t n = fread(buf, 1, 32, fd_md5);
+    fclose(fd_md5);
+    buf[n] = '\0';
+    return n == 32 ? string(buf) : string();
+}
+
+JobAnalyzer::JobAnalyzer()
+{
+    this->fd = NULL;
+    this->chunk = NULL;
+    this->state = IDLE;
+    this->result.complete = false;
+    this->result.percent = 0;
+    this->line_len = 0;
+    this->line_overflow = false;
+    this->in_comment = false;
+    this->eol_comment = false;
+    this->hash_on_scan = false;
+}
+
+void JobAnalyzer::on_module_loaded()
+{
+    this->enabled = THEKERNEL->config->value(job_analyzer_enable_checksum)->by_default(true)->as_bool();
+    if (!this->enabled) {
+        delete this;
+        return;
+    }
+
+    // time spent scanning in each on_idle call
+    this->slice_us = THEKERNEL->config->value(job_analyzer_slice_checksum)->by_default(1500)->as_number();
+
+    this->register_for_event(ON_CONSOLE_LINE_RECEIVED);
+    this->register_for_event(ON_IDLE);
+    this->register_for_event(ON_GET_PUBLIC_DATA);
+    this->register_for_event(ON_SET_PUBLIC_DATA);
+}
+
+void JobAnalyzer::on_console_line_received( void *argument )
+{
+    if(THEKERNEL->is_halted()) return; // if in halted state ignore any commands
+
+    SerialMessage new_message = *static_cast<SerialMessage *>(argument);
+
+    string possible_command = new_message.message;
+
+    // ignore anything that is not lowercase or a letter
+    if(possible_command.empty() || !islower(possible_command[0]) || !isalpha(possible_command[0])) {
+        return;
+    }
+
+    string cmd = shift_parameter(possible_command);
+
+    if (cmd == "analyze") {
+        this->analyze_command( possible_command, new_message.stream );
+    }
+}
+
+// analyze [-f] [file]
+// starts a background scan of the file, or prints the cached result if the file has not changed since it was last scanned,
+// -f forces a rescan, with no file prints the state of the current or last scan
+void JobAnalyzer::analyze_command( string parameters, StreamOutput *stream )
+{
+    bool force = false;
+    size_t pos = parameters.find("-f");
+    if (pos != string::npos && (pos == 0 || parameters[pos - 1] == ' ')) {
+        force = true;
+        parameters.erase(pos, 2);
+    }
+
+    string name = shift_parameter(parameters);
+    if (name.empty()) {
+        this->print_result(stream);
+        return;
+    }
+
+    string filename = absolute_from_relative(name);
+    if (!this->start(filename, force)) {
+        stream->printf("analyze: could not open %s\r\n", filename.c_str());
+        return;
+    }
+
+    if (this->result.complete) {
+        this->print_result(stream);
+    } else {
+        stream->printf("Analyzing %s\r\n", filename.c_str());
+    }
+}
+
+void JobAnalyzer::print_result( StreamOutput *stream )
+{
+    if (this->result.filename.empty()) {
+        stream->printf("No analysis\r\n");
+        return;
+    }
+
+    if (!this->result.complete) {
+        stream->printf("file: %s, %u %% analyzed%s\r\n", this->result.filename.c_str(), this->result.percent,
+                       this->state == IDLE ? ", stopped" : "");
+        return;
+    }
+
+    unsigned long secs = lroundf(this->result.move_secs);
+    stream->printf("file: %s, md5: %s, lines: %lu\r\n", this->result.filename.c_str(), this->result.md5.c_str(), this->result.lines);
+    if (this->result.min[X_AXIS] > this->result.max[X_AXIS]) {
+        stream->printf("no moves\r\n");
+    } else {
+        for (int i = 0; i < JOB_ANALYSIS_AXES; ++i) {
+            if (this->result.min[i] > this->result.max[i]) continue;
+            stream->printf("%c: %1.3f .. %1.3f\r\n", i < 3 ? 'X' + i : 'A' + i - 3, this->result.min[i], this->result.max[i]);
+        }
+    }
+    // distance over feed ignores acceleration, play -d plans the file for a real estimate
+    stream->printf("max feed: %1.1f, max spindle: %1.1f, rough time: %02lu:%02lu:%02lu (no acceleration, play -d for a planned estimate)\r\n",
+                   this->result.max_feed, this->result.max_spindle, secs / 3600, (secs % 3600) / 60, secs % 60);
+    if (this->result.planned_secs > 0) {
+        unsigned long planned = lroundf(this->result.planned_secs);
+        stream->printf("planned time: %02lu:%02lu:%02lu (play -d)\r\n", planned / 3600, (planned % 3600) / 60, planned % 60);
+    }
+    stream->printf("tools:");
+    for (auto t : this->result.tools) {
+        stream->printf(" T%d", t);
+    }
+    stream->printf(this->result.tools.empty() ? " none\r\n" : "\r\n");
+    if (this->result.soft_endstop_violations > 0) {
+        stream->printf("WARNING: %lu moves exceed soft endstops, first on line %lu\r\n", this->result.soft_endstop_violations, this->result.first_violation_line);
+    }
+}
+
+// opens the file and either loads the cached result or queues the scan, returns false if the file cannot be opened
+bool JobAnalyzer::start(const string& filename, bool force)
+{
+    this->stop();
+
+    this->fd = fopen(filename.c_str(), "r");
+    if (this->fd == NULL) return false;
+
+    fseek(this->fd, 0, SEEK_END);
+    this->file_size = ftell(this->fd);
+    fseek(this->fd, 0, SEEK_SET);
+    this->read_cnt = 0;
+
+    this->result.filename = filename;
+    this->result.md5.clear();
+    this->result.complete = false;
+    this->result.percent = 0;
+    this->result.lines = 0;
+    for (int i = 0; i < JOB_ANALYSIS_AXES; ++i) {
+        this->result.min[i] = FLT_MAX;
+        this->result.max[i] = -FLT_MAX;
+    }
+    this->result.max_feed = 0;
+    this->result.max_spindle = 0;
+    this->result.move_secs = 0;
+    this->result.planned_secs = 0;
+    this->result.soft_endstop_violations = 0;
+    this->result.first_violation_line = 0;
+    this->result.tools.clear();
+
+    // the md5 sent with the upload is used as the cache key when there is one, otherwise the file is hashed first
+    this->result.md5 = upload_md5(filename);
+    this->index.clear();
+    this->index_step = JOB_ANALYSIS_INDEX_LINES;
+    this->pieces = 0;
+    this->piece_len = 0;
+
+    if (!this->result.md5.empty() && !force && this->load_cache(this->result.md5)) {
+        fclose(this->fd);
+        this->fd = NULL;
+        return true;
+    }
+
+    this->chunk = (char *)AHB0.alloc(JOB_ANALYZER_CHUNK);
+    if (this->chunk == NULL) {
+        fclose(this->fd);
+        this->fd = NULL;
+        return false;
+    }
+
+    // hashing is only worth it if there is somewhere to cache the result
+    bool cached = !this->cache_path(filename).empty();
+    this->md5 = MD5();
+    this->hash_on_scan = this->result.md5.empty() && force && cached;
+    this->state = (this->result.md5.empty() && !force && cached) ? HASHING : SCANNING;
+
+    // the job starts wherever the machine is now, in the current work coordinate system
+    Robot::wcs_t pos = THEROBOT->mcs2wcs(THEROBOT->get_axis_position());
+    this->position[X_AXIS] = std::get<X_AXIS>(pos);
+    this->position[Y_AXIS] = std::get<Y_AXIS>(pos);
+    this->position[Z_AXIS] = std::get<Z_AXIS>(pos);
+    this->position[A_AXIS] = std::get<A_AXIS>(pos);
+    this->position[B_AXIS] = std::get<B_AXIS>(pos);
+    this->seek_rate = THEROBOT->get_seek_rate();
+    this->feed_rate = THEROBOT->get_modal_feed_rate();
+    this->pending_tool = -1;
+    this->motion_mode = 0;
+    this->plane_axis_0 = X_AXIS;
+    this->plane_axis_1 = Y_AXIS;
+    this->plane_axis_2 = Z_AXIS;
+    this->inch_mode = false;
+    this->absolute_mode = true;
+    this->line_len = 0;
+    this->line_overflow = false;
+    this->in_comment = false;
+    this->eol_comment = false;
+
+    return true;
+}
+
+void JobAnalyzer::stop()
+{
+    if (this->fd != NULL) {
+        fclose(this->fd);
+        this->fd = NULL;
+    }
+    if (this->chunk != NULL) {
+        AHB0.dealloc(this->chunk);
+        this->chunk = NULL;
+    }
+    this->state = IDLE;
+}
+
+void JobAnalyzer::finish()
+{
+    if (this->line_len > 0 && !this->line_overflow) {
+        this->result.lines++;
+        this->line[this->line_len] = '\0';
+        this->process_line(this->line);
+    }
+    if (this->hash_on_scan) {
+        this->result.md5 = this->md5.finalize().hexdigest();
+    }
+
+    this->result.percent = 100;
+    this->result.complete = true;
+    this->stop();
+    this->save_cache();
+    std::vector<index_t>().swap(this->index);
+}
+
+void JobAnalyzer::on_idle( void *argument )
+{
+    if (this->state == IDLE) return;
+
+    // never compete with a running job or a file transfer for the card
+    if (THEKERNEL->is_uploading()) return;
+    void *returned_data;
+    if (PublicData::get_value( player_checksum, is_playing_checksum, &returned_data ) && *static_cast<bool *>(returned_data)) return;
+
+    uint32_t start = us_ticker_read();
+    do {
+        if (this->read_chunk()) continue;
+
+        if (this->state == HASHING) {
+            this->result.md5 = this->md5.finalize().hexdigest();
+            if (this->load_cache(this->result.md5)) {
+                this->stop();
+                return;
+            }
+            fseek(this->fd, 0, SEEK_SET);
+            this->read_cnt = 0;
+            this->state = SCANNING;
+        } else {
+            this->finish();
+        }
+        return;
+    } while (us_ticker_read() - start < this->slice_us);
+}
+
+// reads and processes the next chunk of the file, returns false at the end of the file
+bool JobAnalyzer::read_chunk()
+{
+    size_t n = fread(this->chunk, 1, JOB_ANALYZER_CHUNK, this->fd);
+    if (n == 0) return false;
+
+    this->read_cnt += n;
+    if (this->state == HASHING || this->hash_on_scan) {
+        this->md5.update(this->chunk, n);
+    }
+    if (this->state == HASHING) return true;
+
+    this->result.percent = this->file_size > 0 ? (uint64_t)this->read_cnt * 100 / this->file_size : 100;
+
+    for (size_t k = 0; k < n; ++k) {
+        char c = this->chunk[k];
+        // the player reads lines with fgets into 130 bytes, a longer line is several of them
+        if (c == '\n' || ++this->piece_len == sizeof(this->line) - 1) {
+            this->pieces++;
+            this->piece_len = 0;
+            if (c == '\n') this->add_index(this->read_cnt - n + k + 1);
+        }
+        if (c == '\n') {
+            this->result.lines++;
+            if (!this->line_overflow) {
+                this->line[this->line_len] = '\0';
+                this->process_line(this->line);
+            }
+            this->line_len = 0;
+            this->line_overflow = false;
+            this->in_comment = false;
+            this->eol_comment = false;
+            continue;
+        }
+        if (this->eol_comment || c == '\r' || c == ' ' || c == '\t') continue;
+        if (this->in_comment) {
+            if (c == ')') this->in_comment = false;
+            continue;
+        }
+        if (c == '(') {
+            this->in_comment = true;
+            continue;
+        }
+        if (c == ';') {
+            this->eol_comment = true;
+            continue;
+        }
+        // same as the player, lines that do not fit are discarded
+        if (this->line_len >= sizeof(this->line) - 1) {
+            this->line_overflow = true;
+            continue;
+        }
+        this->line[this->line_len++] = toupper(c);
+    }
+
+    return true;
+}
+
+// a cut down gcode interpreter, only tracks the modal state that moves depend on
+void JobAnalyzer::process_line(char *line)
+{
+    float val[26];
+    uint32_t has = 0;
+    int g[4], m[4];
+    int ng = 0, nm = 0;
+
+    char *p = line;
+    while (*p != '\0') {
+        char c = *p++;
+        if (c < 'A' || c > 'Z') continue;
+        char *end;
+        float v = strtof(p, &end);
+        if (end == p) continue;
+        p = end;
+        if (c == 'G') {
+            if (ng < 4) g[ng++] = (int)v;
+        } else if (c == 'M') {
+            if (nm < 4) m[nm++] = (int)v;
+        } else {
+            val[c - 'A'] = v;
+            has |= 1 << (c - 'A');
+        }
+    }
+    #define HAS(c) (has & (1 << ((c) - 'A')))
+    #define VAL(c) (val[(c) - 'A'])
+
+    bool skip_motion = false, dwell = false, machine_coords = false;
+    for (int k = 0; k < ng; ++k) {
+        switch (g[k]) {
+            case 0: case 1: case 2: case 3: this->motion_mode = g[k]; break;
+            case 4: dwell = true; break;
+            case 17: this->plane_axis_0 = X_AXIS; this->plane_axis_1 = Y_AXIS; this->plane_axis_2 = Z_AXIS; break;
+            case 18: this->plane_axis_0 = Z_AXIS; this->plane_axis_1 = X_AXIS; this->plane_axis_2 = Y_AXIS; break;
+            case 19: this->plane_axis_0 = Y_AXIS; this->plane_axis_1 = Z_AXIS; this->plane_axis_2 = X_AXIS; break;
+            case 20: this->inch_mode = true; break;
+            case 21: this->inch_mode = false; break;
+            case 90: this->absolute_mode = true; break;
+            case 91: this->absolute_mode = false; break;
+            case 53: machine_coords = true; break;
+            // homing, probing and offset setting, the position afterwards is not known here
+            case 10: case 28: case 30: case 38: case 92: skip_motion = true; break;
+        }
+    }
+
+    if (dwell) {
+        // P is milliseconds, or seconds in grbl mode, S is seconds
+        if (HAS('P')) this->result.move_secs += THEKERNEL->is_grbl_mode() ? VAL('P') : VAL('P') / 1000.0F;
+        if (HAS('S')) this->result.move_secs += VAL('S');
+        return;
+    }
+
+    if (HAS('T')) this->pending_tool = (int)VAL('T');
+    for (int k = 0; k < nm; ++k) {
+        if (m[k] == 6 && this->pending_tool >= 0 && this->result.tools.size() < JOB_ANALYSIS_MAX_TOOLS) {
+            this->result.tools.push_back(this->pending_tool);
+        }
+    }
+
+    if (HAS('S') && VAL('S') > this->result.max_spindle) this->result.max_spindle = VAL('S');
+
+    if (HAS('F')) {
+        float rate = this->inch_mode ? VAL('F') * 25.4F : VAL('F');
+        if (this->motion_mode == 0) this->seek_rate = rate;
+        else this->feed_rate = rate;
+    }
+
+    if (skip_motion) return;
+    if (!(HAS('X') || HAS('Y') || HAS('Z') || HAS('A') || HAS('B'))) return;
+
+    float target[JOB_ANALYSIS_AXES];
+    memcpy(target, this->position, sizeof(target));
+    const char letters[JOB_ANALYSIS_AXES] = {'X', 'Y', 'Z', 'A', 'B'};
+    for (int i = 0; i < JOB_ANALYSIS_AXES; ++i) {
+        if (!HAS(letters[i])) continue;
+        float v = (i <= Z_AXIS && this->inch_mode) ? VAL(letters[i]) * 25.4F : VAL(letters[i]);
+        target[i] = (this->absolute_mode || machine_coords) ? v : target[i] + v;
+    }
+
+    if (machine_coords) {
+        // G53 targets are in machine coordinates, keep tracking in work coordinates
+        Robot::wcs_t w = THEROBOT->mcs2wcs(Robot::wcs_t(target[X_AXIS], target[Y_AXIS], target[Z_AXIS], target[A_AXIS], target[B_AXIS]));
+        if (HAS('X')) target[X_AXIS] = std::get<X_AXIS>(w);
+        if (HAS('Y')) target[Y_AXIS] = std::get<Y_AXIS>(w);
+        if (HAS('Z')) target[Z_AXIS] = std::get<Z_AXIS>(w);
+        this->add_move(target, true);
+        return;
+    }
+
+    if (this->motion_mode <= 1) {
+        this->add_move(target, this->motion_mode == 0);
+    } else {
+        float scale = this->inch_mode ? 25.4F : 1.0F;
+        float i = HAS('I' + this->plane_axis_0) ? VAL('I' + this->plane_axis_0) * scale : 0;
+        float j = HAS('I' + this->plane_axis_1) ? VAL('I' + this->plane_axis_1) * scale : 0;
+        float r = HAS('R') ? VAL('R') * scale : 0;
+        this->add_arc(target, i, j, r, HAS('R'), this->motion_mode == 2);
+    }
+    #undef HAS
+    #undef VAL
+}
+
+void JobAnalyzer::add_move(const float *target, bool rapid)
+{
+    float d = sqrtf(powf(target[X_AXIS] - this->position[X_AXIS], 2) + powf(target[Y_AXIS] - this->position[Y_AXIS], 2) + powf(target[Z_AXIS] - this->position[Z_AXIS], 2));
+    if (d < 0.00001F) {
+        // rotary only move
+        d = std::max(fabsf(target[A_AXIS] - this->position[A_AXIS]), fabsf(target[B_AXIS] - this->position[B_AXIS]));
+    }
+
+    float rate = rapid ? this->seek_rate : this->feed_rate;
+    if (!rapid && rate > this->result.max_feed) this->result.max_feed = rate;
+    if (rate > 0) this->result.move_secs += d * 60.0F / rate;
+
+    this->extend_bounds(target);
+    this->check_soft_endstops(target);
+    memcpy(this->position, target, sizeof(this->position));
+}
+
+void JobAnalyzer::add_arc(const float *target, float i, float j, float r, bool has_r, bool clockwise)
+{
+    float x0 = this->position[this->plane_axis_0];
+    float y0 = this->position[this->plane_axis_1];
+    float x = target[this->plane_axis_0] - x0;
+    float y = target[this->plane_axis_1] - y0;
+
+    if (has_r) {
+        // center from radius as grbl does it, negative R is the long way round
+        float h_x2_div_d = 4.0F * r * r - x * x - y * y;
+        if (h_x2_div_d < 0 || (x == 0 && y == 0)) {
+            this->add_move(target, false);
+            return;
+        }
+        h_x2_div_d = -sqrtf(h_x2_div_d) / hypotf(x, y);
+        if (!clockwise) h_x2_div_d = -h_x2_div_d;
+        if (r < 0) h_x2_div_d = -h_x2_div_d;
+        i = 0.5F * (x - (y * h_x2_div_d));
+        j = 0.5F * (y + (x * h_x2_div_d));
+    }
+
+    float cx = x0 + i, cy = y0 + j;
+    float radius = hypotf(i, j);
+    float a_start = atan2f(-j, -i);
+    float sweep = atan2f(target[this->plane_axis_1] - cy, target[this->plane_axis_0] - cx) - a_start;
+    if (clockwise) {
+        if (sweep >= -0.00001F) sweep -= 2 * (float)M_PI;
+    } else {
+        if (sweep <= 0.00001F) sweep += 2 * (float)M_PI;
+    }
+
+    float d = hypotf(fabsf(sweep) * radius, target[this->plane_axis_2] - this->position[this->plane_axis_2]);
+    if (this->feed_rate > this->result.max_feed) this->result.max_feed = this->feed_rate;
+    if (this->feed_rate > 0) this->result.move_secs += d * 60.0F / this->feed_rate;
+
+    // the arc only reaches further than its end points where it crosses an axis of the circle
+    const float quarter = (float)M_PI / 2;
+    float a_end = a_start + sweep;
+    float a = clockwise ? floorf(a_start / quarter) * quarter : ceilf(a_start / quarter) * quarter;
+    if (a == a_start) a += clockwise ? -quarter : quarter;
+    for (; clockwise ? a > a_end : a < a_end; a += clockwise ? -quarter : quarter) {
+        float p[JOB_ANALYSIS_AXES];
+        memcpy(p, this->position, sizeof(p));
+        p[this->plane_axis_0] = cx + radius * cosf(a);
+        p[this->plane_axis_1] = cy + radius * sinf(a);
+        p[this->plane_axis_2] += (target[this->plane_axis_2] - this->position[this->plane_axis_2]) * (a - a_start) / sweep;
+        this->extend_bounds(p);
+        this->check_soft_endstops(p);
+    }
+
+    this->extend_bounds(target);
+    this->check_soft_endstops(target);
+    memcpy(this->position, target, sizeof(this->position));
+}
+
+// an entry every index_step lines or a little after, always at the end of a whole line so goto can check it is one
+void JobAnalyzer::add_index(unsigned long offset)
+{
+    unsigned long last = this->index.empty() ? 0 : this->index.back().line;
+    if (this->pieces < last + this->index_step) return;
+
+    if (this->index.size() >= JOB_ANALYSIS_INDEX) {
+        size_t n = 0;
+        for (size_t i = 1; i < this->index.size(); i += 2) {
+            this->index[n++] = this->index[i];
+        }
+        this->index.resize(n);
+        this->index_step *= 2;
+        if (this->pieces < this->index.back().line + this->index_step) return;
+    }
+    index_t e = { this->pieces, offset };
+    this->index.push_back(e);
+}
+
+void JobAnalyzer::extend_bounds(const float *pos)
+{
+    for (int i = 0; i < JOB_ANALYSIS_AXES; ++i) {
+        if (pos[i] < this->result.min[i]) this->result.min[i] = pos[i];
+        if (pos[i] > this->result.max[i]) this->result.max[i] = pos[i];
+    }
+}
+
+// same test as Robot::append_milestone, using the work offsets in effect when the file is scanned
+void JobAnalyzer::check_soft_endstops(const float *pos)
+{
+    if (!THEROBOT->soft_endstop_enabled) return;
+
+    Robot::wcs_t m = THEROBOT->wcs2mcs(pos);
+    float mpos[3] = {std::get<X_AXIS>(m), std::get<Y_AXIS>(m), std::get<Z_AXIS>(m)};
+    for (int i = X_AXIS; i <= Z_AXIS; ++i) {
+        float mn = THEROBOT->get_soft_endstop_min(i), mx = THEROBOT->get_soft_endstop_max(i);
+        if ((!isnan(mn) && mpos[i] < mn) || (!isnan(mx) && mpos[i] > mx)) {
+            if (this->result.soft_endstop_violations++ == 0) {
+                this->result.first_violation_line = this->result.lines;
+            }
+            return;
+        }
+    }
+}
+
+string JobAnalyzer::cache_path(const string& filename)
+{
+    size_t found = filename.find("gcodes/");
+    if (found == string::npos) return "";
+    return "/sd/gcodes/.analysis/" + filename.substr(found + 7);
+}
+
+// the cache is a small key=value text file, only valid if its md5 matches the file
+bool JobAnalyzer::load_cache(const string& md5)
+{
+    string path = this->cache_path(this->result.filename);
+    if (path.empty()) return false;
+
+    FILE *fp = fopen(path.c_str(), "r");
+    if (fp == NULL) return false;
+
+    // the longest line is the tool list, 32 tools of up to 4 digits fit, a longer one makes it scan again
+    char buf[200];
+    bool valid = false;
+    job_analysis &r = this->result;
+    while (fgets(buf, sizeof(buf), fp) != NULL) {
+        // a line cut short would be read as wrong values, so the cache is not used
+        if (strchr(buf, '\n') == NULL && !feof(fp)) {
+            valid = false;
+            break;
+        }
+        char *eq = strchr(buf, '=');
+        if (eq == NULL) continue;
+        *eq++ = '\0';
+        if (strcmp(buf, "md5") == 0) {
+            valid = strncmp(eq, md5.c_str(), 32) == 0;
+            if (!valid) break;
+        } else if (strcmp(buf, "lines") == 0) {
+            r.lines = strtoul(eq, NULL, 10);
+        } else if (strcmp(buf, "min") == 0 || strcmp(buf, "max") == 0) {
+            float *v = buf[1] == 'i' ? r.min : r.max;
+            for (int i = 0; i < JOB_ANALYSIS_AXES; ++i) v[i] = strtof(eq, &eq);
+        } else if (strcmp(buf, "max_feed") == 0) {
+            r.max_feed = strtof(eq, NULL);
+        } else if (strcmp(buf, "max_spindle") == 0) {
+            r.max_spindle = strtof(eq, NULL);
+        } else if (strcmp(buf, "time") == 0) {
+            r.move_secs = strtof(eq, NULL);
+        } else if (strcmp(buf, "planned") == 0) {
+            r.planned_secs = strtof(eq, NULL);
+        } else if (strcmp(buf, "violations") == 0) {
+            r.soft_endstop_violations = strtoul(eq, &eq, 10);
+            r.first_violation_line = strtoul(eq, NULL, 10);
+        } else if (strcmp(buf, "tools") == 0) {
+            r.tools.clear();
+            char *end;
+            for (long t = strtol(eq, &end, 10); end != eq && r.tools.size() < JOB_ANALYSIS_MAX_TOOLS; t = strtol(eq, &end, 10)) {
+                r.tools.push_back(t);
+                eq = end;
+            }
+        }
+    }
+    fclose(fp);
+
+    if (valid) {
+        r.md5 = md5;
+        r.percent = 100;
+        r.complete = true;
+    }
+    return valid;
+}
+
+void JobAnalyzer::save_cache()
+{
+    string path = this->cache_path(this->result.filename);
+    if (path.empty() || this->result.md5.empty()) return;
+
+    check_and_make_path(path);
+    FILE *fp = fopen(path.c_str(), "w");
+    if (fp == NULL) return;
+
+    const job_analysis &r = this->result;
+    fprintf(fp, "md5=%s\n", r.md5.c_str());
+    fprintf(fp, "lines=%lu\n", r.lines);
+    fprintf(fp, "min=%.9g %.9g %.9g %.9g %.9g\n", r.min[0], r.min[1], r.min[2], r.min[3], r.min[4]);
+    fprintf(fp, "max=%.9g %.9g %.9g %.9g %.9g\n", r.max[0], r.max[1], r.max[2], r.max[3], r.max[4]);
+    fprintf(fp, "max_feed=%.9g\n", r.max_feed);
+    fprintf(fp, "max_spindle=%.9g\n", r.max_spindle);
+    fprintf(fp, "time=%.9g\n", r.move_secs);
+    if (r.planned_secs > 0) fprintf(fp, "planned=%.9g\n", r.planned_secs);
+    fprintf(fp, "violations=%lu %lu\n", r.soft_endstop_violations, r.first_violation_line);
+    fprintf(fp, "tools=");
+    for (auto t : r.tools) fprintf(fp, " %d", t);
+    fprintf(fp, "\n");
+    for (auto &e : this->index) fprintf(fp, "at=%lu %lu\n", e.line, e.offset);
+    fclose(fp);
+}
+
+// read from the cache file when goto needs it, so the index takes no memory otherwise
+bool JobAnalyzer::find_line(job_line_offset& lo)
+{
+    string md5 = upload_md5(lo.filename);
+    string path = this->cache_path(lo.filename);
+    if (md5.empty() || path.empty()) return false;
+
+    FILE *fp = fopen(path.c_str(), "r");
+    if (fp == NULL) return false;
+
+    char buf[200];
+    bool valid = false, found = false;
+    unsigned long line = 0, offset = 0;
+    while (fgets(buf, sizeof(buf), fp) != NULL) {
+        if (strncmp(buf, "md5=", 4) == 0) {
+            valid = strncmp(buf + 4, md5.c_str(), 32) == 0;
+            if (!valid) break;
+        } else if (valid && strncmp(buf, "at=", 3) == 0) {
+            char *end;
+            unsigned long l = strtoul(buf + 3, &end, 10);
+            if (l > lo.line) break;
+            line = l;
+            offset = strtoul(end, NULL, 10);
+            found = true;
+        }
+    }
+    fclose(fp);
+
+    if (found) {
+        lo.line = line;
+        lo.offset = offset;
+    }
+    return found;
+}
+
+// keeps the planned time with the cached analysis of the same md5, a file that has none yet is scanned for it
+bool JobAnalyzer::set_planned_time(const job_planned_time& pt)
+{
+    // a scan of the file still running saves it with its result
+    if (this->state != IDLE && this->result.filename == pt.filename) {
+        this->result.planned_secs = pt.secs;
+        return true;
+    }
+
+    string path = this->cache_path(pt.filename);
+    string md5 = upload_md5(pt.filename);
+    if (md5.empty() && this->result.complete && this->result.filename == pt.filename) md5 = this->result.md5;
+    if (path.empty() || md5.empty()) return false;
+
+    // the cache is rewritten without its old planned time, it is a few dozen short lines
+    string text;
+    bool valid = false;
+    FILE *fp = fopen(path.c_str(), "r");
+    if (fp != NULL) {
+        char buf[200];
+        while (fgets(buf, sizeof(buf), fp) != NULL) {
+            if (strncmp(buf, "md5=", 4) == 0) {
+                valid = strncmp(buf + 4, md5.c_str(), 32) == 0;
+                if (!valid) break;
+            }
+            if (strncmp(buf, "planned=", 8) != 0) text.append(buf);
+        }
+        fclose(fp);
+    }
+
+    if (!valid) {
+        // only start a scan of it if that does not stop another one
+        if (this->state != IDLE || !this->start(pt.filename, false)) return false;
+        this->result.planned_secs = pt.secs;
+        return true;
+    }
+
+    fp = fopen(path.c_str(), "w");
+    if (fp == NULL) return false;
+    fputs(text.c_str(), fp);
+    fprintf(fp, "planned=%.9g\n", pt.secs);
+    fclose(fp);
+
+    if (this->result.filename == pt.filename && this->result.md5 == md5) this->result.planned_secs = pt.secs;
+    return true;
+}
+
+void JobAnalyzer::on_get_public_data(void *argument)
+{
+    PublicDataRequest *pdr = static_cast<PublicDataRequest *>(argument);
+
+    if(!pdr->starts_with(job_analyzer_checksum)) return;
+
+    if(pdr->second_element_is(get_analysis_checksum)) {
+        // only answer once a scan has been started
+        if (this->result.filename.empty()) return;
+        pdr->set_data_ptr(&this->result);
+        pdr->set_taken();
+
+    } else if(pdr->second_element_is(find_line_checksum)) {
+        // data is the caller's job_line_offset
+        job_line_offset *lo = static_cast<job_line_offset *>(pdr->get_data_ptr());
+        if (this->find_line(*lo)) pdr->set_taken();
+    }
+}
+
+void JobAnalyzer::on_set_public_data(void *argument)
+{
+    PublicDataRequest *pdr = static_cast<PublicDataRequest *>(argument);
+
+    if(!pdr->starts_with(job_analyzer_checksum)) return;
+
+    if(pdr->second_element_is(start_analysis_checksum)) {
+        // data is the filename, a cached result is returned immediately in get_analysis
+        string *filename = static_cast<string *>(pdr->get_data_ptr());
+        if (this->start(*filename, false)) pdr->set_taken();
+
+    } else if(pdr->second_element_is(planned_time_checksum)) {
+        job_planned_time *pt = static_cast<job_planned_time *>(pdr->get_data_ptr());
+        if (this->set_planned_time(*pt)) pdr->set_taken();
+    }
+}
@@ -0,0 +1,97 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Module.h"
+#include "JobAnalyzerPublicAccess.h"
+#include "md5.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+using std::string;
+
+class StreamOutput;
+
+// Scans a gcode file in small slices of idle time and works out its bounds, tools, feeds,
+// a rough run time (distance over feed) and soft endstop violations before the job is played.
+// Results are cached in /sd/gcodes/.analysis/ keyed by the md5 of the file, with an index of where lines start for goto
+// and the planned time of the last play -d of it.
+class JobAnalyzer : public Module {
+    public:
+        JobAnalyzer();
+
+        void on_module_loaded();
+        void on_console_line_received( void* argument );
+        void on_idle( void* argument );
+        void on_get_public_data(void* argument);
+        void on_set_public_data(void* argument);
+
+    private:
+        enum STATE_T { IDLE, HASHING, SCANNING };
+
+        void analyze_command( string parameters, StreamOutput* stream );
+        void print_result( StreamOutput* stream );
+        bool start(const string& filename, bool force);
+        void stop();
+        void finish();
+        bool read_chunk();
+        void process_line(char *line);
+        void add_move(const float *target, bool rapid);
+        void add_arc(const float *target, float i, float j, float r, bool has_r, bool clockwise);
+        void extend_bounds(const float *pos);
+        void check_soft_endstops(const float *pos);
+
+        void add_index(unsigned long offset);
+        bool find_line(job_line_offset& lo);
+        bool set_planned_time(const job_planned_time& pt);
+
+        bool load_cache(const string& md5);
+        void save_cache();
+        string cache_path(const string& filename);
+
+        job_analysis result;
+        FILE *fd;
+        char *chunk;
+        MD5 md5;
+        long file_size;
+        long read_cnt;
+        uint32_t slice_us;
+
+        char line[130];
+        uint8_t line_len;
+
+        // lines as the player counts them and where some of them end, only kept while scanning
+        struct index_t {
+            unsigned long line;
+            unsigned long offset;
+        };
+        std::vector<index_t> index;
+        unsigned long index_step;
+        unsigned long pieces;
+        uint8_t piece_len;
+
+        // modal state of the scanned file
+        float position[JOB_ANALYSIS_AXES];
+        float seek_rate;
+        float feed_rate;
+        int pending_tool;
+        uint8_t motion_mode;
+        uint8_t plane_axis_0, plane_axis_1, plane_axis_2;
+
+        STATE_T state;
+        struct {
+            bool enabled:1;
+            bool inch_mode:1;
+            bool absolute_mode:1;
+            bool line_overflow:1;
+            bool in_comment:1;
+            bool eol_comment:1;
+            bool hash_on_scan:1;
+        };
+};
@@ -0,0 +1,51 @@
+#ifndef JOBANALYZERPUBLICACCESS_H
+#define JOBANALYZERPUBLICACCESS_H
+
+#include <string>
+#include <vector>
+
+#define job_analyzer_checksum     CHECKSUM("job_analyzer")
+#define get_analysis_checksum     CHECKSUM("get_analysis")
+#define start_analysis_checksum   CHECKSUM("start_analysis")
+#define find_line_checksum        CHECKSUM("find_line")
+#define planned_time_checksum     CHECKSUM("planned_time")
+
+#define JOB_ANALYSIS_AXES       5     // X Y Z A B
+#define JOB_ANALYSIS_MAX_TOOLS  32
+#define JOB_ANALYSIS_INDEX      64    // line to offset entries saved with the result, thinned to every other one when full
+#define JOB_ANALYSIS_INDEX_LINES 256  // lines between entries to start with
+
+// result of a pre-flight scan, bounds are in work coordinates
+struct job_analysis {
+    std::string filename;
+    std::string md5;
+    bool complete;
+    unsigned int percent;               // scan progress while running
+    unsigned long lines;
+    float min[JOB_ANALYSIS_AXES];
+    float max[JOB_ANALYSIS_AXES];
+    float max_feed;                     // mm/min of G1/G2/G3 moves
+    float max_spindle;                  // highest S word seen
+    float move_secs;                    // distance over feed plus dwells, no acceleration so only a rough estimate
+    float planned_secs;                 // from play -d of the same file, 0 until it has been dry run
+    unsigned long soft_endstop_violations;
+    unsigned long first_violation_line;
+    std::vector<int> tools;             // tools in order of change
+};
+
+// for the player's goto, filename and line are passed in to find_line, line and offset come back as the nearest indexed
+// line at or before it and where the one after it starts. Lines are counted as fgets into 130 bytes returns them, from the
+// cache of the last scan and only while the md5 of the upload still matches it
+struct job_line_offset {
+    std::string filename;
+    unsigned long line;
+    unsigned long offset;
+};
+
+// play -d passes the time the planner took for a file to be kept with its analysis
+struct job_planned_time {
+    std::string filename;
+    float secs;
+};
+
+#endif
@@ -0,0 +1,227 @@
+#include "DryRun.h"
+
+#include "libs/Kernel.h"
+#include "Robot.h"
+#include "Conveyor.h"
+#include "Gcode.h"
+#include "libs/StreamOutput.h"
+#include "PublicData.h"
+#include "ATCHandlerPublicAccess.h"
+
+#include "us_ticker_api.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+DryRun::DryRun()
+{
+    this->fd = NULL;
+    memset(&this->stats, 0, sizeof(this->stats));
+    this->tool_start = 0;
+    this->dwell_secs = 0;
+    this->s_value = 0;
+    this->start_us = 0;
+    this->run_us = 0;
+    this->lines = 0;
+    this->tool = -1;
+    this->pending_tool = -1;
+    this->modal = 0;
+    this->plane_axis_0 = this->plane_axis_1 = this->plane_axis_2 = 0;
+    this->discard = false;
+    this->aborted = false;
+}
+
+bool DryRun::start(const string& filename)
+{
+    this->fd = fopen(filename.c_str(), "r");
+    if (this->fd == NULL) return false;
+
+    this->filename = filename;
+    this->tool_secs.clear();
+    this->tool_start = 0;
+    this->dwell_secs = 0;
+    this->lines = 0;
+    this->modal = 0;
+    this->discard = false;
+    this->aborted = false;
+
+    this->tool = this->pending_tool = -1;
+    struct tool_status ts;
+    if (PublicData::get_value(atc_handler_checksum, get_tool_status_checksum, &ts)) {
+        this->tool = ts.active_tool;
+    }
+
+    // everything the file can change is put back afterwards
+    THEROBOT->push_state();
+    this->plane_axis_0 = THEROBOT->plane_axis_0;
+    this->plane_axis_1 = THEROBOT->plane_axis_1;
+    this->plane_axis_2 = THEROBOT->plane_axis_2;
+    this->s_value = THEROBOT->get_s_value();
+    THEROBOT->absolute_mode = true;
+    THECONVEYOR->set_dry_run(true);
+
+    this->start_us = us_ticker_read();
+    return true;
+}
+
+bool DryRun::step(uint32_t slice_us)
+{
+    if (this->fd == NULL) return false;
+
+    uint32_t t0 = us_ticker_read();
+    char buf[130]; // lines up to 128 characters are allowed, anything longer is discarded
+    while (us_ticker_read() - t0 < slice_us) {
+        if (THEKERNEL->is_halted()) {
+            this->aborted = true;
+            return false;
+        }
+        if (fgets(buf, sizeof(buf), this->fd) == NULL) return false;
+
+        int len = strlen(buf);
+        if (len == 0) continue;
+        if (buf[len - 1] != '\n' && !feof(this->fd)) {
+            this->discard = true;
+            continue;
+        }
+        this->lines++;
+        if (this->discard) {
+            this->discard = false;
+            continue;
+        }
+        this->line(buf);
+    }
+    return true;
+}
+
+void DryRun::line(string line)
+{
+    size_t n = line.find_first_of(";(\r\n");
+    if (n != string::npos) line = line.substr(0, n);
+    n = line.find_first_not_of(' ');
+    if (n == string::npos) return;
+    line = line.substr(n);
+
+    // same as the dispatcher, coordinates on their own use the last motion mode and F on its own applies to G1
+    if (line.find_first_of("XYZAF") == 0) {
+        char mbuf[6];
+        snprintf(mbuf, sizeof(mbuf), "G%d ", line[0] == 'F' ? 1 : this->modal);
+        line.insert(0, mbuf);
+    }
+
+    n = line.find('T');
+    if (n != string::npos) {
+        this->pending_tool = strtol(line.c_str() + n + 1, NULL, 10);
+    }
+
+    // one gcode per G or M word
+    bool mcs = false;
+    size_t pos = line.find_first_of("GM");
+    while (pos != string::npos) {
+        size_t next = line.find_first_of("GM", pos + 1);
+        string single = line.substr(pos, next == string::npos ? string::npos : next - pos);
+        pos = next;
+
+        if (single[0] == 'M') {
+            if (strtol(single.c_str() + 1, NULL, 10) == 6 && this->pending_tool >= 0) {
+                // the tool change waits for the queue to empty, the same as a real one
+                THECONVEYOR->drain_dry_run();
+                float total = THECONVEYOR->get_dry_run_stats().total_secs + this->dwell_secs;
+                this->tool_secs[this->tool] += total - this->tool_start;
+                this->tool_start = total;
+                this->tool = this->pending_tool;
+            }
+            continue;
+        }
+
+        // G53 makes the next move use machine coordinates, with nothing after it the last motion mode is used
+        if (strtol(single.c_str() + 1, NULL, 10) == 53) {
+            if (next != string::npos) {
+                mcs = true;
+                continue;
+            }
+            char mbuf[6];
+            snprintf(mbuf, sizeof(mbuf), "G%d", this->modal);
+            single.replace(0, 3, mbuf);
+            mcs = true;
+        }
+        THEROBOT->next_command_is_MCS = mcs;
+        mcs = false;
+        this->gcode(single);
+    }
+}
+
+// hands a single motion or modal gcode to Robot, dwells are only added up
+void DryRun::gcode(const string& command)
+{
+    Gcode gcode(command, &StreamOutput::NullStream, false, this->lines);
+    if (!gcode.has_g) return;
+
+    switch (gcode.g) {
+        case 0: case 1: case 2: case 3:
+            this->modal = gcode.g;
+            break;
+
+        case 4:
+            // P is milliseconds, or seconds in grbl mode, S is seconds
+            if (gcode.has_letter('P')) this->dwell_secs += THEKERNEL->is_grbl_mode() ? gcode.get_value('P') : gcode.get_value('P') / 1000.0F;
+            if (gcode.has_letter('S')) this->dwell_secs += gcode.get_value('S');
+            return;
+
+        case 17: case 18: case 19: case 20: case 21: case 90: case 91:
+        case 54: case 55: case 56: case 57: case 58: case 59:
+            break;
+
+        default:
+            // homing, probing and setting offsets would touch the machine or its settings
+            return;
+    }
+
+    THEROBOT->on_gcode_received(&gcode);
+}
+
+void DryRun::finish()
+{
+    if (this->fd == NULL) return;
+    fclose(this->fd);
+    this->fd = NULL;
+
+    THECONVEYOR->set_dry_run(false);
+    this->stats = THECONVEYOR->get_dry_run_stats();
+
+    THEROBOT->pop_state();
+    THEROBOT->plane_axis_0 = this->plane_axis_0;
+    THEROBOT->plane_axis_1 = this->plane_axis_1;
+    THEROBOT->plane_axis_2 = this->plane_axis_2;
+    THEROBOT->set_s_value(this->s_value);
+    THEROBOT->next_command_is_MCS = false;
+    THEROBOT->reset_position_from_current_actuator_position();
+
+    float total = this->get_total_secs();
+    this->tool_secs[this->tool] += total - this->tool_start;
+    this->run_us = us_ticker_read() - this->start_us;
+}
+
+float DryRun::get_tool_secs(int tool) const
+{
+    auto t = this->tool_secs.find(tool);
+    return t == this->tool_secs.end() ? 0 : t->second;
+}
+
+void DryRun::report(StreamOutput *stream) const
+{
+    if (this->aborted) {
+        stream->printf("Dry run aborted\r\n");
+        return;
+    }
+
+    unsigned long est = lroundf(this->get_total_secs());
+    stream->printf("Dry run done, %lu lines, %lu moves in %lu ms, est time: %02lu:%02lu:%02lu\r\n", this->lines, this->stats.blocks,
+                   this->run_us / 1000, est / 3600, (est % 3600) / 60, est % 60);
+    stream->printf("feed limited: %1.1f s, planner limited: %1.1f s, dwell: %1.1f s\r\n",
+                   this->stats.nominal_secs, this->stats.total_secs - this->stats.nominal_secs, this->dwell_secs);
+    for (auto &t : this->tool_secs) {
+        est = lroundf(t.second);
+        stream->printf("T%d: %02lu:%02lu:%02lu\r\n", t.first, est / 3600, (est % 3600) / 60, est % 60);
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <map>
+
+#include "Conveyor.h"
+using std::string;
+
+class StreamOutput;
+
+// time step() plans lines for on each pass of the main loop
+#define DRY_RUN_SLICE_US 5000
+
+// Runs the moves of a file through Robot and the Planner with the Conveyor in dry run mode, nothing reaches the step ticker.
+// Only motion, dwell and modal gcodes are processed, M codes and gcodes that home, probe or change offsets are skipped,
+// tool changes (T.. M6) flush the queue so the time can be split per tool.
+// The Player calls step() from on_main_loop until it is done, so the rest of the firmware keeps running while a long file
+// is planned. Robot is only planning the file in between, nothing else may send it moves until finish().
+class DryRun {
+    public:
+        DryRun();
+
+        // saves the Robot state and puts the Conveyor in dry run mode, false if the file can not be opened
+        bool start(const string& filename);
+        // plans lines for about slice_us, false once the file is done or the machine halted
+        bool step(uint32_t slice_us);
+        // leaves dry run mode and puts Robot back as it was
+        void finish();
+        void report(StreamOutput *stream) const;
+
+        bool is_running() const { return fd != NULL; }
+        bool was_aborted() const { return aborted; }
+        const string& get_filename() const { return filename; }
+        float get_total_secs() const { return stats.total_secs + dwell_secs; }
+        float get_tool_secs(int tool) const;
+
+    private:
+        void line(string line);
+        void gcode(const string& command);
+
+        FILE *fd;
+        string filename;
+        Conveyor::dry_run_stats_t stats;
+        std::map<int, float> tool_secs;
+        float tool_start;
+        float dwell_secs;
+        float s_value;
+        uint32_t start_us;
+        uint32_t run_us;
+        unsigned long lines;
+        int tool;
+        int pending_tool;
+        uint8_t modal;
+        uint8_t plane_axis_0, plane_axis_1, plane_axis_2;
+        bool discard;
+        bool aborted;
+};
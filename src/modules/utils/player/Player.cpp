@@ -14,13 +14,17 @@
 #include "SerialConsole.h"
 #include "libs/SerialMessage.h"
 #include "libs/StreamOutputPool.h"
+#include "libs/InputScheduler.h"
 #include "libs/StreamOutput.h"
+#include "libs/Crc16.h"
 #include "Gcode.h"
 #include "checksumm.h"
 #include "Config.h"
 #include "ConfigValue.h"
 #include "SDFAT.h"
-#include "md5.h"
+#include "FileHash.h"
+#include "SectorWriter.h"
+#include "ConfigImage.h"
 
 #include "modules/robot/Conveyor.h"
 #include "DirHandle.h"
@@ -28,6 +32,7 @@
 #include "PublicDataRequest.h"
 #include "PublicData.h"
 #include "PlayerPublicAccess.h"
+#include "JobAnalyzerPublicAccess.h"
 #include "TemperatureControlPublicAccess.h"
 #include "TemperatureControlPool.h"
 #include "StepTicker.h"
@@ -49,6 +54,7 @@
 #define before_resume_gcode_checksum      CHECKSUM("before_resume_gcode")
 #define leave_heaters_on_suspend_checksum CHECKSUM("leave_heaters_on_suspend")
 #define laser_module_clustering_checksum 	  CHECKSUM("laser_module_clustering")
+#define play_echo_batch_checksum          CHECKSUM("play_echo_batch")
 
 extern SDFAT mounter;
 
@@ -57,7 +63,6 @@ unsigned char xbuff[XBUFF_LENGTH] __attribute__((section("AHBSRAM1"))); /* 2 for
 unsigned char fbuff[4096] __attribute__((section("AHBSRAM1")));
 char error_msg[64] __attribute__((section("AHBSRAM1")));
 char md5buf[64] __attribute__((section("AHBSRAM1")));
-extern const unsigned short crc_table[256];
 // used for XMODEM
 #define WAIT_MD5  0x01
 #define WAIT_FILE_VIEW  0x02
@@ -73,10 +78,14 @@ Player::Player()
     this->playing_file = false;
     this->current_file_handler = nullptr;
     this->booted = false;
+    this->input_source = 0;
     this->elapsed_secs = 0;
     this->reply_stream = nullptr;
+    this->dry_run_stream = nullptr;
     this->inner_playing = false;
     this->slope = 0.0;
+    this->estimated_secs = 0;
+    this->clear_checkpoints();
 }
 
 void Player::on_module_loaded()
@@ -89,6 +98,8 @@ void Player::on_module_loaded()
     this->register_for_event(ON_GCODE_RECEIVED);
     this->register_for_event(ON_HALT);
 
+    this->input_source = THEKERNEL->input->add_source("file");
+
     this->on_boot_gcode = THEKERNEL->config->value(on_boot_gcode_checksum)->by_default("/sd/on_boot.gcode")->as_string();
     this->on_boot_gcode_enable = THEKERNEL->config->value(on_boot_gcode_enable_checksum)->by_default(false)->as_bool();
 
@@ -101,11 +112,17 @@ void Player::on_module_loaded()
     this->leave_heaters_on = THEKERNEL->config->value(leave_heaters_on_suspend_checksum)->by_default(false)->as_bool();
 
     this->laser_clustering = THEKERNEL->config->value(laser_module_clustering_checksum)->by_default(false)->as_bool();
+
+    // bytes of verbose play output sent per frame, 0 sends every line and ack on its own
+    this->echo_batch = THEKERNEL->config->value(play_echo_batch_checksum)->by_default(480)->as_number();
+    // a frame is built in fbuff around its payload
+    if(this->echo_batch > sizeof(fbuff) - 9) this->echo_batch = sizeof(fbuff) - 9;
 }
 
 void Player::on_halt(void* argument)
 {
     this->clear_buffered_queue();
+    this->echo_stream.flush();
 
     if(argument == nullptr && this->playing_file ) {
         abort_command("1", &(StreamOutput::NullStream));
@@ -123,6 +140,7 @@ void Player::on_halt(void* argument)
 void Player::on_second_tick(void *)
 {
     if(this->playing_file) this->elapsed_secs++;
+    this->echo_stream.flush();
 }
 
 // extract any options found on line, terminates args at the space before the first option (-v)
@@ -181,6 +199,7 @@ void Player::on_gcode_received(void *argument)
             this->played_lines = 0;
             this->elapsed_secs = 0;
             this->playing_lines = 0;
+            this->clear_checkpoints();
             this->goto_line = 0;
 
         } else if (gcode->m == 24) { // start print
@@ -252,6 +271,7 @@ void Player::on_gcode_received(void *argument)
             this->played_lines = 0;
             this->elapsed_secs = 0;
             this->playing_lines = 0;
+            this->clear_checkpoints();
             this->goto_line = 0;
 
         } else if (gcode->m == 600) { // suspend print, Not entirely Marlin compliant, M600.1 will leave the heaters on
@@ -342,6 +362,12 @@ void Player::play_command( string parameters, StreamOutput *stream )
 
     // extract any options from the line and terminate the line there
     string options= extract_options(parameters);
+
+    // -d plans the file without moving anything to estimate how long it will take
+    if( options.find_first_of("Dd") != string::npos ) {
+        this->dry_run_command(absolute_from_relative(shift_parameter(parameters)), stream);
+        return;
+    }
     // Get filename which is the entire parameter line upto any options found or entire line
     this->filename = absolute_from_relative(shift_parameter(parameters));
     this->last_filename = this->filename;
@@ -376,8 +402,9 @@ void Player::play_command( string parameters, StreamOutput *stream )
     if( options.find_first_of("Vv") == string::npos ) {
         this->current_stream = nullptr;
     } else {
-        // we send to the kernels stream as it cannot go away
-        this->current_stream = THEKERNEL->streams;
+        // we send to the kernels stream as it cannot go away, batched so the link is not flooded with tiny frames
+        this->echo_stream.set_target(THEKERNEL->streams, this->echo_batch);
+        this->current_stream = &this->echo_stream;
     }
 
     // get size of file
@@ -394,6 +421,7 @@ void Player::play_command( string parameters, StreamOutput *stream )
     this->played_lines = 0;
     this->elapsed_secs = 0;
     this->playing_lines = 0;
+    this->clear_checkpoints();
     this->goto_line = 0;
 
     // force into absolute mode
@@ -404,6 +432,43 @@ void Player::play_command( string parameters, StreamOutput *stream )
     THEROBOT->reset_position_from_current_actuator_position();
 }
 
+// plans the file a slice at a time from on_main_loop, see DryRun.h
+void Player::dry_run_command( string filename, StreamOutput *stream )
+{
+    if (this->playing_file || this->dry_run.is_running() || THEKERNEL->is_suspending() || THEKERNEL->is_waiting() || !THECONVEYOR->is_idle()) {
+        stream->printf("Machine is busy, dry run needs an idle machine\r\n");
+        return;
+    }
+
+    if (!this->dry_run.start(filename)) {
+        stream->printf("File not found: %s\r\n", filename.c_str());
+        return;
+    }
+    stream->printf("Dry run %s\r\n", filename.c_str());
+    this->dry_run_stream = stream;
+
+    // nothing else may send Robot moves while it plans the file, lines wait until it is done
+    THEKERNEL->input->hold(true);
+}
+
+void Player::dry_run_slice()
+{
+    if (this->dry_run.step(DRY_RUN_SLICE_US)) return;
+
+    this->dry_run.finish();
+    THEKERNEL->input->hold(false);
+    if (!this->dry_run.was_aborted()) {
+        this->estimated_filename = this->dry_run.get_filename();
+        this->estimated_secs = this->dry_run.get_total_secs();
+
+        // kept with the analysis of the file so it is there after a reset as well
+        job_planned_time planned = { this->estimated_filename, this->estimated_secs };
+        PublicData::set_value(job_analyzer_checksum, planned_time_checksum, &planned);
+    }
+    this->dry_run.report(this->dry_run_stream);
+    this->dry_run_stream = nullptr;
+}
+
 // Goto a certain line when playing a file
 void Player::goto_command( string parameters, StreamOutput *stream )
 {
@@ -426,23 +491,45 @@ void Player::goto_command( string parameters, StreamOutput *stream )
         // goto line
         char buf[130]; // lines upto 128 characters are allowed, anything longer is discarded
 
-        // goto file begin
-        fseek(this->current_file_handler, 0, SEEK_SET);
-        played_lines = 0;
-        played_cnt   = 0;
+        // start from the last checkpoint at or before the line, or the file begin
+        this->read_lines = 0;
+        this->read_bytes = 0;
+        for (size_t i = this->checkpoints.size(); i > 0; --i) {
+            if (this->checkpoints[i - 1].line <= this->goto_line) {
+                this->read_lines = this->checkpoints[i - 1].line;
+                this->read_bytes = this->checkpoints[i - 1].offset;
+                break;
+            }
+        }
 
-        while (fgets(buf, sizeof(buf), this->current_file_handler) != NULL) {
+        // the index saved by the job analyzer survives a reopen or a restart, a line has to end just before its offset
+        struct job_line_offset known;
+        known.filename = this->filename;
+        known.line = this->goto_line;
+        if (PublicData::get_value(job_analyzer_checksum, find_line_checksum, &known) && known.line > this->read_lines &&
+            known.offset > 0 && fseek(this->current_file_handler, known.offset - 1, SEEK_SET) == 0 &&
+            fgetc(this->current_file_handler) == '\n') {
+            this->read_lines = known.line;
+            this->read_bytes = known.offset;
+        }
+        if (fseek(this->current_file_handler, this->read_bytes, SEEK_SET) != 0) {
+            fseek(this->current_file_handler, 0, SEEK_SET);
+            this->read_lines = 0;
+            this->read_bytes = 0;
+        }
+        played_lines = this->read_lines;
+        played_cnt   = this->read_bytes;
+
+        while (played_lines < this->goto_line && fgets(buf, sizeof(buf), this->current_file_handler) != NULL) {
         	if (played_lines % 100 == 0) {
                 THEKERNEL->call_event(ON_IDLE);
         	}
         	int len = strlen(buf);
             if (len == 0) continue; // empty line? should not be possible
 
+            line_read(len);
             played_lines += 1;
             played_cnt += len;
-            if (played_lines >= this->goto_line) {
-            	break;
-            }
         }
     }
 }
@@ -468,7 +555,17 @@ void Player::progress_command( string parameters, StreamOutput *stream )
 
     if(file_size > 0) {
         unsigned long est = 0;
-        if(this->elapsed_secs > 10) {
+        float planned = (this->filename == this->estimated_filename) ? this->estimated_secs : 0;
+        void *returned_data;
+        if(planned == 0 && PublicData::get_value(job_analyzer_checksum, get_analysis_checksum, &returned_data)) {
+            // or one from an earlier dry run, cached with the analysis of the file
+            job_analysis *analysis = static_cast<job_analysis *>(returned_data);
+            if(analysis->complete && analysis->filename == this->filename) planned = analysis->planned_secs;
+        }
+        if(planned > 0) {
+            // a dry run of this file is far more accurate than the byte rate
+            if(planned > this->elapsed_secs) est = planned - this->elapsed_secs;
+        } else if(this->elapsed_secs > 10) {
             unsigned long bytespersec = played_cnt / this->elapsed_secs;
             if(bytespersec > 0)
                 est = (file_size - played_cnt) / bytespersec;
@@ -498,6 +595,7 @@ void Player::abort_command( string parameters, StreamOutput *stream )
         return;
     }
 
+    this->echo_stream.flush();
     this->current_stream = NULL;
     fclose(current_file_handler);
     current_file_handler = NULL;
@@ -516,6 +614,7 @@ void Player::abort_command( string parameters, StreamOutput *stream )
 	    this->played_cnt = 0;
 	    this->played_lines = 0;
 	    this->playing_lines = 0;
+	    this->clear_checkpoints();
 	    this->goto_line = 0;
 	    this->file_size = 0;
 	    this->clear_buffered_queue();
@@ -550,6 +649,7 @@ void Player::abort_command( string parameters, StreamOutput *stream )
 	    this->played_cnt = 0;
 	    this->played_lines = 0;
 	    this->playing_lines = 0;
+	    this->clear_checkpoints();
 	    this->goto_line = 0;
 	    this->file_size = 0;
 	    this->clear_buffered_queue();
@@ -564,6 +664,35 @@ void Player::clear_buffered_queue(){
 	}
 }
 
+void Player::clear_checkpoints()
+{
+    this->checkpoints.clear();
+    this->checkpoint_lines = PLAYER_CHECKPOINT_LINES;
+    this->read_lines = 0;
+    this->read_bytes = 0;
+}
+
+// counts every piece fgets returns the way goto does, and remembers where every checkpoint_lines-th one ends
+void Player::line_read(int len)
+{
+    this->read_lines += 1;
+    this->read_bytes += len;
+    if (this->read_lines % this->checkpoint_lines != 0) return;
+    if (!this->checkpoints.empty() && this->checkpoints.back().line >= this->read_lines) return;
+
+    if (this->checkpoints.size() >= PLAYER_CHECKPOINTS) {
+        size_t n = 0;
+        for (size_t i = 1; i < this->checkpoints.size(); i += 2) {
+            this->checkpoints[n++] = this->checkpoints[i];
+        }
+        this->checkpoints.resize(n);
+        this->checkpoint_lines *= 2;
+        if (this->read_lines % this->checkpoint_lines != 0) return;
+    }
+    checkpoint_t c = { this->read_lines, this->read_bytes };
+    this->checkpoints.push_back(c);
+}
+
 void Player::on_main_loop(void *argument)
 {
     if( !this->booted ) {
@@ -582,11 +711,21 @@ void Player::on_main_loop(void *argument)
 
     }
 
+    if ( this->dry_run.is_running() ) {
+        this->dry_run_slice();
+        return;
+    }
+
     if ( this->playing_file ) {
         if(THEKERNEL->is_halted() || THEKERNEL->is_suspending() || THEKERNEL->is_waiting() || this->inner_playing) {
             return;
         }
 
+        // a jog or a line from the host that is waiting goes first
+        if (THEKERNEL->input->should_yield(this->input_source, INPUT_FILE)) {
+            return;
+        }
+
         // check if there are bufferd command
         while (!this->buffered_queue.empty()) {
         	THEKERNEL->streams->printf("%s\r\n", this->buffered_queue.front().c_str());
@@ -597,7 +736,7 @@ void Player::on_main_loop(void *argument)
 			this->buffered_queue.pop();
 
 			// waits for the queue to have enough room
-			THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message);
+			THEKERNEL->input->execute(this->input_source, message);
             return;
         }
 
@@ -620,6 +759,7 @@ void Player::on_main_loop(void *argument)
 
             int len = strlen(buf);
             if (len == 0) continue; // empty line? should not be possible
+            line_read(len);
             if (buf[len - 1] == '\n' || feof(this->current_file_handler)) {
                 if(discard) { // we are discarding a long line
                     discard = false;
@@ -711,7 +851,7 @@ void Player::on_main_loop(void *argument)
 
                 // waits for the queue to have enough room
                 // this->current_stream->printf("Run: %s", buf);
-                THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message);
+                THEKERNEL->input->execute(this->input_source, message);
                 // fputs(buf, this->temp_file_handler);
                 // THEKERNEL->streams->printf("0-[Line: %d] %s\n", message.line, buf);
                 played_lines += 1;
@@ -730,12 +870,14 @@ void Player::on_main_loop(void *argument)
         played_cnt = 0;
         played_lines = 0;
         playing_lines = 0;
+        clear_checkpoints();
         goto_line = 0;
         file_size = 0;
 
         fclose(this->current_file_handler);
         current_file_handler = NULL;
 
+        this->echo_stream.flush();
         this->current_stream = NULL;
 
         if(this->reply_stream != NULL) {
@@ -973,19 +1115,6 @@ void Player::resume_command(string parameters, StreamOutput *stream )
 	stream->printf("Playing file resumed\n");
 }
 
-unsigned int Player::crc16_ccitt(unsigned char *data, unsigned int len)
-{
-	unsigned char tmp;
-	unsigned short crc = 0;
-
-	for (unsigned int i = 0; i < len; i ++) {
-        tmp = ((crc >> 8) ^ data[i]) & 0xff;
-        crc = ((crc << 8) ^ crc_table[tmp]) & 0xffff;
-	}
-
-	return crc & 0xffff;
-}
-
 int Player::check_crc(int crc, unsigned char *data, unsigned int len)
 {
     if (crc) {
@@ -1126,6 +1255,7 @@ void Player::upload_command( string parameters, StreamOutput *stream )
     uint32_t u32filesize = 0;
     uint32_t starttime;
     uint32_t seq;
+    SectorWriter writer;
     
     char buf[] = "ok\r\n";
 
@@ -1183,6 +1313,9 @@ void Player::upload_command( string parameters, StreamOutput *stream )
     	goto upload_error;
     }
 	
+	// packets are written in whole sectors, straight from the receive buffer where possible
+	writer.attach(fd);
+
 	// stop TIMER0 and TIMER1 for save time
 	NVIC_DisableIRQ(TIMER0_IRQn);
 	NVIC_DisableIRQ(TIMER1_IRQn);
@@ -1234,6 +1367,10 @@ void Player::upload_command( string parameters, StreamOutput *stream )
 	                {
 	                	total_packet = (recv_buff[3]<<24) | (recv_buff[4]<<16) | (recv_buff[5]<<8) | recv_buff[6];
 	                	packet_size = (recv_buff[7]<<8) | recv_buff[8];
+	                	// the whole file at most, allocated now rather than a cluster at a time while packets arrive
+	                	if (total_packet > 0 && total_packet <= 0xFFFFFFFFUL / packet_size) {
+	                		writer.reserve(total_packet * packet_size);
+	                	}
 	                	sequence = 1;   
 	                	xbuff[0] = (HEADER>>8)&0xFF;
 						xbuff[1] = HEADER&0xFF;
@@ -1283,15 +1420,12 @@ void Player::upload_command( string parameters, StreamOutput *stream )
 							stream->printf(error_msg);
 							break;
 						}
-	                	// Set the file write system buffer 4096 Byte
-			        	setvbuf(fd, (char*)fbuff, _IOFBF, 4096);
-						if( fwrite(&recv_buff[7], sizeof(char), data_len, fd) != data_len)
+						if(!writer.write((const uint8_t *)&recv_buff[7], data_len))
 						{
 							sprintf(error_msg, "Error: File Write error!retry...\r\n");
 							stream->printf(error_msg);
 							break;
 						}
-						fflush(fd);
 						u32filesize += data_len;
 						
 						if(sequence < total_packet)
@@ -1317,6 +1451,12 @@ void Player::upload_command( string parameters, StreamOutput *stream )
 						}
 						else
 						{
+							if(!writer.flush())
+							{
+								sprintf(error_msg, "Error: File Write error!\r\n");
+						        SendMessage(PTYPE_FILE_CAN, buf, sizeof(buf), stream);
+								goto upload_error;
+							}
 					        SendMessage(PTYPE_FILE_END, buf, 0, stream);	//the end flag of upload
 							FileRcvState = WAIT_MD5;
 	                		retry = 0;
@@ -1427,6 +1567,8 @@ upload_success:
 		fclose(fd_md5);
 		fd_md5 = NULL;
 	}
+	// the upload may have replaced a config file without changing its size or date
+	ConfigImage::remove();
 
     THEKERNEL->set_uploading(false);
 	//if file is lzCompress file,then need to Decompress
@@ -1453,32 +1595,38 @@ upload_success:
 
 
 void Player::test_command( string parameters, StreamOutput* stream ) {
-    string filename = absolute_from_relative(shift_parameter(parameters));   
-	FILE *fd = fopen(filename.c_str(), "rb");
-	if (NULL != fd) {
-        MD5 md5;
-        do {
-            size_t n = fread(md5buf, 1, sizeof(md5buf), fd);
-            if (n > 0) md5.update(md5buf, n);
-            THEKERNEL->call_event(ON_IDLE);
-        } while (!feof(fd));
-        strcpy(md5_str, md5.finalize().hexdigest().c_str());
-        fclose(fd);
-        fd = NULL;
-	}
+    string filename = absolute_from_relative(shift_parameter(parameters));
+    string digest;
+    if (md5_file(filename, digest)) {
+        strcpy(md5_str, digest.c_str());
+    }
 }
 
+// Download protocol
+// The controller requests the MD5, then the file view (packet count and packet size), then each data packet by sequence number.
+// By default this is lockstep: one PTYPE_FILE_DATA request per packet.
+// If the download command is given -w<n> the transfer is windowed: the file view reply carries two extra bytes (window, flags),
+// each PTYPE_FILE_DATA request is a cumulative ack (the next sequence the controller expects) and up to <n> packets are kept in flight.
+// A PTYPE_FILE_RETRY rewinds to the last acked sequence and resends from there (go-back-N).
+// flags bit 0 is set when the payload is the QuickLZ compressed image from the .lz folder, the controller has to decompress it.
+#define DOWNLOAD_MAX_WINDOW		16
+#define DOWNLOAD_FLAG_QLZ		0x01
+
 void Player::download_command( string parameters, StreamOutput *stream )
 {
     long packetno = 0;
     long file_size = 0;
     long filesendseq = 0;
+    long sentseq = 0;
+    long nextreadseq = 1;
+    long lastseq = 0;
+    long window = 1;
     char lastcmd = 0;
+    char flags = 0;
     char *recv_buff;
     char errorcmd = 0;
 	int bufsz = 8192;
     int cmd = 0;
-    int c = 0;
     unsigned int len;
     int crc = 0;
     uint32_t starttime;
@@ -1488,10 +1636,17 @@ void Player::download_command( string parameters, StreamOutput *stream )
     // open file
 	memset(error_msg, 0, sizeof(error_msg));
 	sprintf(error_msg, "Nothing!");
+    string options = extract_options(parameters);
     string filename = absolute_from_relative(shift_parameter(parameters));
     string md5_filename = change_to_md5_path(filename);
     string lz_filename = change_to_lz_path(filename);
 
+    size_t wpos = options.find_first_of("Ww");
+    if (wpos != string::npos) {
+    	window = strtol(options.c_str() + wpos + 1, NULL, 10);
+    	window = confine(window, 1, DOWNLOAD_MAX_WINDOW);
+    }
+
 	// diasble irq
     if (stream->type() == 0) {
     	bufsz = 128;
@@ -1526,7 +1681,9 @@ void Player::download_command( string parameters, StreamOutput *stream )
     }
 	
 	fd = fopen(lz_filename.c_str(), "rb");		//first try to open /.lz/filename
-	if (NULL == fd) {	
+	if (NULL != fd) {
+		flags |= DOWNLOAD_FLAG_QLZ;
+	} else {
 	    fd = fopen(filename.c_str(), "rb");
 	    if (NULL == fd) {
 			SendMessage(PTYPE_FILE_CAN, buf, sizeof(buf), stream);
@@ -1562,10 +1719,12 @@ void Player::download_command( string parameters, StreamOutput *stream )
                 	fseek(fd, 0, SEEK_END);
 					file_size = ftell(fd);
 					rewind(fd);
+					nextreadseq = 1;
+					sentseq = 0;
 					packetno = file_size/bufsz + ((file_size%bufsz) >0 ? 1: 0) ;	
 					xbuff[0] = (HEADER>>8)&0xFF;
 					xbuff[1] = HEADER&0xFF;
-					len = 6 + 3;
+					len = window > 1 ? 8 + 3 : 6 + 3;
 					xbuff[2] = (len>>8)&0xFF;
 					xbuff[3] = len&0xFF;
 					xbuff[4] = PTYPE_FILE_VIEW;					
@@ -1575,11 +1734,15 @@ void Player::download_command( string parameters, StreamOutput *stream )
 					xbuff[8] = packetno&0xff;
 					xbuff[9] = (bufsz>>8)&0xff;
 					xbuff[10] = bufsz&0xff;
+					if (window > 1) {
+						xbuff[11] = window&0xff;
+						xbuff[12] = flags;
+					}
 					crc = crc16_ccitt(&xbuff[2], len);
-					xbuff[6+5] = (crc>>8)&0xFF;
-					xbuff[6+6] = crc&0xFF;
-					xbuff[6+7] = (FOOTER>>8)&0xFF;
-					xbuff[6+8] = FOOTER&0xFF;
+					xbuff[len+2] = (crc>>8)&0xFF;
+					xbuff[len+3] = crc&0xFF;
+					xbuff[len+4] = (FOOTER>>8)&0xFF;
+					xbuff[len+5] = FOOTER&0xFF;
 					
 					stream->puts((char *)xbuff, len+6);
 					lastcmd = PTYPE_FILE_VIEW;
@@ -1588,29 +1751,26 @@ void Player::download_command( string parameters, StreamOutput *stream )
                 case PTYPE_FILE_DATA:
                 	if( !beretry )
 						filesendseq = recv_buff[3]<<24 | recv_buff[4]<<16 | recv_buff[5]<<8 | recv_buff[6];
-					xbuff[0] = (HEADER>>8)&0xFF;
-					xbuff[1] = HEADER&0xFF;
-					xbuff[4] = PTYPE_FILE_DATA;
-					xbuff[5] = (filesendseq >>24) & 0xff;
-					xbuff[6] = (filesendseq >>16) & 0xff;
-					xbuff[7] = (filesendseq >>8) & 0xff;
-					xbuff[8] = filesendseq & 0xff;
-					fseek(fd, (filesendseq-1)*bufsz, SEEK_SET);
-					c = fread(&xbuff[9], sizeof(char), bufsz, fd);
-					if (c <= 0) {
+                	if (window > 1) {
+                		// filesendseq is the cumulative ack, a retry or an ack past what was sent rewinds the window to it
+                		if (beretry || filesendseq > sentseq) {
+                			sentseq = filesendseq - 1;
+                		}
+                		lastseq = filesendseq + window - 1;
+                		if (lastseq > packetno) lastseq = packetno;
+                		while (sentseq < lastseq) {
+                			if (send_file_packet(fd, sentseq + 1, bufsz, nextreadseq, stream) <= 0) {
+								sprintf(error_msg, "Error: Machine read file error!\r\n");
+								SendMessage(PTYPE_FILE_CAN, buf, sizeof(buf), stream);
+								goto download_error;
+                			}
+                			sentseq ++;
+                		}
+                	} else if (send_file_packet(fd, filesendseq, bufsz, nextreadseq, stream) <= 0) {
 						sprintf(error_msg, "Error: Machine read file error!\r\n");
 						SendMessage(PTYPE_FILE_CAN, buf, sizeof(buf), stream);
 						goto download_error;
-					}                	
-					len = c + 7;
-					xbuff[2] = (len>>8)&0xFF;
-					xbuff[3] = len&0xFF;
-					crc = crc16_ccitt(&xbuff[2], len);
-					xbuff[c+9] = (crc>>8)&0xFF;
-					xbuff[c+10] = crc&0xFF;
-					xbuff[c+11] = (FOOTER>>8)&0xFF;
-					xbuff[c+12] = FOOTER&0xFF;
-					stream->puts((char *)xbuff, len+6);
+					}
 					lastcmd = PTYPE_FILE_DATA;
 					errorcmd = 0;
 					beretry = false;
@@ -1677,6 +1837,43 @@ download_success:
 	return;
 }
 
+// Read packet seq (1 based) of the file and send it as a PTYPE_FILE_DATA frame.
+// next_seq tracks the file position so sequential packets do not need a seek, returns the payload size or <= 0 on read error
+int Player::send_file_packet(FILE *fd, long seq, int bufsz, long &next_seq, StreamOutput *stream)
+{
+	int crc = 0;
+	unsigned int len;
+
+	if (seq != next_seq) {
+		fseek(fd, (seq-1)*bufsz, SEEK_SET);
+	}
+	int c = fread(&xbuff[9], sizeof(char), bufsz, fd);
+	if (c <= 0) {
+		next_seq = 0;
+		return c;
+	}
+	next_seq = c == bufsz ? seq + 1 : 0;
+
+	xbuff[0] = (HEADER>>8)&0xFF;
+	xbuff[1] = HEADER&0xFF;
+	xbuff[4] = PTYPE_FILE_DATA;
+	xbuff[5] = (seq >>24) & 0xff;
+	xbuff[6] = (seq >>16) & 0xff;
+	xbuff[7] = (seq >>8) & 0xff;
+	xbuff[8] = seq & 0xff;
+	len = c + 7;
+	xbuff[2] = (len>>8)&0xFF;
+	xbuff[3] = len&0xFF;
+	crc = crc16_ccitt(&xbuff[2], len);
+	xbuff[c+9] = (crc>>8)&0xFF;
+	xbuff[c+10] = crc&0xFF;
+	xbuff[c+11] = (FOOTER>>8)&0xFF;
+	xbuff[c+12] = FOOTER&0xFF;
+	stream->puts((char *)xbuff, len+6);
+
+	return c;
+}
+
 void Player::SendMessage(char cmd, char* s, int size , StreamOutput *stream)
 {	
     int crc = 0;
@@ -9,6 +9,8 @@
 #pragma once
 
 #include "Module.h"
+#include "BatchedStream.h"
+#include "DryRun.h"
 
 #include <stdio.h>
 #include <string>
@@ -19,6 +21,11 @@ using std::string;
 
 class StreamOutput;
 
+// line to file offset checkpoints taken while a file is read, so goto can seek close to the line
+// instead of reading the file from the start, thinned to every other one when full
+#define PLAYER_CHECKPOINTS 128
+#define PLAYER_CHECKPOINT_LINES 256
+
 class Player : public Module {
     public:
         Player();
@@ -43,12 +50,13 @@ class Player : public Module {
         void upload_command( string parameters, StreamOutput* stream );
         void download_command( string parameters, StreamOutput* stream );
         void test_command(string parameters, StreamOutput* stream );
+        void dry_run_command( string filename, StreamOutput* stream );
+        void dry_run_slice();
         string extract_options(string& args);
 
         void set_serial_rx_irq(bool enable);
         int inbyte(StreamOutput *stream, unsigned int timeout_ms);
         int inbytes(StreamOutput *stream, char **buf, int size, unsigned int timeout_ms);
-        unsigned int crc16_ccitt(unsigned char *data, unsigned int len);
         int check_crc(int crc, unsigned char *data, unsigned int len);
 		
 		int decompress(string sfilename, string dfilename, uint32_t sfilesize, StreamOutput* stream);
@@ -56,6 +64,7 @@ class Player : public Module {
         // 2024
         // bool check_cluster(const char *gcode_str, float *x_value, float *y_value, float *distance, float *slope, float *s_value);
         void SendMessage(char cmd, char* s, int size , StreamOutput *stream);
+        int send_file_packet(FILE *fd, long seq, int bufsz, long &next_seq, StreamOutput *stream);
 
         string filename;
         string last_filename;
@@ -65,11 +74,34 @@ class Player : public Module {
         StreamOutput* current_stream;
         StreamOutput* reply_stream;
 
+        // echo and acks of a verbose play are coalesced here and flushed once a second or when full
+        BatchedStream echo_stream;
+        uint16_t echo_batch;
+
         char md5_str[64];
 
+        // the dry run in progress and where its report goes
+        DryRun dry_run;
+        StreamOutput* dry_run_stream;
+
+        // result of the last dry run, used for the remaining time while that file plays
+        string estimated_filename;
+        float estimated_secs;
+
         std::queue<string> buffered_queue;
         void clear_buffered_queue();
 
+        struct checkpoint_t {
+            unsigned long line;
+            unsigned long offset;
+        };
+        std::vector<checkpoint_t> checkpoints;
+        unsigned long checkpoint_lines;
+        unsigned long read_lines;
+        unsigned long read_bytes;
+        void clear_checkpoints();
+        void line_read(int len);
+
         FILE* current_file_handler;
         // FILE* temp_file_handler;
         long file_size;
@@ -79,6 +111,7 @@ class Player : public Module {
         unsigned long goto_line;
         unsigned int playing_lines;
         uint8_t current_motion_mode;
+        uint8_t input_source;
         float saved_position[3]; // only saves XYZ
         float slope;
         std::map<uint16_t, float> saved_temperatures;
@@ -17,6 +17,7 @@
 #include "libs/StreamOutput.h"
 #include "libs/StreamOutputPool.h"
 #include "libs/gpio.h"
+#include "libs/Crc16.h"
 #include "Conveyor.h"
 #include "DirHandle.h"
 #include "mri.h"
@@ -46,6 +47,12 @@
 #include "SDFAT.h"
 #include "Thermistor.h"
 #include "md5.h"
+#include "FileHash.h"
+#include "ConfigImage.h"
+#include "BootProfile.h"
+#include "AllocProfile.h"
+#include "Realtime.h"
+#include "InputScheduler.h"
 #include "utils.h"
 #include "AutoPushPop.h"
 #include "MainButtonPublicAccess.h"
@@ -57,7 +64,6 @@
 #include "mbed.h" // for wait_ms()
 
 extern unsigned int g_maximumHeapAddress;
-extern const unsigned short crc_table[256];
 
 #define XBUFF_LENGTH	8208
 extern unsigned char xbuff[XBUFF_LENGTH];
@@ -116,6 +122,12 @@ const SimpleShell::ptentry_t SimpleShell::commands_table[] = {
     {"calc_thermistor", SimpleShell::calc_thermistor_command},
     {"thermistors", SimpleShell::print_thermistors_command},
     {"md5sum",   SimpleShell::md5sum_command},
+    {"checksum", SimpleShell::checksum_command},
+    {"rtstat",   SimpleShell::rtstat_command},
+    {"inputstat", SimpleShell::inputstat_command},
+    {"sdstat",   SimpleShell::sdstat_command},
+    {"boot",     SimpleShell::boot_command},
+    {"alloc",    SimpleShell::alloc_command},
 	{"time",   SimpleShell::time_command},
     {"test",     SimpleShell::test_command},
     {"model",  SimpleShell::model_command},
@@ -390,6 +402,9 @@ void SimpleShell::on_console_line_received( void *argument )
         		|| cmd == "goto") {
             // these are handled by Player module
 
+        } else if (cmd == "analyze") {
+            // handled by JobAnalyzer module
+
         } else if (cmd == "laser") {
             // these are handled by Laser module
 
@@ -731,12 +746,16 @@ void SimpleShell::mem_command( string parameters, StreamOutput *stream)
     stream->printf("Total Free RAM: %lu bytes\r\n", m + f);
 
     stream->printf("Free AHB0: %lu, AHB1: %lu\r\n", AHB0.free(), AHB1.free());
+    AHB0.stats(stream);
+    AHB1.stats(stream);
     if (verbose) {
         AHB0.debug(stream);
         AHB1.debug(stream);
     }
 
     stream->printf("Block size: %u bytes, Tickinfo size: %u bytes\n", sizeof(Block), sizeof(Block::tickinfo_t) * Block::n_actuators);
+    stream->printf("AHB0 block queue: %u blocks, %u bytes, sector cache: %lu bytes\n", (unsigned)THECONVEYOR->get_queue_size(),
+                   (unsigned)(THECONVEYOR->get_queue_size() * sizeof(Block)), mounter.cache.memory());
 }
 
 static uint32_t getDeviceType()
@@ -1763,23 +1782,80 @@ void SimpleShell::md5sum_command( string parameters, StreamOutput *stream )
 {
 	string filename = absolute_from_relative(parameters);
 
-	// Open file
-	FILE *lp = fopen(filename.c_str(), "r");
-	if (lp == NULL) {
+	string digest;
+	if (!md5_file(filename, digest)) {
 		stream->printf("File not found: %s\r\n", filename.c_str());
 		return;
 	}
-	MD5 md5;
-	uint8_t buf[64];
-	do {
-		size_t n= fread(buf, 1, sizeof buf, lp);
-		if(n > 0) md5.update(buf, n);
-		THEKERNEL->call_event(ON_IDLE);
-	} while(!feof(lp));
 
-	stream->printf("%s %s\n", md5.finalize().hexdigest().c_str(), filename.c_str());
-	fclose(lp);
+	stream->printf("%s %s\n", digest.c_str(), filename.c_str());
+}
+
+// prints the Adler-32 of a file, a lot faster than md5sum for checking a file is intact
+void SimpleShell::checksum_command( string parameters, StreamOutput *stream )
+{
+	string filename = absolute_from_relative(parameters);
+
+	uint32_t sum;
+	if (!adler32_file(filename, sum)) {
+		stream->printf("File not found: %s\r\n", filename.c_str());
+		return;
+	}
+
+	stream->printf("%08lx %s\n", sum, filename.c_str());
+}
+
+// prints how long realtime commands took from arriving to being acted on, -r clears the counts
+void SimpleShell::rtstat_command( string parameters, StreamOutput *stream )
+{
+	Realtime *rt = Realtime::getInstance();
+	if (rt == nullptr) {
+		stream->printf("No realtime handler\r\n");
+		return;
+	}
+
+	rt->report(stream);
+	if (shift_parameter(parameters) == "-r") {
+		memset(rt->latency, 0, sizeof(rt->latency));
+		rt->refreshes = 0;
+	}
+}
+
+void SimpleShell::inputstat_command( string parameters, StreamOutput *stream )
+{
+	THEKERNEL->input->report(stream);
+	if (shift_parameter(parameters) == "-r") {
+		THEKERNEL->input->reset_stats();
+	}
+}
+
+void SimpleShell::sdstat_command( string parameters, StreamOutput *stream )
+{
+	mounter.cache.report(stream);
+	if (shift_parameter(parameters) == "-r") {
+		mounter.cache.reset_stats();
+	}
+}
 
+// how long each step of boot took
+void SimpleShell::boot_command( string parameters, StreamOutput *stream )
+{
+	BootProfile::report(stream);
+}
+
+// counts heap allocations by caller, alloc-symbolize.py names the callers
+void SimpleShell::alloc_command( string parameters, StreamOutput *stream )
+{
+	string what = shift_parameter(parameters);
+	if (what == "on") {
+		if (AllocProfile::start()) stream->printf("counting allocations\r\n");
+		else stream->printf("no memory for the allocation profile\r\n");
+	} else if (what == "off") {
+		AllocProfile::stop();
+		AllocProfile::report(stream);
+	} else {
+		AllocProfile::report(stream);
+	}
 }
 
 // runs several types of test on the mechanisms
@@ -2031,14 +2107,15 @@ void SimpleShell::help_command( string parameters, StreamOutput *stream )
     stream->printf("rm file [-e]\r\n");
     stream->printf("mv file newfile [-e]\r\n");
     stream->printf("remount\r\n");
-    stream->printf("play file [-v]\r\n");
+    stream->printf("play file [-v] [-d] - -d plans the file without moving to estimate its run time\r\n");
     stream->printf("progress - shows progress of current play\r\n");
     stream->printf("abort - abort currently playing file\r\n");
+    stream->printf("analyze [file] [-f] - pre-flight check of a file, shows bounds, tools and rough time\r\n");
     stream->printf("reset - reset smoothie\r\n");
     stream->printf("dfu - enter dfu boot loader\r\n");
     stream->printf("break - break into debugger\r\n");
     stream->printf("config-get [<configuration_source>] <configuration_setting>\r\n");
-    stream->printf("config-set [<configuration_source>] <configuration_setting> <value>\r\n");
+    stream->printf("config-set [<configuration_source>] <configuration_setting> <value> [<configuration_setting> <value> ...]\r\n");
     stream->printf("get [pos|wcs|state|status|fk|ik]\r\n");
     stream->printf("get temp [bed|hotend]\r\n");
     stream->printf("set_temp bed|hotend 185\r\n");
@@ -2053,6 +2130,12 @@ void SimpleShell::help_command( string parameters, StreamOutput *stream )
     stream->printf("calc_thermistor [-s0] T1,R1,T2,R2,T3,R3 - calculate the Steinhart Hart coefficients for a thermistor\r\n");
     stream->printf("thermistors - print out the predefined thermistors\r\n");
     stream->printf("md5sum file - prints md5 sum of the given file\r\n");
+    stream->printf("checksum file - prints adler32 checksum of the given file\r\n");
+    stream->printf("rtstat [-r] - prints realtime command latencies, -r clears them\r\n");
+    stream->printf("inputstat [-r] - prints how lines from each input were scheduled, -r clears the counts\r\n");
+    stream->printf("sdstat [-r] - prints sd sector cache hit rates, -r clears them\r\n");
+    stream->printf("boot - prints how long each step of boot took\r\n");
+    stream->printf("alloc [on|off] - counts heap allocations by caller, prints the counts\r\n");
 }
 
 // output all configs
@@ -2151,6 +2234,7 @@ void SimpleShell::config_restore_command( string parameters, StreamOutput *strea
     };
     fclose(current_lp);
     fclose(default_lp);
+    ConfigImage::remove();
 
     stream->printf("Settings restored complete.\n");
 }
@@ -2206,16 +2290,3 @@ void SimpleShell::PacketMessage(char cmd, const char* s, int size, StreamOutput
 	
 	stream->puts((char *)fbuff, len+6);
 }
-
-unsigned int SimpleShell::crc16_ccitt(unsigned char *data, unsigned int len)
-{
-	unsigned char tmp;
-	unsigned short crc = 0;
-
-	for (unsigned int i = 0; i < len; i ++) {
-        tmp = ((crc >> 8) ^ data[i]) & 0xff;
-        crc = ((crc << 8) ^ crc_table[tmp]) & 0xffff;
-	}
-
-	return crc & 0xffff;
-}
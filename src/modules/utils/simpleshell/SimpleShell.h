@@ -52,6 +52,12 @@ private:
     static void calc_thermistor_command( string parameters, StreamOutput *stream);
     static void print_thermistors_command( string parameters, StreamOutput *stream);
     static void md5sum_command( string parameters, StreamOutput *stream);
+    static void checksum_command( string parameters, StreamOutput *stream);
+    static void rtstat_command( string parameters, StreamOutput *stream);
+    static void inputstat_command( string parameters, StreamOutput *stream);
+    static void sdstat_command( string parameters, StreamOutput *stream);
+    static void boot_command( string parameters, StreamOutput *stream);
+    static void alloc_command( string parameters, StreamOutput *stream);
     static void grblDP_command( string parameters, StreamOutput *stream);
 
     static void switch_command(string parameters, StreamOutput *stream );
@@ -93,7 +99,6 @@ private:
     
     static void PacketMessage(char cmd, const char* s, int size, StreamOutput *stream);
     
-    static unsigned int crc16_ccitt(unsigned char *data, unsigned int len);
 
     typedef void (*PFUNC)(string parameters, StreamOutput *stream);
     typedef struct {
@@ -26,10 +26,14 @@
 #include "Gcode.h"
 #include "modules/robot/Conveyor.h"
 #include "libs/StreamOutputPool.h"
+#include "libs/InputScheduler.h"
 #include "libs/StreamOutput.h"
 #include "SwitchPublicAccess.h"
 #include "WifiPublicAccess.h"
 #include "libs/utils.h"
+#include "libs/Crc16.h"
+#include "platform_memory.h"
+#include "BootProfile.h"
 
 #include "libs/SerialMessage.h"
 #include "libs/StreamOutput.h"
@@ -49,54 +53,34 @@
 #define udp_send_port_checksum		      CHECKSUM("udp_send_port")
 #define udp_recv_port_checksum		      CHECKSUM("udp_recv_port")
 #define tcp_timeout_s_checksum			  CHECKSUM("tcp_timeout_s")
+#define tx_batch_size_checksum			  CHECKSUM("tx_batch_size")
 
 #define XBUFF_LENGTH	8208
 extern unsigned char xbuff[XBUFF_LENGTH];
 extern unsigned char fbuff[4096];
 __attribute__((section("AHBSRAM1"), aligned(4))) char WifiSerialbuff[544];
 
-unsigned short crc_table[] = {
-	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
-	0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
-	0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
-	0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
-	0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
-	0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
-	0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
-	0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
-	0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
-	0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
-	0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
-	0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
-	0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
-	0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
-	0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
-	0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
-	0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
-	0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
-	0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
-	0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
-	0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
-	0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
-	0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
-	0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
-	0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
-	0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
-	0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
-	0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
-	0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
-	0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
-	0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
-	0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
-};
-
-WifiProvider::WifiProvider()
+WifiProvider::WifiProvider() : parser((uint8_t *)WifiSerialbuff, sizeof(WifiSerialbuff)), batch(this)
 {
 	tcp_link_no = 0;
 	udp_link_no = 1;
 	wifi_init_ok = false;
+	bring_up_state = WIFI_UP;
+	bring_up_until = 0;
+	bring_up_start = 0;
 	has_data_flag = false;
+	has_client = true; // until the module says otherwise
 	connection_fail_count = 0;
+	ptrData = 0;
+	rx_len = 0;
+	ptr_xbuff = 0;
+	rx_crc = 0;
+	last_rx_us = 0;
+	input_source = 0;
+	draining = false;
+	tx_buff = nullptr;
+	tx_size = 0;
+	tx_len = 0;
 }
 
 void WifiProvider::on_module_loaded()
@@ -113,6 +97,14 @@ void WifiProvider::on_module_loaded()
 	this->tcp_timeout_s = THEKERNEL->config->value(wifi_checksum, tcp_timeout_s_checksum)->by_default(10)->as_int();
 	this->machine_name = THEKERNEL->config->value(wifi_checksum, machine_name_checksum)->by_default("CARVERA")->as_string();
 
+	// small writes are collected here and sent as one block, without it every write is its own SPI transfer and TCP segment
+	uint16_t batch = THEKERNEL->config->value(wifi_checksum, tx_batch_size_checksum)->by_default(512)->as_int();
+	if (batch > WIFI_DATA_MAX_SIZE) batch = WIFI_DATA_MAX_SIZE;
+	if (batch > 0) {
+		this->tx_buff = (u8 *)AHB0.alloc(batch);
+		if (this->tx_buff != nullptr) this->tx_size = batch;
+	}
+
     // Init Wifi Module
     this->init_wifi_module(false);
 
@@ -132,8 +124,8 @@ void WifiProvider::on_module_loaded()
     }
     delete smoothie_pin;
 
-    // Add to the pack of streams kernel can call to, for example for broadcasting
-    THEKERNEL->streams->append_stream(this);
+    // Added to the pack of streams kernel can call to once the module is up, see bring_up
+    this->input_source = THEKERNEL->input->add_source("wifi");
 
     query_flag = false;
     diagnose_flag = false;
@@ -153,156 +145,117 @@ void WifiProvider::on_pin_rise()
 	has_data_flag = true;
 }
 
-void WifiProvider::receive_wifi_data() {
+// pulls one burst of whatever the module has buffered into WifiData, drops anything from the udp link
+bool WifiProvider::fill_rx(u16 max_len)
+{
 	u8 link_no;
-	u16 revcnt = 0;
 	u16 status;
-	u16 errorcnt = 0;
-	uint8_t headerBuffer[2];	
-    uint32_t received = 0;
-    uint32_t timeout_ms = 100000;	//100 ms
-    uint32_t starttime = 0;
-    u8 RecvData;
-    
-    // wait head
-    starttime = us_ticker_read();
-    while ((received < 2) && ((us_ticker_read() - starttime) < timeout_ms) ) {
-    	revcnt = M8266WIFI_SPI_RecvData(&RecvData, 1, WIFI_DATA_TIMEOUT_MS, &link_no, &status);
-		if ((link_no == udp_link_no) || (revcnt == 0)) {
-			continue;
-		}
-		
-		headerBuffer[0] = headerBuffer[1];
-		received++;
-        headerBuffer[1] = RecvData;
-        if (received >= 2 && (headerBuffer[0] != ((HEADER >> 8) & 0xFF) || 
-                             headerBuffer[1] != (HEADER & 0xFF))) {
-            received = 1;
-            errorcnt ++;
-        }
-    }
-    if( errorcnt > 20)
-    {
-    	THEKERNEL->streams->puts("Please use Controller version V0.9.12 or later to connect.\r\n", 124); 
-    	return;
-    }
-	    
-    if (received < 2){
-//	    PacketMessage(PTYPE_NORMAL_INFO, "ALARM: Abort receive header\r\n", 0);
-    	return;
-    }
-    
-    // receive length	    
-    starttime = us_ticker_read();
-    while ((received < 4) && ((us_ticker_read() - starttime) < timeout_ms) ) {
-    	revcnt = M8266WIFI_SPI_RecvData(&RecvData, 1, WIFI_DATA_TIMEOUT_MS, &link_no, &status);
-		if ((link_no == udp_link_no) || (revcnt == 0)) {
-			continue;
-		}
-    	WifiSerialbuff[received] = RecvData;
-        received ++;
-    }
-    
-    if (received < 4){
-//	    	PacketMessage(PTYPE_NORMAL_INFO, "ALARM: Abort receive length\r\n", 0);
-    	return;
-    }
-    
-    uint16_t data_len = (WifiSerialbuff[2]<<8) | WifiSerialbuff[3];
-    uint16_t total_len = 4 + data_len + 2; // header + data + crc + tail
-    
-    if (data_len > 513 || total_len > sizeof(WifiSerialbuff)){
-//	    	PacketMessage(PTYPE_NORMAL_INFO, "ALARM: Abort receive datalen error\r\n", 0);
-    	 return; 
-    }
-    
-    starttime = us_ticker_read();
-    while ((received < total_len) && ((us_ticker_read() - starttime) < timeout_ms) ) {	    	
-    	revcnt = M8266WIFI_SPI_RecvData(&RecvData, 1, WIFI_DATA_TIMEOUT_MS, &link_no, &status);
-		if ((link_no == udp_link_no) || (revcnt == 0)) {
-			continue;
-		}
-    	WifiSerialbuff[received] = RecvData;
-        received ++;
-    }
-    
-    if (received < total_len) {
-//	    PacketMessage(PTYPE_NORMAL_INFO, "ALARM: Abort receive data body\r\n", 0);
-    	return;
-    }    
-	    
-    // check tail
-    uint16_t tail = (WifiSerialbuff[total_len-2]<<8) | WifiSerialbuff[total_len-1];
-    if (tail != FOOTER) {
-//	    	PacketMessage(PTYPE_NORMAL_INFO, "ALARM: Abort receive footer\r\n", 0);
-    	return;
-    }
-    
-/*	    
-    // check CRC
-    uint16_t received_crc = (WifiSerialbuff[total_len-4] << 8) | WifiSerialbuff[total_len-3];
-	uint16_t calculated_crc = crc16_ccitt((unsigned char *)&WifiSerialbuff[2], data_len);
-    if (received_crc != calculated_crc) {
-//	    	PacketMessage(PTYPE_NORMAL_INFO, "ALARM: Abort receive wrong crc\r\n", 0);
-        return;
-    }
-*/
-	uint8_t cmdType = WifiSerialbuff[4];
-    switch(cmdType) {
-        case PTYPE_CTRL_SINGLE: { 
-            if(WifiSerialbuff[5] == '?') {
-            	query_flag = true;
-        	}
-        	else if(WifiSerialbuff[5] == 'X' - 'A' + 1) {
-            	halt_flag = true;
-        	}
-        	else if(THEKERNEL->is_feed_hold_enabled()) {
-	            if(WifiSerialbuff[5] == '!') { // safe pause
-	                THEKERNEL->set_feed_hold(true);
-	            }
-	            else if(WifiSerialbuff[5] == '~') { // safe resume
-	                THEKERNEL->set_feed_hold(false);
-	            }
-	        }
-            break;
-        }
-        case PTYPE_CTRL_MULTI: {
-            struct SerialMessage message;
-            message.message.assign(WifiSerialbuff+5, data_len-3);
-            message.stream = this;
-            THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message );
-            break;
-        }
-        case PTYPE_FILE_START: {
-            struct SerialMessage message;
-            message.message.assign(WifiSerialbuff+5,data_len-3);
-            message.stream = this;
-            THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message );
-            break;
-        }
-        	
-        default:
-        	break;
-    }
 
+	this->ptrData = 0;
+	this->rx_len = 0;
+	u16 received = M8266WIFI_SPI_RecvData(WifiData, (max_len == 0 || max_len > WIFI_DATA_MAX_SIZE) ? WIFI_DATA_MAX_SIZE : max_len,
+			WIFI_DATA_TIMEOUT_MS, &link_no, &status);
+	if (received == 0 || link_no == udp_link_no) {
+		return false;
+	}
+	if (int(status & 0xff) == 0x20 || int(status & 0xff) == 0x22 || int(status & 0xff) == 0x2f) {
+		THEKERNEL->streams->printf("wifi recv, received: %d, status:%d, high: %d, low: %d!\n", received, status, int(status >> 8), int(status & 0xff));
+		return false;
+	}
+	this->rx_len = received;
+	this->has_client = true;
+	return true;
 }
 
+// feeds everything received so far to the frame parser, partial frames are kept for the next pass
+// stops while the input scheduler has no room for another line, the rest of WifiData is parsed once it has
+void WifiProvider::receive_wifi_data(bool signalled) {
+	uint32_t now = us_ticker_read();
+	uint32_t skipped = this->parser.skipped;
+	bool got = false;
 
-unsigned int WifiProvider::crc16_ccitt(unsigned char *data, unsigned int len)
-{
-	unsigned char tmp;
-	unsigned short crc = 0;
+	if (this->draining) {
+		if (!THEKERNEL->input->idle(this->input_source)) return;
+		this->draining = false;
+	}
+
+	for (int burst = 0; burst < WIFI_RECV_BURSTS; ++burst) {
+		if (!THEKERNEL->input->has_room(this->input_source)) break;
+		if (this->ptrData >= this->rx_len) {
+			// only the interrupt pin is trusted without asking, an empty receive would wait out its timeout
+			if ((burst > 0 || !signalled) && !M8266WIFI_SPI_Has_DataReceived()) break;
+			if (!fill_rx(0)) break;
+		}
+		got = true;
+		while (this->ptrData < this->rx_len && THEKERNEL->input->has_room(this->input_source)) {
+			if (this->parser.feed(WifiData[this->ptrData++])) {
+				// a file transfer started from here carries on reading this same buffer through gets()
+				handle_frame();
+				if (this->draining) break;
+			}
+		}
+		if (this->ptrData < this->rx_len) break;
+	}
 
-	for (unsigned int i = 0; i < len; i ++) {
-        tmp = ((crc >> 8) ^ data[i]) & 0xff;
-        crc = ((crc << 8) ^ crc_table[tmp]) & 0xffff;
+	// controller apps before V0.9.12 send plain lines, which never make a frame
+	if (this->parser.skipped - skipped > 20) {
+		THEKERNEL->streams->puts("Please use Controller version V0.9.12 or later to connect.\r\n", 0);
 	}
 
-	return crc & 0xffff;
+	if (got) {
+		this->last_rx_us = now;
+	} else if (this->parser.in_frame() && now - this->last_rx_us > 100000) {
+		// drop a partial frame after 100ms of silence so a lost byte cannot swallow the next frame
+		this->parser.reset();
+	}
+}
+
+void WifiProvider::handle_frame() {
+	const char *payload = (const char *)this->parser.payload();
+	switch(this->parser.type()) {
+		case PTYPE_CTRL_SINGLE: {
+			if(payload[0] == '?') {
+				query_flag = true;
+			}
+			else if(payload[0] == 'X' - 'A' + 1) {
+				halt_flag = true;
+			}
+			else if(THEKERNEL->is_feed_hold_enabled()) {
+				if(payload[0] == '!') { // safe pause
+					THEKERNEL->set_feed_hold(true);
+				}
+				else if(payload[0] == '~') { // safe resume
+					THEKERNEL->set_feed_hold(false);
+				}
+			}
+			break;
+		}
+		case PTYPE_CTRL_BATCH:
+			this->batch.add(this->parser.payload(), this->parser.payload_len());
+			break;
+
+		case PTYPE_CTRL_MULTI:
+			THEKERNEL->input->submit(this->input_source, this, std::string(payload, this->parser.payload_len()));
+			break;
+
+		case PTYPE_FILE_START:
+			// the upload reads the rest of the transfer itself, nothing more may be parsed until it has run
+			THEKERNEL->input->submit(this->input_source, this, std::string(payload, this->parser.payload_len()));
+			this->draining = true;
+			break;
+
+		default:
+			break;
+	}
+}
+
+
+bool WifiProvider::connected() {
+	return this->has_client;
 }
 
 bool WifiProvider::ready() {
-	return M8266WIFI_SPI_Has_DataReceived();
+	return this->ptrData < this->rx_len || M8266WIFI_SPI_Has_DataReceived();
 }
 
 void WifiProvider::get_broadcast_from_ip_and_netmask(char *broadcast_addr, char *ip_addr, char *netmask)
@@ -341,6 +294,11 @@ void WifiProvider::on_second_tick(void *)
 	if (!wifi_init_ok || THEKERNEL->is_uploading()) return;
 
 	if (M8266WIFI_SPI_List_Clients_On_A_TCP_Server(tcp_link_no, &client_num, RemoteClients, &status)) {
+		has_client = client_num > 0;
+		if (!has_client) {
+			// nobody to send it to
+			tx_len = 0;
+		}
 
 		if (M8266WIFI_SPI_Get_STA_Connection_Status(&connection_status, &status)) {
 			if (connection_status == 5) {
@@ -395,11 +353,17 @@ void WifiProvider::on_second_tick(void *)
 
 void WifiProvider::on_idle(void *argument)
  {
+	if (!wifi_init_ok) {
+		bring_up();
+		return;
+	}
+
 	if (THEKERNEL->is_uploading()) return;
 
-	if (has_data_flag || M8266WIFI_SPI_Has_DataReceived()) {
+	if (has_data_flag || this->parser.in_frame() || this->ptrData < this->rx_len || M8266WIFI_SPI_Has_DataReceived()) {
+		bool signalled = has_data_flag;
 		has_data_flag = false;
-		receive_wifi_data();
+		receive_wifi_data(signalled);
 	}
 
     if (query_flag) {
@@ -422,11 +386,15 @@ void WifiProvider::on_idle(void *argument)
             PacketMessage(PTYPE_NORMAL_INFO, "HALTED, M999 or $X to exit HALT state\r\n", 0);
         }
     }
+
+    // last thing in the main loop pass, realtime replies and all the acks of this pass go out together
+    flush_tx();
 }
 
 void WifiProvider::on_main_loop(void *argument)
 {
-    
+    // not from on_idle, which runs inside lines, the input scheduler says when a batch line may start
+    batch.dispatch(this->input_source);
 }
 
 void WifiProvider::PacketMessage(char cmd, const char* s, int size)
@@ -508,13 +476,37 @@ int WifiProvider::printf(const char *format, ...)
 int WifiProvider::puts(const char* s, int size)
 {
 	size_t total_length = size == 0 ? strlen(s) : size;
+	if (this->tx_buff == nullptr || total_length > this->tx_size) {
+		// too big to batch, send whatever is waiting first to keep the order
+		if (!flush_tx()) return 0;
+		return send_data((const u8 *)s, total_length);
+	}
+	// frames are never split between two sends
+	if (this->tx_len + total_length > this->tx_size && !flush_tx()) {
+		return 0;
+	}
+	memcpy(&this->tx_buff[this->tx_len], s, total_length);
+	this->tx_len += total_length;
+	return total_length;
+}
+
+// sends everything collected by puts, called at the end of each main loop pass and before waiting for input
+bool WifiProvider::flush_tx()
+{
+	if (this->tx_len == 0) return true;
+	size_t len = this->tx_len;
+	this->tx_len = 0;
+	return send_data(this->tx_buff, len) == len;
+}
+
+size_t WifiProvider::send_data(const u8 *data, size_t len)
+{
     size_t sent_index = 0;
 	u16 status = 0;
 	u32 sent = 0;
 	u32 to_send = 0;
-    while (sent_index < total_length) {
-    	to_send = total_length - sent_index > WIFI_DATA_MAX_SIZE ? WIFI_DATA_MAX_SIZE : total_length - sent_index;
-    	memcpy(WifiData, s + sent_index, to_send);
+    while (sent_index < len) {
+    	to_send = len - sent_index > WIFI_DATA_MAX_SIZE ? WIFI_DATA_MAX_SIZE : len - sent_index;
 		// errcode:
 		// 	0x13: Wrong link_no used
 		// 	0x14: connection by link_no not present
@@ -522,7 +514,7 @@ int WifiProvider::puts(const char* s, int size)
 		// 	0x18: No clients connecting to this TCP server
 		// 	0x1E: too many errors ecountered during sending can not fixed
 		// 	0x1F: Other errors
-    	sent = M8266WIFI_SPI_Send_BlockData(WifiData, to_send, 500, tcp_link_no, NULL, 0, &status);
+    	sent = M8266WIFI_SPI_Send_BlockData((u8 *)data + sent_index, to_send, 500, tcp_link_no, NULL, 0, &status);
     	sent_index += sent;
 		if (sent == to_send) {
 			continue;
@@ -535,57 +527,61 @@ int WifiProvider::puts(const char* s, int size)
 
 int WifiProvider::_putc(int c)
 {
-	u16 status = 0;
-	u8 to_send = c;
-	if (M8266WIFI_SPI_Send_Data(&to_send, 1, tcp_link_no, &status) == 0) {
-		return 0;
-	} else {
-		return 1;
-	}
+	char to_send = c;
+	return puts(&to_send, 1);
 }
 
 int WifiProvider::_getc()
 {
 	u16 status;
 	u8 to_recv = 0, link_no;
+	flush_tx();
+	if (this->ptrData < this->rx_len) {
+		return WifiData[this->ptrData++];
+	}
 	M8266WIFI_SPI_RecvData(&to_recv, 1, WIFI_DATA_TIMEOUT_MS, &link_no, &status);
 	return to_recv;
 }
 
 int WifiProvider::gets(char** buf, int size)
 {
-	u8 link_no;
-	static u16 received = 0;
-	u16 status;
 	static uint8_t headerBuffer[2];
     static uint8_t footerBuffer[2];
     static uint16_t bytesNeeded = 2;
     uint16_t expectedLength = 0;
     uint16_t checksum;
     
-	if(this->ptrData == 0)
+	// whoever waits for input has to see its own replies go out first
+	flush_tx();
+
+	// bytes left over from the last burst are used up before asking the module for more
+	if(this->ptrData >= this->rx_len && !fill_rx(size))
 	{
-		received = M8266WIFI_SPI_RecvData(WifiData,
-				(size == 0 || size > WIFI_DATA_MAX_SIZE) ? WIFI_DATA_MAX_SIZE : size, WIFI_DATA_TIMEOUT_MS, &link_no, &status);
-		if (link_no == udp_link_no) {
-			// THEKERNEL->streams->printf("gets, data from udp");
-			return 0;
-		}
-		if (int(status & 0xff) == 0x20 || int(status & 0xff) == 0x22 || int(status & 0xff) == 0x2f) {
-			THEKERNEL->streams->printf("gets, received: %d, status:%d, high: %d, low: %d!\n", received, status, int(status >> 8), int(status & 0xff));
-			return 0;
-		}
+		return 0;
 	}
 	
-	for (int i = this->ptrData; i < received; i ++) {
-		uint8_t byte;
-		byte = WifiData[i];
-		if(i == received -1)
-		{
-			this->ptrData = 0;
+	while (this->ptrData < this->rx_len) {
+		if (this->currentState == READ_DATA) {
+			// the body is copied a burst at a time and the crc is run over it on the way in,
+			// so a file packet is not read a second time just to check it
+			uint16_t n = this->rx_len - this->ptrData;
+			if (n > bytesNeeded) n = bytesNeeded;
+			memcpy(&xbuff[this->ptr_xbuff], &WifiData[this->ptrData], n);
+			// the last two bytes of the body are the crc itself
+			uint16_t covered = bytesNeeded > 2 ? bytesNeeded - 2 : 0;
+			if (covered > n) covered = n;
+			this->rx_crc = crc16_ccitt(&xbuff[this->ptr_xbuff], covered, this->rx_crc);
+			this->ptrData += n;
+			this->ptr_xbuff += n;
+			bytesNeeded -= n;
+			if (bytesNeeded == 0) {
+				this->currentState = CHECK_FOOTER;
+				bytesNeeded = 2;
+			}
+			continue;
 		}
-		else
-			this->ptrData = i;
+
+		uint8_t byte = WifiData[this->ptrData++];
 		switch(this->currentState) {
             case WAIT_HEADER:
                 headerBuffer[0] = headerBuffer[1];
@@ -594,41 +590,29 @@ int WifiProvider::gets(char** buf, int size)
                 if(checksum == HEADER) {
                     this->currentState = READ_LENGTH;
                     bytesNeeded = 2;
-                    memset(xbuff, 0, sizeof(xbuff));
+                    this->ptr_xbuff = 0;
+                    this->rx_crc = 0;
                 }
                 break;
             case READ_LENGTH:
-	            xbuff[this->ptr_xbuff] = byte;
-	            if(++this->ptr_xbuff >= XBUFF_LENGTH) 
-	            {
-	            	this->ptr_xbuff = 0;
-	            	this->currentState = WAIT_HEADER;
-	            	return 0;
-	            }
+	            xbuff[this->ptr_xbuff++] = byte;
+	            this->rx_crc = crc16_ccitt_update(this->rx_crc, byte);
 	            
 	            if(--bytesNeeded == 0) {
 	                expectedLength = (xbuff[0] << 8) | xbuff[1];
-	                if(expectedLength >=0 && expectedLength<=XBUFF_LENGTH)
+	                // type and crc are always there, and the whole body has to fit behind the length
+	                if(expectedLength >= 3 && this->ptr_xbuff + expectedLength <= XBUFF_LENGTH)
 	                {
 	                    this->currentState = READ_DATA;
 	                    bytesNeeded = expectedLength;
 	                }
 	                else
 	                {
+	                	this->ptr_xbuff = 0;
 	                	this->currentState = WAIT_HEADER;
 	                }
 	            }
             	break;
-            
-            case READ_DATA:
-	            xbuff[this->ptr_xbuff] = byte;
-	            if(++this->ptr_xbuff >= XBUFF_LENGTH) this->ptr_xbuff = XBUFF_LENGTH -1;
-	            
-                if(--bytesNeeded == 0) {
-                    this->currentState = CHECK_FOOTER;
-                    bytesNeeded = 2;
-                }
-                break;
                 
             case CHECK_FOOTER:
                 footerBuffer[0] = footerBuffer[1];
@@ -639,8 +623,12 @@ int WifiProvider::gets(char** buf, int size)
                     if(checksum == FOOTER) {
                         return CheckFilePacket(buf);
                     }
+                    this->ptr_xbuff = 0;
                 }
                 break;
+
+            default:
+                break;
         }
 	}
 	return 0;	
@@ -652,7 +640,7 @@ int WifiProvider::CheckFilePacket(char** buf) {
 	// CRC校验
     uint16_t calcCRC = 0;
     uint16_t receivedCRC = 0;
-    calcCRC = crc16_ccitt(xbuff, this->ptr_xbuff-2); // 最后两个字节是CRC
+    calcCRC = this->rx_crc; // 最后两个字节是CRC, gets() already ran the crc over everything before them
     receivedCRC = (xbuff[this->ptr_xbuff-2] << 8) | xbuff[this->ptr_xbuff-1];
     this->ptr_xbuff = 0;
     
@@ -684,6 +672,11 @@ void WifiProvider::on_gcode_received(void *argument)
 {
     Gcode *gcode = static_cast<Gcode*>(argument);
     if (gcode->has_m) {
+    	if (!wifi_init_ok && (gcode->m == 481 || gcode->m == 489) && !(gcode->m == 481 && gcode->subcode == 1)) {
+    		// everything else talks to the module
+    		gcode->stream->printf("WiFi module is not up yet\n");
+    		return;
+    	}
     	if (gcode->m == 481)  {
     		// basic wifi operations
 			if (gcode->subcode == 1) {
@@ -849,7 +842,7 @@ void WifiProvider::set_wifi_op_mode(u8 op_mode) {
 
 void WifiProvider::on_get_public_data(void* argument) {
     PublicDataRequest* pdr = static_cast<PublicDataRequest*>(argument);
-    if(!pdr->starts_with(wlan_checksum)) return;
+    if(!wifi_init_ok || !pdr->starts_with(wlan_checksum)) return;
     if(!pdr->second_element_is(get_wlan_checksum)
     	&& !pdr->second_element_is(get_rssi_checksum)) return;
 	
@@ -961,7 +954,7 @@ int parse_ip(const char *ip, int fields[4]) {
 void WifiProvider::on_set_public_data(void *argument)
 {
     PublicDataRequest* pdr = static_cast<PublicDataRequest*>(argument);
-    if(!pdr->starts_with(wlan_checksum)) return;
+    if(!wifi_init_ok || !pdr->starts_with(wlan_checksum)) return;
     if(!pdr->second_element_is(set_wlan_checksum)
     		&& !pdr->second_element_is(ap_set_channel_checksum)
 			&& !pdr->second_element_is(ap_set_ssid_checksum)
@@ -1104,10 +1097,9 @@ void WifiProvider::query_wifi_status() {
 	}
 }
 
+// Starts bringing the module up, which takes the best part of a second, on_idle carries on with it in bring_up
 void WifiProvider::init_wifi_module(bool reset) {
 	u16 status = 0;
-	char address[16];
-	u8 param_len = 0;
 
 
 	if (reset) {
@@ -1127,8 +1119,36 @@ void WifiProvider::init_wifi_module(bool reset) {
 
 	// THEKERNEL->streams->printf("M8266WIFI_Module_Init_Via_SPI...\n");
 
+	bring_up_start = us_ticker_read();
 	M8266HostIf_Init();
 
+	// Step 1 of M8266WIFI_Module_Init_Via_SPI, the module boots after the reset while the machine gets on with its own
+	M8266WIFI_Module_Hardware_Reset();
+	bring_up_state = WIFI_RESETTING;
+}
+
+// Waits out the reset without blocking, then does the rest of the set up once the module has booted
+void WifiProvider::bring_up() {
+	if (bring_up_state == WIFI_UP || (int32_t)(us_ticker_read() - bring_up_until) < 0) return;
+
+	if (bring_up_state == WIFI_RESETTING) {
+		M8266HostIf_Set_SPI_nCS_Pin(1);         // release/pull-high(defualt) nCS upon reset completed (Chinese: 释放/拉高(缺省)片选信号
+		// Delay more than around 500ms for M8266WIFI module bootup and initialization，including bootup information print。
+		bring_up_until = us_ticker_read() + (800 - 300 - 5 - 2) * 1000;
+		bring_up_state = WIFI_BOOTING;
+		return;
+	}
+
+	bring_up_state = WIFI_UP;
+	setup_wifi_module();
+	BootProfile::record("wifi up", bring_up_start);
+}
+
+void WifiProvider::setup_wifi_module() {
+	u16 status = 0;
+	char address[16];
+	u8 param_len = 0;
+
 	if (M8266WIFI_Module_Init_Via_SPI() == 0) {
 		THEKERNEL->streams->printf("M8266WIFI_Module_Init_Via_SPI, ERROR!\n");
 	}
@@ -1162,10 +1182,8 @@ void WifiProvider::init_wifi_module(bool reset) {
 		THEKERNEL->streams->printf("Get AP_PARAM_TYPE_NETMASK_ADDR ERROR, status:%d, high: %d, low: %d!\n", status, int(status >> 8), int(status & 0xff));
 	}
 
-	if (reset) {
-		// append stream again
-		THEKERNEL->streams->append_stream(this);
-	}
+	// Add to the pack of streams kernel can call to, for example for broadcasting
+	THEKERNEL->streams->append_stream(this);
 
 	wifi_init_ok = true;
 }
@@ -1178,7 +1196,7 @@ void WifiProvider::M8266WIFI_Module_delay_ms(u16 nms)
 			M8266HostIf_delay_us(250);
 }
 
-void WifiProvider::M8266WIFI_Module_Hardware_Reset(void) // total 800ms  (Chinese: 本例子中这个函数的总共执行时间大约800毫秒)
+void WifiProvider::M8266WIFI_Module_Hardware_Reset(void) // total 800ms  (Chinese: 本例子中这个函数的总共执行时间大约800毫秒), of which this blocks for 6ms
 {
 	M8266HostIf_Set_SPI_nCS_Pin(0);   			// Module nCS==ESP8266 GPIO15 as well, Low during reset in order for a normal reset (Chinese: 为了实现正常复位，模块的片选信号nCS在复位期间需要保持拉低)
 	M8266WIFI_Module_delay_ms(1); 	    		// delay 1ms, adequate for nCS stable (Chinese: 延迟1毫秒，确保片选nCS设置后有足够的时间来稳定)
@@ -1189,17 +1207,14 @@ void WifiProvider::M8266WIFI_Module_Hardware_Reset(void) // total 800ms  (Chines
 	                                        //(Chinese: 如果主板不是很好，导致上升下降过渡时间较长，或者因为失配存在较长的振荡时间，所以信号到轨稳定的时间较长，那么在这里可以多给一些延时)
 
 	M8266HostIf_Set_nRESET_Pin(1);					// Pull high again the nReset Pin to bring the module exiting reset state (Chinese: 拉高nReset管脚让模组退出复位状态)
-	M8266WIFI_Module_delay_ms(300); 	  		// at least 18ms required for reset-out-boot sampling boottrap pin (Chinese: 至少需要18ms的延时来确保退出复位时足够的boottrap管脚采样时间)
+	                                        // then at least 18ms required for reset-out-boot sampling boottrap pin (Chinese: 至少需要18ms的延时来确保退出复位时足够的boottrap管脚采样时间)
 	                                        // Here, we use 300ms for adequate abundance, since some board GPIO, (Chinese: 在这里我们使用了300ms的延时来确保足够的富裕量，这是因为在某些主板上，)
 																					// needs more time for stable(especially for nRESET) (Chinese: 他们的GPIO可能需要较多的时间来输出稳定，特别是对于nRESET所对应的GPIO输出)
 																					// You may shorten the time or give more time here according your board v.s. effiency
 																					// (Chinese: 如果你的主机板在这里足够好，你可以缩短这里的延时来缩短复位周期；反之则需要加长这里的延时。
 																					//           总之，你可以调整这里的时间在你们的主机板上充分测试，找到一个合适的延时，确保每次复位都能成功。并适当保持一些富裕量，来兼容批量化时主板的个体性差异)
-	M8266HostIf_Set_SPI_nCS_Pin(1);         // release/pull-high(defualt) nCS upon reset completed (Chinese: 释放/拉高(缺省)片选信号
-	//M8266WIFI_Module_delay_ms(1); 	    		// delay 1ms, adequate for nCS stable (Chinese: 延迟1毫秒，确保片选nCS设置后有足够的时间来稳定)
-
-	M8266WIFI_Module_delay_ms(800-300-5-2); // Delay more than around 500ms for M8266WIFI module bootup and initialization，including bootup information print。No influence to host interface communication. Could be shorten upon necessary. But test for verification required if adjusted.
-	                                        // (Chinese: 延迟大约500毫秒，来等待模组成功复位后完成自己的启动过程和自身初始化，包括串口信息打印。但是此时不影响模组和单片主机之间的通信，这里的时间可以根据需要适当调整.如果调整缩短了这里的时间，建议充分测试，以确保系统(时序关系上的)可靠性)
+	// the 300ms are waited out by bring_up from on_idle
+	bring_up_until = us_ticker_read() + 300 * 1000;
 }
 
 u8 WifiProvider::M8266WIFI_Module_Init_Via_SPI()
@@ -1210,7 +1225,7 @@ u8 WifiProvider::M8266WIFI_Module_Init_Via_SPI()
 	//////////////////////////////////////////////////////////////////////////////////////////////////////
 	//Step 1: To hardware reset the module (with nCS=0 during reset) and wait up the module bootup
 	//(Chinese: 步骤1：对模组执行硬复位时序(在片选nCS拉低的时候对nRESET管脚输出低高电平)，并等待模组复位启动完毕
-	M8266WIFI_Module_Hardware_Reset();
+	// done by init_wifi_module and bring_up before this is called
 
 
 	/////////////////////////////////////////////////////////////////////////////////////////////////////
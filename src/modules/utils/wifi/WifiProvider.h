@@ -18,9 +18,12 @@ using namespace std;
 
 #include "M8266WIFIDrv.h"
 #include "libs/RingBuffer.h"
+#include "libs/FrameParser.h"
+#include "libs/CommandBatch.h"
 
 #define WIFI_DATA_MAX_SIZE 1460
 #define WIFI_DATA_TIMEOUT_MS 10
+#define WIFI_RECV_BURSTS 4
 #define MAX_WLAN_SIGNALS 8
 
 enum ParseState { WAIT_HEADER, READ_LENGTH, READ_DATA, CHECK_FOOTER };
@@ -42,9 +45,10 @@ public:
     int _putc(int c);
     int _getc(void);
     bool ready();
+    bool connected();
     bool has_char(char letter);
     int type(); // 0: serial, 1: wifi
-    void reset(void){ptrData=0;ptr_xbuff=0;currentState = WAIT_HEADER;};
+    void reset(void){ptrData=0;rx_len=0;ptr_xbuff=0;currentState = WAIT_HEADER;parser.reset();};
     int printfcmd(const char cmd, const char *format, ...);
     int printf(const char *format, ...) __attribute__ ((format(printf, 2, 3)));
 
@@ -57,6 +61,8 @@ private:
     u8 M8266WIFI_Module_Init_Via_SPI();
 
     void init_wifi_module(bool reset);
+    void bring_up();
+    void setup_wifi_module();
     void query_wifi_status();
 
     uint32_t ip_to_int(char* ip_addr);
@@ -64,8 +70,11 @@ private:
     void get_broadcast_from_ip_and_netmask(char *broadcast_addr, char *ip_addr, char *netmask);
 
     void on_pin_rise();
-    void receive_wifi_data();
-    unsigned int crc16_ccitt(unsigned char *data, unsigned int len);
+    bool fill_rx(u16 max_len);
+    void receive_wifi_data(bool signalled);
+    void handle_frame();
+    bool flush_tx();
+    size_t send_data(const u8 *data, size_t len);
     int CheckFilePacket(char** buf);
     
     
@@ -95,11 +104,32 @@ private:
     	volatile bool query_flag:1;
     	volatile bool diagnose_flag:1;
     	volatile bool has_data_flag:1;
+    	bool has_client:1;
     };
     
     ParseState currentState = WAIT_HEADER;    
+    // WifiData holds the last burst received from the module, ptrData is the next unread byte
     int ptrData;
+    int rx_len;
     int ptr_xbuff;
+    uint16_t rx_crc;    // crc of the frame in xbuff so far, kept up to date as it arrives
+
+    FrameParser parser;
+    uint32_t last_rx_us;
+    CommandBatch batch;
+    uint8_t input_source;
+    bool draining;
+
+    // output collected by puts until flush_tx, tx_size of 0 sends every write straight away
+    u8 *tx_buff;
+    u16 tx_size;
+    u16 tx_len;
+
+    // the module takes most of a second to boot after its reset, on_idle waits it out instead of boot
+    enum BringUp { WIFI_UP, WIFI_RESETTING, WIFI_BOOTING };
+    BringUp bring_up_state;
+    uint32_t bring_up_until;    // us_ticker_read() time the current step is done
+    uint32_t bring_up_start;
     
 };
 
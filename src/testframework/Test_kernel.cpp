@@ -16,6 +16,7 @@ This is aprt of the Smoothie test framework, it generates a Mockable Kernl so ke
 #include "libs/SlowTicker.h"
 #include "libs/Adc.h"
 #include "libs/StreamOutputPool.h"
+#include "libs/InputScheduler.h"
 #include <mri.h>
 #include "checksumm.h"
 #include "ConfigValue.h"
@@ -58,6 +59,8 @@ Kernel::Kernel(){
 
     this->slow_ticker = new SlowTicker();
 
+    this->input = new InputScheduler();
+
     // dummies (would be nice to refactor to not have to create a conveyor)
     this->conveyor= new Conveyor();
 
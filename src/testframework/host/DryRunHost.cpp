@@ -0,0 +1,49 @@
+/*
+ * Dry run of a gcode file on the host, the same planning as play -d on the controller, see src/testframework/Readme.md
+ *
+ *   dryrun file.nc [config]
+ *
+ * The config is the machine's config file, the speeds, accelerations and junction deviation in it are what the
+ * estimate depends on, without one src/config.default is used.
+ */
+
+#include "HostMachine.h"
+#include "DryRun.h"
+#include "StreamOutput.h"
+
+#include <cstdio>
+
+// printf sends every message as a frame for the controller app, only the text in it is written out
+class StdoutStream : public StreamOutput {
+    public:
+        int puts(const char *str, int size = 0)
+        {
+            if (size < 9) return size == 0 ? fputs(str, stdout) : fwrite(str, 1, size, stdout);
+            fwrite(str + 5, 1, size - 9, stdout);
+            return size;
+        }
+};
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        printf("usage: dryrun file.nc [config]\n");
+        return 1;
+    }
+    host_machine_setup(argc > 2 ? argv[2] : nullptr);
+
+    DryRun dry_run;
+    if (!dry_run.start(argv[1])) {
+        printf("File not found: %s\n", argv[1]);
+        return 1;
+    }
+    // the same slices as on the controller, they only matter for how often the main loop would get a turn
+    unsigned long slices = 1;
+    while (dry_run.step(DRY_RUN_SLICE_US)) slices++;
+    dry_run.finish();
+
+    StdoutStream out;
+    dry_run.report(&out);
+    printf("%lu slices\n", slices);
+    return dry_run.was_aborted() ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Host side benchmark of FileHash, see src/testframework/Readme.md
+ *
+ * Writes a file of random data and hashes it the way md5sum used to, 64 bytes per buffered read with an
+ * ON_IDLE after each, and then with md5_file and adler32_file. The host disk is nothing like the card, so
+ * the times only compare the hashing and the per chunk overhead, the sums are checked against each other.
+ */
+
+#include "FileHash.h"
+#include "Kernel.h"
+#include "md5.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#define FILE_SIZE (4 * 1024 * 1024)
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    // usage: FileHashBench [bytes [file]]
+    unsigned long bytes = (argc > 1) ? strtoul(argv[1], NULL, 10) : FILE_SIZE;
+    std::string filename = (argc > 2) ? argv[2] : "filehash-bench.tmp";
+
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (fp == NULL) {
+        printf("can not write %s\n", filename.c_str());
+        return 1;
+    }
+    uint32_t r = 12345;
+    for (unsigned long i = 0; i < bytes; i++) {
+        r ^= r << 13; r ^= r >> 17; r ^= r << 5;
+        fputc(r & 0xFF, fp);
+    }
+    fclose(fp);
+
+    // as md5sum did before FileHash
+    auto start = std::chrono::steady_clock::now();
+    fp = fopen(filename.c_str(), "r");
+    MD5 md5;
+    uint8_t buf[64];
+    unsigned long idles = 0;
+    do {
+        size_t n = fread(buf, 1, sizeof buf, fp);
+        if (n > 0) md5.update(buf, n);
+        THEKERNEL->call_event(ON_IDLE);
+        idles++;
+    } while (!feof(fp));
+    fclose(fp);
+    std::string old_digest = md5.finalize().hexdigest();
+    double old_ms = elapsed_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    std::string digest;
+    md5_file(filename, digest);
+    double md5_ms = elapsed_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    uint32_t sum = 0;
+    adler32_file(filename, sum);
+    double adler_ms = elapsed_ms(start);
+
+    remove(filename.c_str());
+
+    printf("%lu bytes\n", bytes);
+    printf("  md5 64b reads:         %8.2f ms, %lu idle calls, %s\n", old_ms, idles, old_digest.c_str());
+    printf("  md5_file %ub reads:  %8.2f ms, %lu idle calls, %s\n", FILEHASH_CHUNK_SIZE, md5_ms,
+           (bytes + FILEHASH_CHUNK_SIZE - 1) / FILEHASH_CHUNK_SIZE, digest.c_str());
+    printf("  adler32_file:          %8.2f ms, %08lX\n", adler_ms, (unsigned long)sum);
+
+    if (digest != old_digest) {
+        printf("md5_file does not match\n");
+        return 1;
+    }
+    return 0;
+}
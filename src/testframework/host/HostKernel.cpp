@@ -0,0 +1,107 @@
+/*
+ * Just enough of the firmware for libs and modules to run on the host, see src/testframework/Readme.md
+ *
+ * The Kernel only passes events to the modules registered for them, AHB0 and AHB1 are pools of the same
+ * size as on the LPC1768 and the us ticker is the host clock.
+ */
+
+#include "Kernel.h"
+#include "MemoryPool.h"
+#include "Test_kernel.h"
+#include "us_ticker_api.h"
+
+#include <chrono>
+#include <map>
+
+Kernel* Kernel::instance;
+
+Kernel::Kernel()
+{
+    instance = this;
+    halted = false;
+    feed_hold = false;
+    serial = nullptr;
+    input = nullptr;
+    streams = nullptr;
+    gcode_dispatch = nullptr;
+    robot = nullptr;
+    planner = nullptr;
+    config = nullptr;
+    conveyor = nullptr;
+    configurator = nullptr;
+    simpleshell = nullptr;
+    slow_ticker = nullptr;
+    step_ticker = nullptr;
+    adc = nullptr;
+    i2c = nullptr;
+    eeprom_data = nullptr;
+    factory_set = nullptr;
+}
+
+void Kernel::add_module(Module* module, const char *name)
+{
+    module->on_module_loaded();
+}
+
+void Kernel::register_for_event(_EVENT_ENUM id_event, Module *mod)
+{
+    this->hooks[id_event].push_back(mod);
+}
+
+// as in Test_kernel.cpp, a trapped event goes to the test instead of the modules
+static std::map<_EVENT_ENUM, std::function<void(void*)>> event_traps;
+
+void test_kernel_trap_event(_EVENT_ENUM id_event, std::function<void(void*)> fnc)
+{
+    event_traps[id_event] = fnc;
+}
+
+void test_kernel_untrap_event(_EVENT_ENUM id_event)
+{
+    event_traps.erase(id_event);
+}
+
+void Kernel::call_event(_EVENT_ENUM id_event, void * argument)
+{
+    auto trap = event_traps.find(id_event);
+    if(trap != event_traps.end()) {
+        trap->second(argument);
+        return;
+    }
+
+    if(id_event == ON_HALT) {
+        this->halted = (argument == nullptr);
+    }
+
+    for (auto m : hooks[id_event]) {
+        (m->*kernel_callback_functions[id_event])(argument);
+    }
+}
+
+void Kernel::unregister_for_event(_EVENT_ENUM id_event, Module *mod)
+{
+    for (auto i = hooks[id_event].begin(); i != hooks[id_event].end(); ++i) {
+        if(*i == mod) {
+            hooks[id_event].erase(i);
+            return;
+        }
+    }
+}
+
+static Kernel host_kernel;
+
+static uint32_t ahb0_buf[16384 / 4];
+static uint32_t ahb1_buf[16384 / 4];
+static MemoryPool ahb0(ahb0_buf, sizeof(ahb0_buf));
+static MemoryPool ahb1(ahb1_buf, sizeof(ahb1_buf));
+MemoryPool* _AHB0 = &ahb0;
+MemoryPool* _AHB1 = &ahb1;
+
+// StreamOutput frames packets in this buffer, Player.cpp has it on the controller
+unsigned char fbuff[4096];
+
+uint32_t us_ticker_read(void)
+{
+    static auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,115 @@
+/*
+ * The motion part of the firmware on the host, see HostMachine.h and src/testframework/Readme.md
+ */
+
+#include "HostMachine.h"
+
+#include "Kernel.h"
+#include "Config.h"
+#include "ConfigValue.h"
+#include "ConfigImage.h"
+#include "ConfigSources/FileConfigSource.h"
+#include "Conveyor.h"
+#include "Planner.h"
+#include "Robot.h"
+#include "StepTicker.h"
+#include "StreamOutputPool.h"
+#include "checksumm.h"
+#include "MRI_Hooks.h"
+
+#include "InterruptIn.h"
+#include "port_api.h"
+#include "pwmout_api.h"
+#include "wait_api.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// the host has no image on a card, config files are parsed every time
+bool ConfigImage::load(ConfigCache *cache, uint32_t sum) { return false; }
+bool ConfigImage::save(const ConfigCache *cache, uint32_t sum) { return false; }
+
+// linked in by the firmware build from src/config.default, never used here as the config comes from a file
+char _binary_config_default_start, _binary_config_default_end;
+char _binary_config2_default_start, _binary_config2_default_end;
+
+// the host has no eeprom, the data stays in memory
+void Kernel::write_eeprom_data() {}
+
+// hardware the motion modules link against, no pin is connected on the host so none of it may be reached
+uint32_t SystemCoreClock = 100000000;
+extern "C" void wait_us(int us) {}
+void set_high_on_debug(int port, int pin) {}
+extern "C" PinName port_pin(PortName port, int pin_n) { abort(); }
+extern "C" void pwmout_init(pwmout_t* obj, PinName pin) { abort(); }
+// InterruptIn(NC) is SDFileSystem without a card detect switch, see HostSDCard.cpp
+mbed::InterruptIn::InterruptIn(PinName pin) : gpio(), gpio_irq() { if (pin != NC) abort(); }
+mbed::InterruptIn::~InterruptIn() {}
+
+// only what Robot and the Planner need, there are no timers to start
+StepTicker *StepTicker::instance;
+
+StepTicker::StepTicker()
+{
+    instance = this;
+    frequency = 100000;
+    period = 0;
+    num_motors = 0;
+    running = false;
+    current_block = nullptr;
+}
+
+StepTicker::~StepTicker()
+{
+}
+
+void StepTicker::set_frequency(float frequency)
+{
+    this->frequency = frequency;
+}
+
+int StepTicker::register_motor(StepperMotor* m)
+{
+    motor[num_motors++] = m;
+    return num_motors - 1;
+}
+
+// the pins write straight to the GPIO and pin connect registers, on the host those pages are plain memory
+static void map_registers(uintptr_t base, size_t size)
+{
+    void *p = mmap((void *)base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (p != (void *)base) {
+        printf("can not map the registers at %08lX\n", (unsigned long)base);
+        exit(1);
+    }
+}
+
+void host_machine_setup(const char *config_file)
+{
+    if (THEKERNEL->robot != nullptr) return;
+
+    map_registers(LPC_GPIO_BASE, 0x4000);
+    map_registers(LPC_PINCON_BASE, 0x1000);
+
+    Kernel *kernel = THEKERNEL;
+    kernel->streams = new StreamOutputPool();
+    kernel->factory_set = new FACTORY_SET();
+    memset(kernel->factory_set, 0, sizeof(FACTORY_SET));
+    kernel->config = new Config(new FileConfigSource(config_file == nullptr ? HOST_DEFAULT_CONFIG : config_file, "host"));
+    kernel->config->config_cache_load();
+
+    kernel->base_stepping_frequency = kernel->config->value(CHECKSUM("base_stepping_frequency"))->by_default(100000)->as_number();
+    kernel->step_ticker = new StepTicker();
+    kernel->step_ticker->set_frequency(kernel->base_stepping_frequency);
+    kernel->eeprom_data = new EEPROM_data();
+    memset(kernel->eeprom_data, 0, sizeof(EEPROM_data));
+
+    kernel->add_module(kernel->conveyor = new Conveyor());
+    kernel->add_module(kernel->robot = new Robot());
+    kernel->planner = new Planner();
+
+    kernel->config->config_cache_clear();
+    kernel->conveyor->start(kernel->robot->get_number_registered_motors());
+}
@@ -0,0 +1,10 @@
+#ifndef HOST_MACHINE_H
+#define HOST_MACHINE_H
+
+// Sets up Config, Conveyor, Robot and the Planner on the host the way Kernel and main do on the controller,
+// config is read from the given file, src/config.default with nullptr. Nothing moves, the step ticker only
+// has its frequency and the pins write to memory where the GPIO registers would be. The host kernel is not
+// in grbl mode, G4 P is milliseconds. Only the first call sets it up, the tests share one machine.
+void host_machine_setup(const char *config_file);
+
+#endif
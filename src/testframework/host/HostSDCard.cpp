@@ -0,0 +1,322 @@
+/*
+ * The card behind SDFileSystem on the host, see HostSDCard.h
+ */
+
+#include "HostSDCard.h"
+
+#include "SDDma.h"
+#include "SDCRC.h"
+#include "gpio.h"
+#include "pinmap.h"
+
+#include <string.h>
+
+HostSDCard *HostSDCard::card;
+
+// true while the block has failures left, each one is used up
+static bool fail(std::map<uint32_t, int>& faults, uint32_t lba)
+{
+    auto f = faults.find(lba);
+    if (f == faults.end() || f->second == 0) return false;
+    f->second--;
+    return true;
+}
+
+HostSDCard::HostSDCard(uint32_t sectors) : data(sectors * 512)
+{
+    cmd_len = 0;
+    in_len = -1;
+    busy = 0;
+    read_lba = write_lba = written = 0;
+    selected = false;
+    idle = true;
+    app = crc = reading = writing = multiple = false;
+    card = this;
+}
+
+char HostSDCard::clock(char in)
+{
+    if (!selected) return 0xFF;
+
+    char reply = 0xFF;
+    if (!out.empty()) {
+        reply = out.front();
+        out.pop_front();
+    } else if (busy > 0) {
+        // DO is held low while a written block is programmed
+        busy--;
+        reply = 0x00;
+    }
+    receive(in);
+
+    // a CMD18 keeps sending blocks until CMD12, an error token past the end of the card
+    if (reading && out.empty()) {
+        if (read_lba < data.size() / 512) {
+            send_block(&data[read_lba * 512], 512, !fail(bad_reads, read_lba));
+            read_lba++;
+        } else {
+            out.push_back(0x08);
+            reading = false;
+        }
+    }
+    return reply;
+}
+
+void HostSDCard::select(bool selected)
+{
+    // the card lets go of DO, what it was sending is lost but not the programming of a written block
+    this->selected = selected;
+    if (!selected) {
+        out.clear();
+        cmd_len = 0;
+        reading = false;
+    }
+}
+
+int HostSDCard::count(int command) const
+{
+    int n = 0;
+    for (auto &c : commands) if (c.first == command) n++;
+    return n;
+}
+
+std::vector<uint32_t> HostSDCard::args(int command) const
+{
+    std::vector<uint32_t> a;
+    for (auto &c : commands) if (c.first == command) a.push_back(c.second);
+    return a;
+}
+
+void HostSDCard::receive(char in)
+{
+    // the block of a CMD24 or CMD25 after its start token, with its CRC16
+    if (in_len >= 0) {
+        in_block[in_len++] = in;
+        if (in_len == sizeof(in_block)) {
+            in_len = -1;
+            block_written();
+        }
+        return;
+    }
+
+    if (cmd_len == 0 && writing) {
+        if (in == (char)(multiple ? 0xFC : 0xFE)) {
+            in_len = 0;
+            return;
+        }
+        if (multiple && in == (char)0xFD) {
+            writing = false;
+            busy = 2;
+            return;
+        }
+    }
+
+    // a command packet starts with 01, anything else in between is the host clocking
+    if (cmd_len == 0 && (in & 0xC0) != 0x40) return;
+    cmd[cmd_len++] = in;
+    if (cmd_len == 6) {
+        cmd_len = 0;
+        command();
+    }
+}
+
+void HostSDCard::command()
+{
+    int index = cmd[0] & 0x3F;
+    uint32_t arg = ((cmd[1] & 0xFF) << 24) | ((cmd[2] & 0xFF) << 16) | ((cmd[3] & 0xFF) << 8) | (cmd[4] & 0xFF);
+    bool acmd = app;
+    app = false;
+    commands.push_back(std::make_pair(index, arg));
+
+    // CMD12 comes while a block is still being sent, the rest of it is dropped
+    out.clear();
+    out.push_back(0xFF);
+
+    // with CRC on the command CRC7 is checked, CMD0 and CMD8 always have one
+    char r1 = idle ? 0x01 : 0x00;
+    if ((crc || index == 0 || index == 8) && (char)((SDCRC::crc7(cmd, 5) << 1) | 0x01) != cmd[5]) {
+        out.push_back(r1 | 0x08);
+        return;
+    }
+
+    // the ACMDs SDFileSystem sends are only known after CMD55
+    if (!acmd && (index == 22 || index == 23 || index == 41 || index == 42)) {
+        out.push_back(r1 | 0x04);
+        return;
+    }
+
+    switch (index) {
+        case 0:
+            idle = true;
+            crc = false;
+            out.push_back(0x01);
+            break;
+
+        case 8:
+            out.push_back(r1);
+            out.push_back(0x00);
+            out.push_back(0x00);
+            out.push_back(0x01);
+            out.push_back(arg & 0xFF);
+            break;
+
+        case 12:
+            // the stuff byte is already in out, then R1
+            reading = writing = false;
+            out.push_back(r1);
+            break;
+
+        case 13:
+            out.push_back(r1);
+            out.push_back(0x00);
+            break;
+
+        case 17:
+            out.push_back(r1);
+            send_block(&data[arg * 512], 512, !fail(bad_reads, arg));
+            break;
+
+        case 18:
+            out.push_back(r1);
+            reading = true;
+            read_lba = arg;
+            break;
+
+        case 22: {
+            // ACMD22, the number of blocks the last CMD25 wrote
+            char count[4] = { (char)(written >> 24), (char)(written >> 16), (char)(written >> 8), (char)written };
+            out.push_back(r1);
+            send_block(count, 4, true);
+            break;
+        }
+
+        case 24:
+        case 25:
+            out.push_back(r1);
+            writing = true;
+            multiple = (index == 25);
+            write_lba = arg;
+            written = 0;
+            break;
+
+        case 41:
+            idle = false;
+            out.push_back(0x00);
+            break;
+
+        case 58: {
+            // 3.2-3.3V, with the power up and high capacity bits once it is initialized
+            uint32_t ocr = idle ? 0x00FF8000 : 0xC0FF8000;
+            out.push_back(r1);
+            for (int i = 24; i >= 0; i -= 8) out.push_back(ocr >> i);
+            break;
+        }
+
+        case 59:
+            crc = (arg & 1);
+            out.push_back(r1);
+            break;
+
+        case 16:
+        case 55:
+            app = (index == 55);
+            out.push_back(r1);
+            break;
+
+        case 23:
+        case 42:
+            out.push_back(r1);
+            break;
+
+        default:
+            out.push_back(r1 | 0x04);
+            break;
+    }
+}
+
+// the start token, the data and its CRC16, one byte after the response
+void HostSDCard::send_block(const char *block, int length, bool good)
+{
+    unsigned short sum = SDCRC::crc16(block, length);
+    if (!good) sum ^= 0x0100;
+    out.push_back(0xFF);
+    out.push_back(0xFE);
+    out.insert(out.end(), block, block + length);
+    out.push_back(sum >> 8);
+    out.push_back(sum & 0xFF);
+}
+
+void HostSDCard::block_written()
+{
+    // a block with a CRC error is not written, after one of a CMD25 the card waits for CMD12
+    unsigned short sum = ((in_block[512] & 0xFF) << 8) | (in_block[513] & 0xFF);
+    if (fail(bad_writes, write_lba) || (crc && sum != SDCRC::crc16(in_block, 512))) {
+        out.push_back(0xEB);
+        writing = false;
+        return;
+    }
+
+    memcpy(&data[write_lba * 512], in_block, 512);
+    out.push_back(0xE5);
+    busy = 3;
+    written++;
+    write_lba++;
+    if (!multiple) writing = false;
+}
+
+// the bus SDFileSystem has on the host, the card does not know 8 bit frames from 16 bit ones or DMA
+namespace mbed {
+
+SPI::SPI(PinName mosi, PinName miso, PinName sclk) : _bits(8), _mode(0), _hz(1000000) {}
+void SPI::format(int bits, int mode) { _bits = bits; _mode = mode; }
+void SPI::frequency(int hz) { _hz = hz; }
+
+int SPI::write(int value)
+{
+    if (_bits == 16) {
+        int high = HostSDCard::card->clock(value >> 8) & 0xFF;
+        return (high << 8) | (HostSDCard::card->clock(value) & 0xFF);
+    }
+    return HostSDCard::card->clock(value) & 0xFF;
+}
+
+}
+
+SDGPDMA::SDGPDMA(LPC_SSP_TypeDef* ssp) : m_Ssp(ssp), m_Busy(false) {}
+
+char SDGPDMA::transfer(char out)
+{
+    return HostSDCard::card->clock(out);
+}
+
+void SDGPDMA::start(const char* tx, char* rx, int length)
+{
+    for (int i = 0; i < length; i++) {
+        char c = HostSDCard::card->clock(tx != NULL ? tx[i] : (char)0xFF);
+        if (rx != NULL) rx[i] = c;
+    }
+    m_Busy = true;
+}
+
+bool SDGPDMA::done()
+{
+    m_Busy = false;
+    return true;
+}
+
+// only the chip select of the card is a GPIO here
+GPIO::GPIO(PinName pin)
+{
+    this->port = (pin >> 5) & 7;
+    this->pin = pin & 0x1F;
+}
+
+void GPIO::output() {}
+
+int GPIO::operator=(int value)
+{
+    HostSDCard::card->select(value == 0);
+    return value;
+}
+
+extern "C" void pin_mode(PinName pin, PinMode mode) {}
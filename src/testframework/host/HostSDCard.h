@@ -0,0 +1,58 @@
+#ifndef HOST_SD_CARD_H
+#define HOST_SD_CARD_H
+
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <vector>
+
+// An SDHC card in SPI mode for SDFileSystem on the host. HostSDCard.cpp has the mbed::SPI, SDGPDMA and the chip
+// select GPIO of the host build, all of them clock bytes through HostSDCard::card, whether the block moves by DMA
+// or byte by byte the card sees the same. Blocks can be made to fail a given number of times, a read is then sent
+// with a wrong CRC16 and a write gets the CRC error data response, every command is kept with its argument.
+// A CMD18 sends the block after the one the host stops at as well, that counts as one of its failures too.
+class HostSDCard {
+    public:
+        HostSDCard(uint32_t sectors);
+
+        // one byte each way, nothing comes back while the card is not selected
+        char clock(char in);
+        void select(bool selected);
+
+        // the commands received, without the 0x40 and with ACMDs as their own number
+        int count(int command) const;
+        std::vector<uint32_t> args(int command) const;
+
+        std::vector<char> data;
+        std::map<uint32_t, int> bad_reads;
+        std::map<uint32_t, int> bad_writes;
+        std::vector<std::pair<int, uint32_t> > commands;
+
+        // the card SDFileSystem is talking to, the last one made
+        static HostSDCard *card;
+
+    private:
+        void receive(char in);
+        void command();
+        void send_block(const char *block, int length, bool good);
+        void block_written();
+
+        std::deque<char> out;
+        char cmd[6];
+        int cmd_len;
+        char in_block[514];
+        int in_len;
+        int busy;
+        uint32_t read_lba;
+        uint32_t write_lba;
+        uint32_t written;
+        bool selected;
+        bool idle;
+        bool app;
+        bool crc;
+        bool reading;
+        bool writing;
+        bool multiple;
+};
+
+#endif
@@ -0,0 +1,12 @@
+/*
+ * Runs the unit tests built for the host with the same easyunit as on the controller, see src/testframework/Readme.md
+ */
+
+#include "easyunit/testharness.h"
+#include "easyunit/test.h"
+
+int main()
+{
+    const TestResult *result = TestRegistry::runAndPrint();
+    return (result->getFailures() > 0 || result->getErrors() > 0) ? 1 : 0;
+}
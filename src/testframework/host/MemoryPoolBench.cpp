@@ -0,0 +1,110 @@
+/*
+ * Host side stress benchmark of MemoryPool, see src/testframework/Readme.md
+ *
+ * Runs a job like churn on a pool the size of AHB0: a few long lived objects and many short lived small
+ * ones of mixed sizes, and reports the time per operation, failed allocations and how fragmented the
+ * pool ends up.
+ */
+
+#include "MemoryPool.h"
+#include "StreamOutput.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define POOL_SIZE  16000
+#define MAX_LIVE   512
+#define LIVE       160
+#define OPERATIONS 2000000
+
+// MemoryPool only needs printf from StreamOutput
+int StreamOutput::printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n;
+}
+
+class StdoutStream : public StreamOutput {
+    public:
+        int puts(const char *str, int) { return fputs(str, stdout); }
+};
+
+static uint32_t pool_buf[POOL_SIZE / 4];
+
+static uint32_t rnd_state = 12345;
+static uint32_t rnd()
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+// mostly small like strings and gcode words, now and then a buffer
+static size_t pick_size()
+{
+    uint32_t r = rnd() % 100;
+    if (r < 40) return 1 + rnd() % 16;
+    if (r < 75) return 17 + rnd() % 48;
+    if (r < 95) return 65 + rnd() % 128;
+    return 193 + rnd() % 400;
+}
+
+int main(int argc, char *argv[])
+{
+    // usage: MemoryPoolBench [operations [live objects]]
+    unsigned long operations = (argc > 1) ? strtoul(argv[1], NULL, 10) : OPERATIONS;
+    int nlive = (argc > 2) ? atoi(argv[2]) : LIVE;
+    if (nlive < 1 || nlive > MAX_LIVE) nlive = LIVE;
+
+    MemoryPool pool(pool_buf, POOL_SIZE);
+    void *live[MAX_LIVE];
+    size_t sizes[MAX_LIVE];
+    memset(live, 0, sizeof(live));
+
+    // long lived, like the modules allocated at boot
+    for (int i = 0; i < 24; i++) {
+        pool.alloc(pick_size());
+    }
+
+    unsigned long failures = 0;
+    uint32_t worst_largest = POOL_SIZE;
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long n = 0; n < operations; n++) {
+        int i = rnd() % nlive;
+        if (live[i] != NULL) {
+            pool.dealloc(live[i]);
+            live[i] = NULL;
+        } else {
+            sizes[i] = pick_size();
+            live[i] = pool.alloc(sizes[i]);
+            if (live[i] == NULL) failures++;
+            else memset(live[i], 0xA5, sizes[i]);
+        }
+
+        if ((n & 0xFFFF) == 0) {
+            uint32_t l = pool.largest_free();
+            if (l < worst_largest) worst_largest = l;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+    uint32_t f = pool.free();
+    uint32_t l = pool.largest_free();
+    printf("MemoryPool, %lu operations on up to %d objects\n", operations, nlive);
+    printf("  %.1f ns per operation\n", ns / operations);
+    printf("  %lu failed allocations\n", failures);
+    printf("  at the end %lub free, largest chunk %lub, worst largest chunk %lub\n", (unsigned long)f, (unsigned long)l, (unsigned long)worst_largest);
+
+    StdoutStream out;
+    pool.stats(&out);
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * CommandBatch lines go through the InputScheduler like every other line
+ *
+ * A batch dispatched while a line runs, as an M400 waiting in ON_IDLE, or while the scheduler is held for a
+ * dry run, has to wait. Only the batch ack stands in for the plain ok of each of its lines.
+ */
+
+#include "HostMachine.h"
+#include "InputScheduler.h"
+#include "CommandBatch.h"
+#include "Kernel.h"
+#include "SerialMessage.h"
+#include "StreamOutput.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "easyunit/test.h"
+
+class ReplyCapture : public StreamOutput {
+    public:
+        int puts(const char *buf, int size = 0)
+        {
+            size_t n = size == 0 ? strlen(buf) : size;
+            out.append(buf, n);
+            return n;
+        }
+        std::string out;
+};
+
+// answers every line with ok, M114 with its position, and runs the batch from inside M400
+class BatchRunner : public Module {
+    public:
+        BatchRunner(CommandBatch *batch, uint8_t source) : batch(batch), source(source) {}
+        void on_module_loaded() { register_for_event(ON_CONSOLE_LINE_RECEIVED); }
+        void on_console_line_received(void *argument)
+        {
+            SerialMessage *msg = static_cast<SerialMessage *>(argument);
+            lines.push_back(msg->message);
+            if (msg->message == "M400") batch->dispatch(source);
+            if (msg->message == "M114") msg->stream->printf("ok C: X:0.0000\r\n");
+            else msg->stream->printf("ok\r\n");
+        }
+        CommandBatch *batch;
+        uint8_t source;
+        std::vector<std::string> lines;
+};
+
+static void add_batch(CommandBatch& batch, uint16_t seq, const char *text)
+{
+    std::string payload;
+    payload.push_back(seq >> 8);
+    payload.push_back(seq & 0xFF);
+    payload.append(text);
+    batch.add((const uint8_t *)payload.data(), payload.size());
+}
+
+TEST(BatchSchedulerTest,batch_waits_for_running_line_and_hold)
+{
+    host_machine_setup(nullptr);
+
+    InputScheduler *input = new InputScheduler();
+    THEKERNEL->input = input;
+    uint8_t serial = input->add_source("serial");
+
+    ReplyCapture stream;
+    CommandBatch batch(&stream);
+    BatchRunner runner(&batch, serial);
+    THEKERNEL->add_module(&runner);
+
+    // nothing of the batch starts inside the M400
+    add_batch(batch, 1, "G4 P0\nM114\n");
+    input->submit(serial, &stream, "M400");
+    input->dispatch();
+    ASSERT_TRUE(runner.lines.size() == 1);
+    ASSERT_TRUE(!batch.empty());
+
+    // nor while held
+    input->hold(true);
+    batch.dispatch(serial);
+    ASSERT_TRUE(runner.lines.size() == 1);
+    input->hold(false);
+
+    batch.dispatch(serial);
+    ASSERT_TRUE(batch.empty());
+    ASSERT_TRUE(runner.lines.size() == 3);
+    ASSERT_TRUE(runner.lines[1] == "G4 P0");
+    ASSERT_TRUE(runner.lines[2] == "M114");
+
+    // the ok of the M400 and the M114 reply, not the ok of the G4
+    size_t first = stream.out.find("ok\r\n");
+    ASSERT_TRUE(first != std::string::npos);
+    ASSERT_TRUE(stream.out.find("ok\r\n", first + 1) == std::string::npos);
+    ASSERT_TRUE(stream.out.find("ok C: X:0.0000\r\n") != std::string::npos);
+
+    THEKERNEL->unregister_for_event(ON_CONSOLE_LINE_RECEIVED, &runner);
+    THEKERNEL->input = nullptr;
+    delete input;
+}
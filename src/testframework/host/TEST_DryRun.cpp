@@ -0,0 +1,91 @@
+/*
+ * The dry run through the real Robot and Planner, with src/config.default as the machine config
+ */
+
+#include "HostMachine.h"
+#include "DryRun.h"
+#include "Kernel.h"
+#include "Robot.h"
+
+#include <stdio.h>
+#include <math.h>
+
+#include "easyunit/test.h"
+
+#define GCODE_FILE "dryrun-test.tmp"
+
+static void write_gcode(const char *text)
+{
+    FILE *fp = fopen(GCODE_FILE, "w");
+    fputs(text, fp);
+    fclose(fp);
+}
+
+static bool run_file(DryRun &dry_run)
+{
+    if (!dry_run.start(GCODE_FILE)) return false;
+    while (dry_run.step(DRY_RUN_SLICE_US)) ;
+    dry_run.finish();
+    remove(GCODE_FILE);
+    return true;
+}
+
+// 100mm at 10mm/s with 150mm/s² acceleration, 10s plus 1/15s to get up to speed and stop again
+TEST(DryRunTest,single_move)
+{
+    host_machine_setup(nullptr);
+    write_gcode("G21 G90\nG1 X100 F600\n");
+
+    DryRun dry_run;
+    ASSERT_TRUE(run_file(dry_run));
+    ASSERT_TRUE(!dry_run.was_aborted());
+    ASSERT_TRUE(fabsf(dry_run.get_total_secs() - 10.0667F) < 0.01F);
+}
+
+// G4 P is milliseconds as the host kernel is not in grbl mode, the tool change splits the time
+TEST(DryRunTest,dwell_and_tools)
+{
+    host_machine_setup(nullptr);
+    write_gcode("G90\nG1 X100 F600\nG4 P500\nT2 M6\n(comment) ; more\nG1 Y50 F1200\n");
+
+    DryRun dry_run;
+    ASSERT_TRUE(run_file(dry_run));
+    float t2 = dry_run.get_tool_secs(2);
+    ASSERT_TRUE(fabsf(t2 - (2.5F + 0.0667F * 2)) < 0.01F);
+    ASSERT_TRUE(fabsf(dry_run.get_total_secs() - t2 - 10.5667F) < 0.01F);
+}
+
+// Robot is where it was and back in relative mode afterwards, whatever the file left it in
+TEST(DryRunTest,robot_restored)
+{
+    host_machine_setup(nullptr);
+    THEROBOT->absolute_mode = false;
+    float before[3];
+    THEROBOT->get_axis_position(before);
+    write_gcode("G91\nG0 X10 Y10\nG1 Z-5 F300\n");
+
+    DryRun dry_run;
+    ASSERT_TRUE(run_file(dry_run));
+    float after[3];
+    THEROBOT->get_axis_position(after);
+    ASSERT_TRUE(!THEROBOT->absolute_mode);
+    for (int i = 0; i < 3; i++) ASSERT_TRUE(before[i] == after[i]);
+    THEROBOT->absolute_mode = true;
+}
+
+// a halt stops the dry run and it reports itself aborted
+TEST(DryRunTest,halt_aborts)
+{
+    host_machine_setup(nullptr);
+    write_gcode("G1 X10 F600\nG1 X0\n");
+
+    DryRun dry_run;
+    ASSERT_TRUE(dry_run.start(GCODE_FILE));
+    THEKERNEL->call_event(ON_HALT, nullptr);
+    ASSERT_TRUE(!dry_run.step(DRY_RUN_SLICE_US));
+    dry_run.finish();
+    THEKERNEL->call_event(ON_HALT, (void *)1);
+    remove(GCODE_FILE);
+    ASSERT_TRUE(dry_run.was_aborted());
+    ASSERT_TRUE(dry_run.get_total_secs() == 0);
+}
@@ -0,0 +1,127 @@
+/*
+ * The InputScheduler in front of the real Robot and Planner, see HostMachine.h
+ *
+ * A streamed move long enough to fill the block queue waits in ON_IDLE for room, with its next block planned
+ * but not yet queued, while a jog arrives from another source. Every block is stepped by a stand in for the
+ * step ticker, the steps have to add up to both moves in the order they were sent.
+ */
+
+#include "HostMachine.h"
+#include "InputScheduler.h"
+#include "Kernel.h"
+#include "Robot.h"
+#include "Conveyor.h"
+#include "Block.h"
+#include "StepperMotor.h"
+#include "Gcode.h"
+#include "SerialMessage.h"
+#include "StreamOutput.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "easyunit/test.h"
+
+// runs lines the way GcodeDispatch would for plain moves, a jog is a G1 here
+class LineRunner : public Module {
+    public:
+        void on_module_loaded() { register_for_event(ON_CONSOLE_LINE_RECEIVED); }
+        void on_console_line_received(void *argument)
+        {
+            std::string line = static_cast<SerialMessage *>(argument)->message;
+            if (line.compare(0, 2, "$J") == 0) line.replace(0, 2, "G1");
+            lines.push_back(line);
+            Gcode gcode(line, &StreamOutput::NullStream);
+            THEROBOT->on_gcode_received(&gcode);
+        }
+        std::vector<std::string> lines;
+};
+
+// takes one block per ON_IDLE like the step ticker finishing one, the first time the queue is full a jog arrives
+class BlockTaker : public Module {
+    public:
+        BlockTaker(uint8_t jog_source) : jog_source(jog_source), jogged(false), y_first(-1), blocks(0)
+        {
+            steps[0] = steps[1] = 0;
+        }
+        void on_module_loaded() { register_for_event(ON_IDLE); }
+        void on_idle(void *argument)
+        {
+            if (!jogged && THECONVEYOR->is_queue_full()) {
+                THEKERNEL->input->submit(jog_source, &StreamOutput::NullStream, "$J Y-20 F3000");
+                jogged = true;
+            }
+
+            Block *block;
+            if (!THECONVEYOR->get_next_block(&block)) return;
+            for (int i = 0; i < 2; i++) {
+                int32_t n = block->steps[i];
+                steps[i] += block->direction_bits[i] ? -n : n;
+            }
+            if (block->steps[1] != 0 && y_first < 0) y_first = blocks;
+            if (block->steps[0] != 0 && y_first >= 0) x_after_y = true;
+            blocks++;
+            THECONVEYOR->block_finished();
+        }
+
+        uint8_t jog_source;
+        bool jogged;
+        bool x_after_y = false;
+        int y_first;
+        int blocks;
+        int32_t steps[2];
+};
+
+TEST(InputPlannerTest,jog_waits_for_the_blocked_line)
+{
+    host_machine_setup(nullptr);
+    float start[3];
+    THEROBOT->get_axis_position(start);
+
+    InputScheduler *input = new InputScheduler();
+    THEKERNEL->input = input;
+    THEKERNEL->add_module(input);
+    uint8_t serial = input->add_source("serial");
+    uint8_t wifi = input->add_source("wifi");
+
+    LineRunner runner;
+    THEKERNEL->add_module(&runner);
+    BlockTaker taker(wifi);
+    THEKERNEL->add_module(&taker);
+
+    // 60 segments of 5mm, more than the 32 blocks the queue holds
+    input->submit(serial, &StreamOutput::NullStream, "G1 X-300 F6000");
+    input->dispatch();
+    THECONVEYOR->wait_for_idle();
+    input->dispatch();
+    THECONVEYOR->wait_for_idle();
+
+    ASSERT_TRUE(taker.jogged);
+    ASSERT_TRUE(runner.lines.size() == 2);
+    ASSERT_TRUE(runner.lines[1] == "G1 Y-20 F3000");
+
+    // every step of both moves, the jog after all of the streamed move
+    float x_mm = THEROBOT->actuators[0]->get_steps_per_mm(), y_mm = THEROBOT->actuators[1]->get_steps_per_mm();
+    ASSERT_TRUE(taker.steps[0] == lroundf((-300 - start[0]) * x_mm));
+    ASSERT_TRUE(taker.steps[1] == lroundf((-20 - start[1]) * y_mm));
+    ASSERT_TRUE(taker.y_first > 0 && !taker.x_after_y);
+
+    // put everything back for the other tests, the blocks still have to be taken
+    char back[40];
+    snprintf(back, sizeof(back), "G0 X%f Y%f", start[0], start[1]);
+    Gcode gcode(back, &StreamOutput::NullStream);
+    THEROBOT->on_gcode_received(&gcode);
+    THECONVEYOR->wait_for_idle();
+    THEKERNEL->unregister_for_event(ON_MAIN_LOOP, input);
+    THEKERNEL->unregister_for_event(ON_IDLE, input);
+    THEKERNEL->unregister_for_event(ON_CONSOLE_LINE_RECEIVED, &runner);
+    THEKERNEL->unregister_for_event(ON_IDLE, &taker);
+    THEKERNEL->input = nullptr;
+    delete input;
+
+    float end[3];
+    THEROBOT->get_axis_position(end);
+    for (int i = 0; i < 3; i++) ASSERT_TRUE(fabsf(end[i] - start[i]) < 0.001F);
+}
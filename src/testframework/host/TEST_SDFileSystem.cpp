@@ -0,0 +1,133 @@
+/*
+ * SDFileSystem on a card that fails blocks on purpose, see HostSDCard.h
+ *
+ * A block that fails is tried again from where it failed, as long as there is progress, and given up on after
+ * three tries without any. Each is run with the blocks moved by the DMA bus and byte by byte.
+ */
+
+#include "HostSDCard.h"
+#include "SDFileSystem.h"
+#include "diskio.h"
+
+#include <string.h>
+#include <vector>
+
+#include "easyunit/test.h"
+
+#define CMD17 17
+#define CMD18 18
+#define ACMD22 22
+#define CMD24 24
+#define CMD25 25
+
+static void fill(char *buffer, int blocks, int seed)
+{
+    for (int i = 0; i < blocks * 512; ++i) buffer[i] = (char)(i * 7 + seed + i / 512);
+}
+
+// a card of 32 blocks with CRC on, mounted the way the firmware does it
+static bool mount(SDFileSystem& sd, HostSDCard& card, bool dma)
+{
+    fill(card.data.data(), 32, 5);
+    sd.crc(true);
+    sd.dma(dma);
+    if (sd.disk_initialize() != 0 || sd.card_type() != SDFileSystem::CARD_SDHC) return false;
+    card.commands.clear();
+    return true;
+}
+
+TEST(SDFileSystemTest,read_multiple_resumes_at_bad_block)
+{
+    for (int dma = 0; dma < 2; ++dma) {
+        HostSDCard card(32);
+        SDFileSystem sd(P0_18, P0_17, P0_15, P0_16, 12000000);
+        ASSERT_TRUE(mount(sd, card, dma));
+
+        static char buf[8 * 512];
+        card.bad_reads[3] = 1;
+        ASSERT_TRUE(sd.disk_read(buf, 0, 8) == RES_OK);
+        ASSERT_TRUE(memcmp(buf, card.data.data(), sizeof(buf)) == 0);
+        ASSERT_TRUE((card.args(CMD18) == std::vector<uint32_t>{0, 3}));
+    }
+}
+
+TEST(SDFileSystemTest,read_multiple_gives_up)
+{
+    for (int dma = 0; dma < 2; ++dma) {
+        HostSDCard card(32);
+        SDFileSystem sd(P0_18, P0_17, P0_15, P0_16, 12000000);
+        ASSERT_TRUE(mount(sd, card, dma));
+
+        // three blocks come in, then three tries at the fourth
+        static char buf[8 * 512];
+        card.bad_reads[3] = 10;
+        ASSERT_TRUE(sd.disk_read(buf, 0, 8) == RES_ERROR);
+        ASSERT_TRUE((card.args(CMD18) == std::vector<uint32_t>{0, 3, 3}));
+
+        // a good block starts the count again
+        card.bad_reads.clear();
+        card.bad_reads[2] = card.bad_reads[5] = 2;
+        card.commands.clear();
+        ASSERT_TRUE(sd.disk_read(buf, 0, 8) == RES_OK);
+        ASSERT_TRUE(memcmp(buf, card.data.data(), sizeof(buf)) == 0);
+        ASSERT_TRUE((card.args(CMD18) == std::vector<uint32_t>{0, 2, 2, 5, 5}));
+    }
+}
+
+TEST(SDFileSystemTest,read_single_retries)
+{
+    for (int dma = 0; dma < 2; ++dma) {
+        HostSDCard card(32);
+        SDFileSystem sd(P0_18, P0_17, P0_15, P0_16, 12000000);
+        ASSERT_TRUE(mount(sd, card, dma));
+
+        static char buf[512];
+        card.bad_reads[5] = 2;
+        ASSERT_TRUE(sd.disk_read(buf, 5, 1) == RES_OK);
+        ASSERT_TRUE(memcmp(buf, &card.data[5 * 512], 512) == 0);
+        ASSERT_TRUE(card.count(CMD17) == 3);
+
+        card.bad_reads[5] = 3;
+        ASSERT_TRUE(sd.disk_read(buf, 5, 1) == RES_ERROR);
+    }
+}
+
+TEST(SDFileSystemTest,write_multiple_resumes_after_crc_error)
+{
+    for (int dma = 0; dma < 2; ++dma) {
+        HostSDCard card(32);
+        SDFileSystem sd(P0_18, P0_17, P0_15, P0_16, 12000000);
+        ASSERT_TRUE(mount(sd, card, dma));
+
+        // the card takes two blocks, then ACMD22 says where to go on from
+        static char buf[4 * 512];
+        fill(buf, 4, 9);
+        card.bad_writes[12] = 1;
+        ASSERT_TRUE(sd.disk_write(buf, 10, 4) == RES_OK);
+        ASSERT_TRUE(memcmp(&card.data[10 * 512], buf, sizeof(buf)) == 0);
+        ASSERT_TRUE((card.args(CMD25) == std::vector<uint32_t>{10, 12}));
+        ASSERT_TRUE(card.count(ACMD22) == 1);
+
+        // ACMD22 counts from the CMD25 it follows, no progress three times is the end of it
+        card.bad_writes[21] = 10;
+        card.commands.clear();
+        ASSERT_TRUE(sd.disk_write(buf, 20, 4) == RES_ERROR);
+        ASSERT_TRUE((card.args(CMD25) == std::vector<uint32_t>{20, 21, 21}));
+    }
+}
+
+TEST(SDFileSystemTest,write_single_retries)
+{
+    for (int dma = 0; dma < 2; ++dma) {
+        HostSDCard card(32);
+        SDFileSystem sd(P0_18, P0_17, P0_15, P0_16, 12000000);
+        ASSERT_TRUE(mount(sd, card, dma));
+
+        static char buf[512];
+        fill(buf, 1, 3);
+        card.bad_writes[7] = 1;
+        ASSERT_TRUE(sd.disk_write(buf, 7, 1) == RES_OK);
+        ASSERT_TRUE(memcmp(&card.data[7 * 512], buf, 512) == 0);
+        ASSERT_TRUE(card.count(CMD24) == 2);
+    }
+}
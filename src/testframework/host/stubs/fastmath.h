@@ -0,0 +1,2 @@
+// host build stand in for the newlib header, the fast math functions are the usual ones
+#include <math.h>
@@ -0,0 +1,9 @@
+// included first in every file of the host build, what the newlib headers bring in along the way and the host ones do not
+#include <stddef.h>
+#include <sys/stat.h>
+
+// the CMSIS intrinsics are inline ARM assembly, the few that end up in the host build do nothing there
+__asm__(".macro cpsid mask\n.endm\n"
+        ".macro cpsie mask\n.endm\n"
+        ".macro dsb\n.endm\n"
+        ".macro isb\n.endm\n");
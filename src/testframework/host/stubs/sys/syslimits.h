@@ -0,0 +1,2 @@
+// host build stand in for the newlib header, mbed only wants PATH_MAX from it
+#include <limits.h>
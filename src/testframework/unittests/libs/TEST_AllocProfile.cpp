@@ -0,0 +1,62 @@
+#include "AllocProfile.h"
+#include "StreamOutput.h"
+
+#include <string.h>
+#include <string>
+
+#include "easyunit/test.h"
+
+class CaptureStream : public StreamOutput {
+    public:
+        int puts(const char *buf, int size = 0)
+        {
+            size_t n = size == 0 ? strlen(buf) : size;
+            out.append(buf, n);
+            return n;
+        }
+        std::string out;
+};
+
+// counted by caller and size bucket, most often first
+TEST(AllocProfileTest,counts)
+{
+    ASSERT_TRUE(AllocProfile::start());
+    ASSERT_TRUE(AllocProfile::is_on());
+
+    for (int i = 0; i < 3; i++) AllocProfile::record(0x1001, 10);
+    AllocProfile::record(0x1001, 300);
+    AllocProfile::record(0x2001, 100);
+    AllocProfile::record(0x2001, 120);
+    AllocProfile::stop();
+    AllocProfile::record(0x3001, 8);
+
+    CaptureStream s;
+    AllocProfile::report(&s);
+    ASSERT_TRUE(s.out.find("allocations 6, stopped") != std::string::npos);
+
+    size_t a = s.out.find("0x00001001         3         30  <=16 max 10");
+    size_t b = s.out.find("0x00002001         2        220  <=128 max 120");
+    size_t c = s.out.find("0x00001001         1        300  <=512 max 300");
+    ASSERT_TRUE(a != std::string::npos && b != std::string::npos && c != std::string::npos);
+    ASSERT_TRUE(a < b && b < c);
+    ASSERT_TRUE(s.out.find("0x00003001") == std::string::npos);
+}
+
+// more callers than entries are counted as dropped, starting again clears them
+TEST(AllocProfileTest,full_table)
+{
+    ASSERT_TRUE(AllocProfile::start());
+    for (uint32_t pc = 1; pc <= ALLOCPROFILE_ENTRIES + 10; pc++) AllocProfile::record(pc * 4 + 1, 16);
+    AllocProfile::stop();
+
+    CaptureStream s;
+    AllocProfile::report(&s);
+    ASSERT_TRUE(s.out.find("10 allocations not recorded") != std::string::npos);
+
+    ASSERT_TRUE(AllocProfile::start());
+    AllocProfile::stop();
+    CaptureStream t;
+    AllocProfile::report(&t);
+    ASSERT_TRUE(t.out.find("allocations 0, stopped") != std::string::npos);
+    ASSERT_TRUE(t.out.find("not recorded") == std::string::npos);
+}
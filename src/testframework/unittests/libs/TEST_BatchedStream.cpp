@@ -0,0 +1,69 @@
+#include "BatchedStream.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "easyunit/test.h"
+
+// keeps each write it gets as one frame
+class FrameStream : public StreamOutput {
+    public:
+        int printf(const char *format, ...)
+        {
+            char b[600];
+            va_list args;
+            va_start(args, format);
+            int n = vsnprintf(b, sizeof(b), format, args);
+            va_end(args);
+            frames.push_back(std::string(b, n));
+            return n;
+        }
+        int puts(const char *str, int size = 0) { return printf("%.*s", size == 0 ? (int)strlen(str) : size, str); }
+        std::vector<std::string> frames;
+};
+
+TEST(BatchedStreamTest,lines_go_out_together)
+{
+    FrameStream out;
+    BatchedStream batched;
+    batched.set_target(&out, 64);
+
+    // ten fit in a frame, the eleventh sends them
+    std::string all;
+    for (int i = 0; i < 12; ++i) {
+        batched.printf("ok %d\r\n", i % 10);
+        all += "ok " + std::to_string(i % 10) + "\r\n";
+    }
+    ASSERT_TRUE(out.frames.size() == 1 && out.frames[0].size() == 60);
+    batched.flush();
+    ASSERT_TRUE(out.frames.size() == 2);
+    ASSERT_TRUE(out.frames[0] + out.frames[1] == all);
+    for (auto &f : out.frames) ASSERT_TRUE(f.size() <= 64);
+}
+
+TEST(BatchedStreamTest,long_replies_are_not_cut)
+{
+    FrameStream out;
+    BatchedStream batched;
+    batched.set_target(&out, 100);
+
+    // longer than a played line and than a frame, like an M503 line or an error with the line in it
+    std::string reply(250, 'x');
+    batched.printf("a\r\n");
+    ASSERT_TRUE(batched.printf("%s\r\n", reply.c_str()) == 252);
+    batched.flush();
+
+    std::string all;
+    for (auto &f : out.frames) {
+        ASSERT_TRUE(f.size() <= 100);
+        all += f;
+    }
+    ASSERT_TRUE(all == "a\r\n" + reply + "\r\n");
+
+    // passed straight through without a limit
+    batched.set_target(&out, 0);
+    out.frames.clear();
+    batched.printf("%s", reply.c_str());
+    ASSERT_TRUE(out.frames.size() == 1 && out.frames[0] == reply);
+}
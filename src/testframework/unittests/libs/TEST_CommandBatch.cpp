@@ -0,0 +1,191 @@
+#include "Kernel.h"
+#include "Conveyor.h"
+#include "CommandBatch.h"
+#include "PublicData.h"
+#include "SerialMessage.h"
+#include "InputScheduler.h"
+#include "Test_kernel.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "easyunit/test.h"
+
+// collects everything written so the acks can be picked out of it
+class CaptureStream : public StreamOutput {
+    public:
+        int puts(const char *buf, int size = 0)
+        {
+            size_t n = size == 0 ? strlen(buf) : size;
+            out.append(buf, n);
+            return n;
+        }
+
+        // contents of the last PTYPE_BATCH_ACK frame
+        bool last_ack(uint16_t& seq, std::string& status, uint16_t *free = nullptr)
+        {
+            bool found = false;
+            for (size_t i = 0; i + 9 <= out.size(); ++i) {
+                if ((uint8_t)out[i] != ((HEADER >> 8) & 0xFF) || (uint8_t)out[i + 1] != (HEADER & 0xFF)) continue;
+                size_t len = ((uint8_t)out[i + 2] << 8) | (uint8_t)out[i + 3];
+                if ((uint8_t)out[i + 4] != PTYPE_BATCH_ACK || i + len + 6 > out.size()) continue;
+                seq = ((uint8_t)out[i + 5] << 8) | (uint8_t)out[i + 6];
+                capacity = ((uint8_t)out[i + 7] << 8) | (uint8_t)out[i + 8];
+                if (free != nullptr) *free = ((uint8_t)out[i + 9] << 8) | (uint8_t)out[i + 10];
+                status = out.substr(i + 11, len - 9);
+                found = true;
+            }
+            return found;
+        }
+
+        std::string out;
+        uint16_t capacity;
+};
+
+static std::vector<std::string> lines_run;
+static uint8_t source;
+
+static void setup_batch_test()
+{
+    static bool started = false;
+    if (!started) {
+        // the test kernel's conveyor has no queue until it is started
+        const static char config[] = "planner_queue_size 32\n";
+        test_kernel_setup_config(config, &config[sizeof(config)]);
+        THECONVEYOR->on_module_loaded();
+        THECONVEYOR->start(3);
+        source = THEKERNEL->input->add_source("batch");
+        started = true;
+    }
+
+    lines_run.clear();
+    test_kernel_trap_event(ON_CONSOLE_LINE_RECEIVED, [](void *argument) {
+        SerialMessage *msg = static_cast<SerialMessage *>(argument);
+        lines_run.push_back(msg->message);
+        if (msg->message == "BAD") msg->stream->printf("error:bad line\n");
+        if (msg->message == "M114") msg->stream->printf("ok C: X:1.0000\r\n");
+        else msg->stream->printf("ok\r\n");
+    });
+}
+
+static void add_batch(CommandBatch& batch, uint16_t seq, const char *text)
+{
+    std::string payload;
+    payload.push_back(seq >> 8);
+    payload.push_back(seq & 0xFF);
+    payload.append(text);
+    batch.add((const uint8_t *)payload.data(), payload.size());
+}
+
+TEST(CommandBatchTest,runs_lines_and_acks_once)
+{
+    setup_batch_test();
+    CaptureStream stream;
+    CommandBatch batch(&stream);
+
+    add_batch(batch, 0x1234, "G0 X1\r\nBAD\n\nM3\n");
+    ASSERT_TRUE(!batch.empty());
+    for (int i = 0; i < 4 && !batch.empty(); ++i) batch.dispatch(source);
+    ASSERT_TRUE(batch.empty());
+
+    ASSERT_TRUE(lines_run.size() == 3);
+    ASSERT_TRUE(lines_run[0] == "G0 X1");
+    ASSERT_TRUE(lines_run[1] == "BAD");
+    ASSERT_TRUE(lines_run[2] == "M3");
+
+    uint16_t seq;
+    std::string status;
+    ASSERT_TRUE(stream.last_ack(seq, status));
+    ASSERT_TRUE(seq == 0x1234);
+    ASSERT_TRUE(status == "0100");
+    // the error text itself still reaches the host, the ok of each line does not
+    ASSERT_TRUE(stream.out.find("error:bad line") != std::string::npos);
+    ASSERT_TRUE(stream.out.find("ok\r\n") == std::string::npos);
+
+    test_kernel_teardown();
+}
+
+TEST(CommandBatchTest,forwards_replies_but_ok)
+{
+    setup_batch_test();
+    CaptureStream stream;
+    CommandBatch batch(&stream);
+
+    add_batch(batch, 7, "G0 X1\nM114\n");
+    while (!batch.empty()) batch.dispatch(source);
+
+    ASSERT_TRUE(lines_run.size() == 2);
+    ASSERT_TRUE(stream.out.find("ok C: X:1.0000\r\n") != std::string::npos);
+    ASSERT_TRUE(stream.out.find("ok\r\n") == std::string::npos);
+
+    uint16_t seq;
+    std::string status;
+    ASSERT_TRUE(stream.last_ack(seq, status));
+    ASSERT_TRUE(status == "00");
+
+    test_kernel_teardown();
+}
+
+TEST(CommandBatchTest,waits_while_held)
+{
+    setup_batch_test();
+    CaptureStream stream;
+    CommandBatch batch(&stream);
+
+    // as during a dry run, nothing of the batch may run until the scheduler lets go
+    add_batch(batch, 3, "G0 X1\nG0 X2\n");
+    THEKERNEL->input->hold(true);
+    batch.dispatch(source);
+    ASSERT_TRUE(lines_run.empty());
+    ASSERT_TRUE(!batch.empty());
+
+    THEKERNEL->input->hold(false);
+    while (!batch.empty()) batch.dispatch(source);
+    ASSERT_TRUE(lines_run.size() == 2);
+
+    test_kernel_teardown();
+}
+
+TEST(CommandBatchTest,counts_characters)
+{
+    setup_batch_test();
+    CaptureStream stream;
+    CommandBatch batch(&stream);
+
+    // an empty batch is answered at once and advertises the buffer
+    uint16_t seq, free;
+    std::string status;
+    add_batch(batch, 1, "");
+    ASSERT_TRUE(stream.last_ack(seq, status, &free));
+    ASSERT_TRUE(seq == 1);
+    ASSERT_TRUE(stream.capacity == BATCH_BUFFER_SIZE);
+    ASSERT_TRUE(free == BATCH_BUFFER_SIZE);
+    ASSERT_TRUE(status.empty());
+
+    // fill most of the buffer, 50 lines of 6 bytes per batch
+    std::string lines;
+    for (int i = 0; i < 50; ++i) lines.append("G0 X1\n");
+    int batches = (BATCH_BUFFER_SIZE - 100) / lines.size();
+    for (int i = 0; i < batches; ++i) add_batch(batch, 10 + i, lines.c_str());
+
+    // more than is left is turned away with every line skipped
+    std::string more(lines.substr(0, 200));
+    add_batch(batch, 99, more.c_str());
+    ASSERT_TRUE(stream.last_ack(seq, status, &free));
+    ASSERT_TRUE(seq == 99);
+    ASSERT_TRUE(status == std::string(200 / 6 + 1, BATCH_LINE_SKIPPED));
+    ASSERT_TRUE(free == BATCH_BUFFER_SIZE - batches * lines.size());
+    ASSERT_TRUE(lines_run.empty());
+
+    // space is given back as each batch is acked
+    while (!batch.empty()) batch.dispatch(source);
+    ASSERT_TRUE(lines_run.size() == (size_t)batches * 50);
+    ASSERT_TRUE(stream.last_ack(seq, status, &free));
+    ASSERT_TRUE(seq == 10 + batches - 1);
+    ASSERT_TRUE(status == std::string(50, BATCH_LINE_OK));
+    ASSERT_TRUE(free == BATCH_BUFFER_SIZE);
+
+    test_kernel_teardown();
+}
@@ -0,0 +1,49 @@
+#include "ConfigCache.h"
+#include "ConfigValue.h"
+#include "ConfigSources/FirmConfigSource.h"
+#include "checksumm.h"
+#include "utils.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "easyunit/test.h"
+
+static const char test_config[] =
+    "switch.fan.enable true\n"
+    "alpha_steps_per_mm 80\n"
+    "temperature_control.hotend.enable true\n"
+    "switch.misc.enable false\n"
+    "alpha_steps_per_mm 100 # later one wins\n"
+    "temperature_control.bed.enable true\n"
+    "temperature_control.bed.thermistor_pin 0.24\n";
+
+TEST(ConfigCacheTest,duplicates_and_families)
+{
+    FirmConfigSource src("test", test_config, test_config + strlen(test_config));
+    ConfigCache cache;
+    src.transfer_values_to_cache(&cache);
+    ASSERT_TRUE(cache.size() == 7);
+
+    uint16_t cs[3];
+    get_checksums(cs, "alpha_steps_per_mm");
+    ASSERT_TRUE(cache.lookup(cs)->as_number() == 100);
+
+    cache.sort();
+    ASSERT_TRUE(cache.size() == 6);
+    ASSERT_TRUE(cache.lookup(cs)->as_number() == 100);
+
+    std::vector<uint16_t> list;
+    cache.collect(CHECKSUM("temperature_control"), CHECKSUM("enable"), &list);
+    ASSERT_TRUE(list.size() == 2);
+    ASSERT_TRUE(std::find(list.begin(), list.end(), CHECKSUM("bed")) != list.end());
+    ASSERT_TRUE(std::find(list.begin(), list.end(), CHECKSUM("hotend")) != list.end());
+
+    list.clear();
+    cache.collect(CHECKSUM("switch"), CHECKSUM("enable"), &list);
+    ASSERT_TRUE(list.size() == 2);
+
+    list.clear();
+    cache.collect(CHECKSUM("extruder"), CHECKSUM("enable"), &list);
+    ASSERT_TRUE(list.empty());
+}
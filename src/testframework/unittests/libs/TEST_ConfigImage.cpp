@@ -0,0 +1,118 @@
+#include "ConfigCache.h"
+#include "ConfigImage.h"
+#include "ConfigValue.h"
+#include "ConfigSources/FirmConfigSource.h"
+#include "checksumm.h"
+#include "utils.h"
+
+#include <string.h>
+
+#include "easyunit/test.h"
+
+static const char test_config[] =
+    "# comment\n"
+    "alpha_steps_per_mm 80\n"
+    "beta_steps_per_mm  81.5 # trailing\n"
+    "laser_module_enable true\n"
+    "temperature_control.hotend.enable true\n"
+    "temperature_control.bed.enable false\n";
+
+static uint16_t cs[3];
+static uint16_t *key(const char *name)
+{
+    get_checksums(cs, name);
+    return cs;
+}
+
+TEST(ConfigImageTest,sorted_lookup)
+{
+    FirmConfigSource src("test", test_config, test_config + strlen(test_config));
+    ConfigCache cache;
+    src.transfer_values_to_cache(&cache);
+    ASSERT_TRUE(cache.size() == 5);
+
+    cache.sort();
+    ASSERT_TRUE(cache.lookup(key("alpha_steps_per_mm"))->as_string() == "80");
+    ASSERT_TRUE(cache.lookup(key("beta_steps_per_mm"))->as_string() == "81.5");
+    ASSERT_TRUE(cache.lookup(key("temperature_control.bed.enable"))->as_string() == "false");
+    ASSERT_TRUE(cache.lookup(key("gamma_steps_per_mm")) == NULL);
+}
+
+TEST(ConfigImageTest,save_and_load)
+{
+    FirmConfigSource src("test", test_config, test_config + strlen(test_config));
+    uint32_t sum = src.stamp(1);
+
+    ConfigCache cache;
+    src.transfer_values_to_cache(&cache);
+    cache.sort();
+    ASSERT_TRUE(ConfigImage::save(&cache, sum));
+
+    ConfigCache loaded;
+    ASSERT_TRUE(ConfigImage::load(&loaded, sum));
+    ASSERT_TRUE(loaded.size() == cache.size());
+    ASSERT_TRUE(loaded.lookup(key("laser_module_enable"))->as_bool());
+    ASSERT_TRUE(loaded.lookup(key("beta_steps_per_mm"))->as_number() == 81.5F);
+
+    std::vector<uint16_t> modules;
+    loaded.collect(CHECKSUM("temperature_control"), CHECKSUM("enable"), &modules);
+    ASSERT_TRUE(modules.size() == 2);
+
+    // different sources, the image is not used
+    ConfigCache other;
+    ASSERT_TRUE(!ConfigImage::load(&other, sum + 1));
+    ASSERT_TRUE(other.size() == 0);
+
+    ConfigImage::remove();
+    ASSERT_TRUE(!ConfigImage::load(&other, sum));
+}
+
+TEST(ConfigImageTest,get_and_update)
+{
+    FirmConfigSource src("test", test_config, test_config + strlen(test_config));
+    uint32_t sum = src.stamp(1);
+
+    ConfigCache cache;
+    src.transfer_values_to_cache(&cache);
+    cache.set_source(0, 1);
+    cache.sort();
+    ASSERT_TRUE(ConfigImage::save(&cache, sum));
+    ASSERT_TRUE(ConfigImage::is_current());
+
+    bool found;
+    string value;
+    uint8_t source;
+    ASSERT_TRUE(ConfigImage::get(key("beta_steps_per_mm"), found, value, source));
+    ASSERT_TRUE(found && value == "81.5" && source == 1);
+    ASSERT_TRUE(ConfigImage::get(key("gamma_steps_per_mm"), found, value, source));
+    ASSERT_TRUE(!found);
+
+    // one that fits where the old value was and one that does not
+    std::vector<ConfigSetting> settings;
+    settings.push_back(ConfigSetting("alpha_steps_per_mm", "8"));
+    settings.push_back(ConfigSetting("beta_steps_per_mm", "1234.5678"));
+    settings[0].written = settings[1].written = true;
+    ASSERT_TRUE(ConfigImage::update(1, settings));
+
+    ASSERT_TRUE(ConfigImage::get(key("alpha_steps_per_mm"), found, value, source) && found && value == "8");
+    ASSERT_TRUE(ConfigImage::get(key("beta_steps_per_mm"), found, value, source) && found && value == "1234.5678");
+    ASSERT_TRUE(ConfigImage::get(key("laser_module_enable"), found, value, source) && found && value == "true");
+
+    ConfigCache loaded;
+    ASSERT_TRUE(ConfigImage::load(&loaded, sum));
+    ASSERT_TRUE(loaded.lookup(key("beta_steps_per_mm"))->as_string() == "1234.5678");
+
+    // a setting from an earlier source does not replace the value
+    settings.clear();
+    settings.push_back(ConfigSetting("alpha_steps_per_mm", "90"));
+    settings[0].written = true;
+    ASSERT_TRUE(ConfigImage::update(0, settings));
+    ASSERT_TRUE(ConfigImage::get(key("alpha_steps_per_mm"), found, value, source) && value == "8");
+
+    // a new key can not be added, the image goes
+    settings.clear();
+    settings.push_back(ConfigSetting("gamma_steps_per_mm", "80"));
+    settings[0].written = true;
+    ASSERT_TRUE(!ConfigImage::update(1, settings));
+    ASSERT_TRUE(!ConfigImage::get(key("alpha_steps_per_mm"), found, value, source));
+}
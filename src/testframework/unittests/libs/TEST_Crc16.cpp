@@ -0,0 +1,64 @@
+#include "Crc16.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "us_ticker_api.h"
+
+#include "easyunit/test.h"
+
+// one byte at a time, the way it was done before the tables were sliced
+static uint16_t crc_bytewise(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0;
+    for (size_t i = 0; i < len; ++i) crc = crc16_ccitt_update(crc, data[i]);
+    return crc;
+}
+
+TEST(Crc16Test,check_value)
+{
+    // standard check value of CRC-16/XMODEM
+    ASSERT_TRUE(crc16_ccitt((const uint8_t *)"123456789", 9) == 0x31C3);
+    ASSERT_TRUE(crc16_ccitt((const uint8_t *)"", 0) == 0);
+}
+
+TEST(Crc16Test,matches_bytewise)
+{
+    static uint8_t data[600];
+    srand(42);
+    for (size_t i = 0; i < sizeof(data); ++i) data[i] = rand() & 0xFF;
+
+    // every length and start alignment so the four byte loop and the tail are both covered
+    for (int off = 0; off < 4; ++off) {
+        for (int len = 0; len < 64; ++len) {
+            ASSERT_TRUE(crc16_ccitt(&data[off], len) == crc_bytewise(&data[off], len));
+        }
+    }
+    ASSERT_TRUE(crc16_ccitt(data, sizeof(data)) == crc_bytewise(data, sizeof(data)));
+
+    // can be carried on across calls
+    uint16_t crc = crc16_ccitt(data, 101);
+    crc = crc16_ccitt(&data[101], sizeof(data) - 101, crc);
+    ASSERT_TRUE(crc == crc_bytewise(data, sizeof(data)));
+}
+
+TEST(Crc16Test,throughput)
+{
+    static uint8_t data[512];
+    for (size_t i = 0; i < sizeof(data); ++i) data[i] = i;
+
+    const int loops = 200;
+    volatile uint16_t sink = 0;
+
+    uint32_t t0 = us_ticker_read();
+    for (int k = 0; k < loops; ++k) sink ^= crc_bytewise(data, sizeof(data));
+    uint32_t tb = us_ticker_read() - t0;
+
+    t0 = us_ticker_read();
+    for (int k = 0; k < loops; ++k) sink ^= crc16_ccitt(data, sizeof(data));
+    uint32_t ts = us_ticker_read() - t0;
+
+    printf("crc16: %d bytes, bytewise %lu us, sliced %lu us\n", loops * (int)sizeof(data), tb, ts);
+    ASSERT_TRUE(ts <= tb);
+}
@@ -0,0 +1,53 @@
+#include "FileHash.h"
+#include "md5.h"
+
+#include <string.h>
+
+#include "easyunit/test.h"
+
+TEST(FileHashTest,md5_vectors)
+{
+    ASSERT_TRUE(MD5("").hexdigest() == "d41d8cd98f00b204e9800998ecf8427e");
+    ASSERT_TRUE(MD5("abc").hexdigest() == "900150983cd24fb0d6963f7d28e17f72");
+    ASSERT_TRUE(MD5("12345678901234567890123456789012345678901234567890123456789012345678901234567890").hexdigest() == "57edf4a22be3c955ac49da2e2107b67a");
+}
+
+TEST(FileHashTest,md5_unaligned_updates)
+{
+    static char buf[200];
+    for (int i = 0; i < 200; ++i) buf[i] = 'a' + (i % 26);
+
+    MD5 whole;
+    whole.update(buf + 1, 199);
+    whole.finalize();
+
+    MD5 parts;
+    parts.update(buf + 1, 3);
+    parts.update(buf + 4, 70);
+    parts.update(buf + 74, 126);
+    parts.finalize();
+
+    ASSERT_TRUE(whole.hexdigest() == parts.hexdigest());
+}
+
+TEST(FileHashTest,adler32_vectors)
+{
+    const uint8_t *s = (const uint8_t *)"Wikipedia";
+    ASSERT_TRUE((unsigned long)adler32(s, 9, 1) == 0x11E60398UL);
+    ASSERT_TRUE((unsigned long)adler32(s, 0, 1) == 1UL);
+
+    // split updates must match a single pass
+    uint32_t sum = adler32(s, 4, 1);
+    sum = adler32(s + 4, 5, sum);
+    ASSERT_TRUE((unsigned long)sum == 0x11E60398UL);
+}
+
+TEST(FileHashTest,adler32_long_run)
+{
+    // more than ADLER_NMAX bytes of 0xFF exercises the deferred modulo
+    static uint8_t buf[FILEHASH_CHUNK_SIZE];
+    memset(buf, 0xFF, sizeof(buf));
+    uint32_t sum = 1;
+    for (int i = 0; i < 4; ++i) sum = adler32(buf, sizeof(buf), sum);
+    ASSERT_TRUE((unsigned long)sum == 0xB0D9C3B2UL);
+}
@@ -0,0 +1,152 @@
+#include "FrameParser.h"
+#include "PublicData.h"
+#include "Crc16.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "us_ticker_api.h"
+
+#include "easyunit/test.h"
+
+static int make_frame(uint8_t *out, uint8_t type, const uint8_t *payload, int n)
+{
+    int len = n + 3;
+    out[0] = (HEADER >> 8) & 0xFF;
+    out[1] = HEADER & 0xFF;
+    out[2] = (len >> 8) & 0xFF;
+    out[3] = len & 0xFF;
+    out[4] = type;
+    memcpy(&out[5], payload, n);
+    uint16_t crc = crc16_ccitt(&out[2], len);
+    out[n + 5] = (crc >> 8) & 0xFF;
+    out[n + 6] = crc & 0xFF;
+    out[n + 7] = (FOOTER >> 8) & 0xFF;
+    out[n + 8] = FOOTER & 0xFF;
+    return n + 9;
+}
+
+TEST(FrameParserTest,single_frame)
+{
+    static uint8_t buf[64];
+    FrameParser fp(buf, sizeof(buf));
+
+    uint8_t frame[32];
+    int n = make_frame(frame, PTYPE_CTRL_MULTI, (const uint8_t *)"G0 X1", 5);
+    int done = 0;
+    for (int i = 0; i < n; ++i) {
+        if (fp.feed(frame[i])) done = i + 1;
+    }
+    ASSERT_TRUE(done == n);
+    ASSERT_TRUE(fp.type() == PTYPE_CTRL_MULTI);
+    ASSERT_TRUE(fp.payload_len() == 5);
+    ASSERT_TRUE(memcmp(fp.payload(), "G0 X1", 5) == 0);
+}
+
+TEST(FrameParserTest,rejects_bad_crc_and_footer)
+{
+    static uint8_t buf[64];
+    FrameParser fp(buf, sizeof(buf));
+
+    uint8_t frame[32];
+    int n = make_frame(frame, PTYPE_CTRL_SINGLE, (const uint8_t *)"?", 1);
+    frame[5] ^= 0x01;
+    for (int i = 0; i < n; ++i) ASSERT_TRUE(!fp.feed(frame[i]));
+    ASSERT_TRUE(fp.crc_errors == 1);
+
+    n = make_frame(frame, PTYPE_CTRL_SINGLE, (const uint8_t *)"?", 1);
+    frame[n - 1] = 0;
+    for (int i = 0; i < n; ++i) ASSERT_TRUE(!fp.feed(frame[i]));
+    ASSERT_TRUE(fp.framing_errors == 1);
+
+    // too long for the buffer
+    n = make_frame(frame, PTYPE_CTRL_SINGLE, (const uint8_t *)"?", 1);
+    frame[2] = 0x10;
+    for (int i = 0; i < n; ++i) ASSERT_TRUE(!fp.feed(frame[i]));
+    ASSERT_TRUE(fp.framing_errors == 2);
+
+    // and still in sync afterwards
+    n = make_frame(frame, PTYPE_CTRL_SINGLE, (const uint8_t *)"?", 1);
+    bool ok = false;
+    for (int i = 0; i < n; ++i) ok = fp.feed(frame[i]);
+    ASSERT_TRUE(ok);
+}
+
+// plain text from an old controller app is counted as skipped, back to back frames are not
+TEST(FrameParserTest,skipped)
+{
+    static uint8_t buf[64];
+    FrameParser fp(buf, sizeof(buf));
+
+    const char *line = "G0 X1\n";
+    for (const char *p = line; *p; ++p) ASSERT_TRUE(!fp.feed(*p));
+    ASSERT_TRUE(fp.skipped == 6);
+
+    uint8_t frame[32];
+    int n = make_frame(frame, PTYPE_CTRL_MULTI, (const uint8_t *)"G0 X1", 5);
+    for (int k = 0; k < 3; ++k) {
+        for (int i = 0; i < n; ++i) fp.feed(frame[i]);
+    }
+    ASSERT_TRUE(fp.frames == 3);
+    ASSERT_TRUE(fp.skipped == 6);
+}
+
+// random payloads with random noise between frames, every frame has to come out intact
+TEST(FrameParserTest,fuzz)
+{
+    static uint8_t buf[544];
+    static uint8_t frame[544];
+    static uint8_t payload[513];
+    FrameParser fp(buf, sizeof(buf));
+
+    srand(1234);
+    int sent = 0, received = 0, corrupt = 0;
+    for (int k = 0; k < 500; ++k) {
+        int noise = rand() % 16;
+        for (int i = 0; i < noise; ++i) {
+            if (fp.feed(rand() & 0xFF)) corrupt++;
+        }
+
+        int n = rand() % sizeof(payload);
+        for (int i = 0; i < n; ++i) payload[i] = rand() & 0xFF;
+        int len = make_frame(frame, PTYPE_CTRL_MULTI, payload, n);
+        sent++;
+        for (int i = 0; i < len; ++i) {
+            if (fp.feed(frame[i])) {
+                if (fp.payload_len() == n && memcmp(fp.payload(), payload, n) == 0) received++;
+                else corrupt++;
+            }
+        }
+    }
+    printf("fuzz: %d sent, %d received, %lu crc errors, %lu framing errors\n", sent, received, fp.crc_errors, fp.framing_errors);
+    ASSERT_TRUE(corrupt == 0);
+    // noise can occasionally look like a header and swallow the frame after it
+    ASSERT_TRUE(received >= sent - 5);
+}
+
+TEST(FrameParserTest,throughput)
+{
+    static uint8_t buf[544];
+    static uint8_t frame[544];
+    static uint8_t payload[128];
+    FrameParser fp(buf, sizeof(buf));
+
+    for (size_t i = 0; i < sizeof(payload); ++i) payload[i] = 'A' + i % 26;
+    int len = make_frame(frame, PTYPE_CTRL_MULTI, payload, sizeof(payload));
+
+    const int loops = 256;
+    int frames = 0;
+    uint32_t t0 = us_ticker_read();
+    for (int k = 0; k < loops; ++k) {
+        for (int i = 0; i < len; ++i) {
+            if (fp.feed(frame[i])) frames++;
+        }
+    }
+    uint32_t t = us_ticker_read() - t0;
+
+    printf("parser: %d bytes in %lu us\n", loops * len, t);
+    ASSERT_TRUE(frames == loops);
+    // has to keep up with 115200 baud with plenty to spare, that is 87us per byte
+    ASSERT_TRUE(t < (uint32_t)(loops * len) * 8);
+}
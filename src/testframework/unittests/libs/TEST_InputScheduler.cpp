@@ -0,0 +1,130 @@
+#include "Kernel.h"
+#include "InputScheduler.h"
+#include "SerialMessage.h"
+#include "StreamOutput.h"
+#include "Test_kernel.h"
+
+#include <string>
+#include <vector>
+
+#include "easyunit/test.h"
+
+static std::vector<std::string> lines_run;
+
+TEST(InputSchedulerTest,jog_first_fifo_within_source)
+{
+    InputScheduler sched;
+    uint8_t serial = sched.add_source("serial");
+    uint8_t wifi = sched.add_source("wifi");
+
+    lines_run.clear();
+    test_kernel_trap_event(ON_CONSOLE_LINE_RECEIVED, [](void *argument) {
+        lines_run.push_back(static_cast<SerialMessage *>(argument)->message);
+    });
+
+    sched.submit(serial, &StreamOutput::NullStream, "G1 X1");
+    sched.submit(serial, &StreamOutput::NullStream, "G1 X2");
+    sched.submit(wifi, &StreamOutput::NullStream, "$J X10 F1000");
+    ASSERT_TRUE(!sched.idle(serial) && !sched.idle(wifi));
+    sched.dispatch();
+    test_kernel_untrap_event(ON_CONSOLE_LINE_RECEIVED);
+
+    ASSERT_TRUE(lines_run.size() == 3);
+    ASSERT_TRUE(lines_run[0] == "$J X10 F1000");
+    ASSERT_TRUE(lines_run[1] == "G1 X1");
+    ASSERT_TRUE(lines_run[2] == "G1 X2");
+    ASSERT_TRUE(sched.idle(serial) && sched.idle(wifi));
+}
+
+TEST(InputSchedulerTest,queue_is_bounded)
+{
+    InputScheduler sched;
+    uint8_t serial = sched.add_source("serial");
+    for (int i = 0; i < INPUT_QUEUE_SIZE; ++i) {
+        ASSERT_TRUE(sched.has_room(serial));
+        sched.submit(serial, &StreamOutput::NullStream, "G4 P0");
+    }
+    ASSERT_TRUE(!sched.has_room(serial));
+}
+
+// nothing runs from inside a running line, not even a jog, they go in priority order once it is done
+TEST(InputSchedulerTest,not_nested)
+{
+    static InputScheduler *sched;
+    static uint8_t serial, wifi;
+    InputScheduler s;
+    sched = &s;
+    serial = s.add_source("serial");
+    wifi = s.add_source("wifi");
+
+    lines_run.clear();
+    test_kernel_trap_event(ON_CONSOLE_LINE_RECEIVED, [](void *argument) {
+        std::string line = static_cast<SerialMessage *>(argument)->message;
+        lines_run.push_back(line);
+        if (line == "G1 X1") {
+            // as if more arrived while it waited for the planner
+            sched->submit(serial, &StreamOutput::NullStream, "$J X1");
+            sched->submit(wifi, &StreamOutput::NullStream, "$J Y1");
+            sched->submit(wifi, &StreamOutput::NullStream, "G1 Y1");
+            sched->dispatch();
+            lines_run.push_back("end G1 X1");
+        }
+    });
+
+    s.submit(serial, &StreamOutput::NullStream, "G1 X1");
+    s.dispatch();
+    test_kernel_untrap_event(ON_CONSOLE_LINE_RECEIVED);
+
+    ASSERT_TRUE(lines_run.size() == 5);
+    ASSERT_TRUE(lines_run[0] == "G1 X1");
+    ASSERT_TRUE(lines_run[1] == "end G1 X1");
+    ASSERT_TRUE(lines_run[2] == "$J Y1");
+    ASSERT_TRUE(lines_run[3] == "$J X1");
+    ASSERT_TRUE(lines_run[4] == "G1 Y1");
+}
+
+// a stream of jogs can not hold a streamed line back for more than INPUT_FAIR_LIMIT of them
+TEST(InputSchedulerTest,aging)
+{
+    static InputScheduler *sched;
+    static uint8_t jogs;
+    static int sent;
+    InputScheduler s;
+    sched = &s;
+    uint8_t serial = s.add_source("serial");
+    jogs = s.add_source("pendant");
+
+    lines_run.clear();
+    sent = 1;
+    test_kernel_trap_event(ON_CONSOLE_LINE_RECEIVED, [](void *argument) {
+        std::string line = static_cast<SerialMessage *>(argument)->message;
+        lines_run.push_back(line);
+        if (line[0] == '$' && sent < 30) {
+            sched->submit(jogs, &StreamOutput::NullStream, "$J X1");
+            sent++;
+        }
+    });
+
+    s.submit(jogs, &StreamOutput::NullStream, "$J X1");
+    s.submit(serial, &StreamOutput::NullStream, "G1 X1");
+    for (int i = 0; i < 10; ++i) s.dispatch();
+    test_kernel_untrap_event(ON_CONSOLE_LINE_RECEIVED);
+
+    size_t at = 0;
+    while (at < lines_run.size() && lines_run[at] != "G1 X1") at++;
+    ASSERT_TRUE(at < lines_run.size());
+    ASSERT_TRUE(at == INPUT_FAIR_LIMIT);
+    ASSERT_TRUE(lines_run.size() == 31);
+}
+
+TEST(InputSchedulerTest,file_yields_then_gets_its_turn)
+{
+    InputScheduler s;
+    uint8_t file = s.add_source("file");
+    uint8_t serial = s.add_source("serial");
+
+    ASSERT_TRUE(!s.should_yield(file, INPUT_FILE));
+    s.submit(serial, &StreamOutput::NullStream, "M3 S1000");
+    for (int i = 0; i < INPUT_FAIR_LIMIT; ++i) ASSERT_TRUE(s.should_yield(file, INPUT_FILE));
+    ASSERT_TRUE(!s.should_yield(file, INPUT_FILE));
+}
@@ -0,0 +1,84 @@
+#include "MemoryPool.h"
+
+#include <string.h>
+
+#include "easyunit/test.h"
+
+#define POOL_SIZE 2048
+
+static uint32_t pool_buf[POOL_SIZE / 4];
+
+// a freed chunk is the first one found again
+TEST(MemoryPoolTest,first_fit_reuse)
+{
+    MemoryPool pool(pool_buf, POOL_SIZE);
+
+    void *a = pool.alloc(10);
+    void *b = pool.alloc(12);
+    ASSERT_TRUE(a != NULL && b != NULL && a != b);
+    ASSERT_TRUE(pool.has(a) && pool.has(b));
+    ASSERT_TRUE(pool.free() == POOL_SIZE - 16 - 16);
+
+    pool.dealloc(a);
+    ASSERT_TRUE(pool.alloc(8) == a);
+    // the hole before b is taken, what is left is in one piece after b
+    ASSERT_TRUE(pool.largest_free() == pool.free());
+}
+
+// everything freed in any order is coalesced back into one free chunk
+TEST(MemoryPoolTest,mixed_sizes)
+{
+    MemoryPool pool(pool_buf, POOL_SIZE);
+
+    static const size_t sizes[] = { 4, 200, 24, 64, 65, 8, 48, 100, 33, 17 };
+    const int n = sizeof(sizes) / sizeof(sizes[0]);
+    uint8_t *p[n];
+    for (int i = 0; i < n; i++) {
+        p[i] = (uint8_t *)pool.alloc(sizes[i]);
+        ASSERT_TRUE(p[i] != NULL);
+        memset(p[i], i, sizes[i]);
+    }
+    for (int i = 0; i < n; i++) {
+        for (size_t j = 0; j < sizes[i]; j++) ASSERT_TRUE(p[i][j] == i);
+    }
+
+    // every other one first, so chunks have to be coalesced from both sides
+    for (int i = 0; i < n; i += 2) pool.dealloc(p[i]);
+    ASSERT_TRUE(pool.largest_free() < pool.free());
+    for (int i = 1; i < n; i += 2) pool.dealloc(p[i]);
+
+    ASSERT_TRUE(pool.free() == POOL_SIZE);
+    ASSERT_TRUE(pool.largest_free() == POOL_SIZE);
+}
+
+// a split that would leave only a header gives the whole chunk instead, the walks stop at a header only chunk
+TEST(MemoryPoolTest,no_header_only_chunk)
+{
+    MemoryPool pool(pool_buf, POOL_SIZE);
+
+    void *a = pool.alloc(POOL_SIZE - 8);
+    ASSERT_TRUE(a != NULL);
+    ASSERT_TRUE(pool.free() == 0);
+    ASSERT_TRUE(pool.alloc(1) == NULL);
+
+    pool.dealloc(a);
+    ASSERT_TRUE(pool.free() == POOL_SIZE);
+}
+
+// a base that is not word aligned and an odd size are trimmed to whole words
+TEST(MemoryPoolTest,unaligned_base)
+{
+    MemoryPool pool(((uint8_t *)pool_buf) + 1, POOL_SIZE - 6);
+    ASSERT_TRUE(pool.free() == POOL_SIZE - 12);
+    ASSERT_TRUE(!pool.has(((uint8_t *)pool_buf) + 3) && pool.has(((uint8_t *)pool_buf) + 4));
+
+    void *a = pool.alloc(10);
+    void *b = pool.alloc(100);
+    ASSERT_TRUE(a != NULL && b != NULL);
+    ASSERT_TRUE(((uintptr_t)a & 3) == 0 && ((uintptr_t)b & 3) == 0);
+
+    pool.dealloc(a);
+    pool.dealloc(b);
+    ASSERT_TRUE(pool.alloc(POOL_SIZE) == NULL);
+    ASSERT_TRUE(pool.free() == POOL_SIZE - 12);
+}
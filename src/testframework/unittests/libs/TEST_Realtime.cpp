@@ -0,0 +1,115 @@
+#include "Realtime.h"
+#include "PublicData.h"
+#include "Crc16.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "easyunit/test.h"
+
+static int make_frame(uint8_t *out, uint8_t type, const uint8_t *payload, int n)
+{
+    int len = n + 3;
+    out[0] = (HEADER >> 8) & 0xFF;
+    out[1] = HEADER & 0xFF;
+    out[2] = (len >> 8) & 0xFF;
+    out[3] = len & 0xFF;
+    out[4] = type;
+    memcpy(&out[5], payload, n);
+    uint16_t crc = crc16_ccitt(&out[2], len);
+    out[n + 5] = (crc >> 8) & 0xFF;
+    out[n + 6] = crc & 0xFF;
+    out[n + 7] = (FOOTER >> 8) & 0xFF;
+    out[n + 8] = FOOTER & 0xFF;
+    return n + 9;
+}
+
+// feeds in[] through the filter, collects what is passed on and the commands taken out
+static int run(RealtimeFilter &f, const uint8_t *in, int n, uint8_t *passed, char *cmds, int &ncmds)
+{
+    uint8_t out[REALTIME_FRAME_SIZE];
+    int np = 0;
+    ncmds = 0;
+    for (int i = 0; i < n; ++i) {
+        char cmd;
+        int k = f.feed(in[i], out, cmd);
+        memcpy(&passed[np], out, k);
+        np += k;
+        if (cmd != 0) cmds[ncmds++] = cmd;
+    }
+    return np;
+}
+
+TEST(RealtimeTest,takes_realtime_frames)
+{
+    RealtimeFilter f;
+    uint8_t in[64], passed[64];
+    char cmds[8];
+    int ncmds;
+
+    int n = make_frame(in, PTYPE_CTRL_SINGLE, (const uint8_t *)"?", 1);
+    n += make_frame(&in[n], PTYPE_CTRL_SINGLE, (const uint8_t *)"\x18", 1);
+    int np = run(f, in, n, passed, cmds, ncmds);
+    ASSERT_TRUE(np == 0);
+    ASSERT_TRUE(ncmds == 2);
+    ASSERT_TRUE(cmds[0] == '?' && cmds[1] == 0x18);
+}
+
+TEST(RealtimeTest,passes_everything_else)
+{
+    RealtimeFilter f;
+    uint8_t in[64], passed[64];
+    char cmds[8];
+    int ncmds;
+
+    // a frame that is not a realtime command, one with a bad crc, and stray header bytes
+    int n = make_frame(in, PTYPE_CTRL_MULTI, (const uint8_t *)"G0 X1", 5);
+    int m = make_frame(&in[n], PTYPE_CTRL_SINGLE, (const uint8_t *)"!", 1);
+    in[n + 6] ^= 0x01;
+    n += m;
+    in[n++] = (HEADER >> 8) & 0xFF;
+    in[n++] = (HEADER >> 8) & 0xFF;
+    n += make_frame(&in[n], PTYPE_CTRL_SINGLE, (const uint8_t *)"~", 1);
+
+    int np = run(f, in, n, passed, cmds, ncmds);
+    ASSERT_TRUE(ncmds == 1);
+    ASSERT_TRUE(cmds[0] == '~');
+    ASSERT_TRUE(np == n - REALTIME_FRAME_SIZE);
+    ASSERT_TRUE(memcmp(passed, in, np) == 0);
+}
+
+// random traffic with realtime frames mixed in, nothing else may be lost or reordered
+TEST(RealtimeTest,fuzz)
+{
+    static uint8_t in[8192], expect[8192], passed[8192];
+    static char cmds[512];
+    static const char rt[] = { '?', '!', '~', 0x18 };
+    RealtimeFilter f;
+
+    srand(4321);
+    int n = 0, ne = 0, sent = 0;
+    uint8_t payload[40];
+    while (n < (int)sizeof(in) - 64) {
+        int r = rand() % 3;
+        if (r == 0) {
+            in[n++] = expect[ne++] = rand() & 0xFF;
+        } else if (r == 1) {
+            int len = rand() % sizeof(payload);
+            for (int i = 0; i < len; ++i) payload[i] = rand() & 0xFF;
+            int k = make_frame(&in[n], PTYPE_CTRL_MULTI, payload, len);
+            memcpy(&expect[ne], &in[n], k);
+            n += k;
+            ne += k;
+        } else {
+            payload[0] = rt[rand() % 4];
+            n += make_frame(&in[n], PTYPE_CTRL_SINGLE, payload, 1);
+            sent++;
+        }
+    }
+
+    int ncmds;
+    int np = run(f, in, n, passed, cmds, ncmds);
+    ASSERT_TRUE(ncmds == sent);
+    ASSERT_TRUE(np == ne);
+    ASSERT_TRUE(memcmp(passed, expect, ne) == 0);
+}
@@ -0,0 +1,141 @@
+#include "SDDma.h"
+#include "SDCRC.h"
+
+#include <string.h>
+#include <string>
+
+#include "easyunit/test.h"
+
+// plays the card: replies come from a script, everything sent is kept, block transfers take a few polls
+class MockBus : public SDBus {
+    public:
+        MockBus() : pos(0), polls(0), pending(0) {}
+
+        char transfer(char c)
+        {
+            out.push_back(c);
+            return pos < script.size() ? script[pos++] : (char)0xFF;
+        }
+
+        void start(const char *tx, char *rx, int length)
+        {
+            for (int i = 0; i < length; ++i) {
+                out.push_back(tx != NULL ? tx[i] : (char)0xFF);
+                char c = pos < script.size() ? script[pos++] : (char)0xFF;
+                if (rx != NULL) rx[i] = c;
+            }
+            pending = 3;
+        }
+
+        bool done()
+        {
+            polls++;
+            if (pending == 0) return true;
+            pending--;
+            return false;
+        }
+
+        std::string script;
+        std::string out;
+        size_t pos;
+        int polls;
+        int pending;
+};
+
+static void fill(char *block, int seed)
+{
+    for (int i = 0; i < 512; ++i) block[i] = (char)(i * 13 + seed);
+}
+
+// the start token, the block and its crc, as a card sends them
+static void add_block(std::string& script, const char *block, bool good_crc = true)
+{
+    unsigned short crc = SDCRC::crc16(block, 512);
+    if (!good_crc) crc ^= 0x0100;
+    script.append("\xFF\xFF\xFE", 3);
+    script.append(block, 512);
+    script.push_back(crc >> 8);
+    script.push_back(crc & 0xFF);
+}
+
+TEST(SDBlockTest,read_checks_crc)
+{
+    static char block[512], buf[512];
+    fill(block, 1);
+
+    MockBus bus;
+    add_block(bus.script, block);
+    ASSERT_TRUE(SDBlock::read(bus, buf, 512, true));
+    ASSERT_TRUE(memcmp(buf, block, 512) == 0);
+    ASSERT_TRUE(bus.polls == 4);
+
+    MockBus bad;
+    add_block(bad.script, block, false);
+    ASSERT_TRUE(!SDBlock::read(bad, buf, 512, true));
+
+    MockBus unchecked;
+    add_block(unchecked.script, block, false);
+    ASSERT_TRUE(SDBlock::read(unchecked, buf, 512, false));
+
+    // an error token instead of a block
+    MockBus error;
+    error.script = "\xFF\x09";
+    ASSERT_TRUE(!SDBlock::read(error, buf, 512, true));
+}
+
+TEST(SDBlockTest,read_multiple_counts_good_blocks)
+{
+    static char blocks[3][512], buf[3 * 512];
+    for (int i = 0; i < 3; ++i) fill(blocks[i], i * 7);
+
+    MockBus bus;
+    for (int i = 0; i < 3; ++i) add_block(bus.script, blocks[i]);
+    ASSERT_TRUE(SDBlock::readMultiple(bus, buf, 3, true) == 3);
+    ASSERT_TRUE(memcmp(buf, blocks, sizeof(buf)) == 0);
+
+    // the second block is found bad while the third comes in
+    MockBus second;
+    add_block(second.script, blocks[0]);
+    add_block(second.script, blocks[1], false);
+    add_block(second.script, blocks[2]);
+    ASSERT_TRUE(SDBlock::readMultiple(second, buf, 3, true) == 1);
+
+    MockBus last;
+    add_block(last.script, blocks[0]);
+    add_block(last.script, blocks[1]);
+    add_block(last.script, blocks[2], false);
+    ASSERT_TRUE(SDBlock::readMultiple(last, buf, 3, true) == 2);
+
+    // the card stops after two blocks
+    MockBus stops;
+    add_block(stops.script, blocks[0]);
+    add_block(stops.script, blocks[1]);
+    stops.script.append("\xFF\x09", 2);
+    ASSERT_TRUE(SDBlock::readMultiple(stops, buf, 3, true) == 2);
+}
+
+TEST(SDBlockTest,write_sends_block_and_crc)
+{
+    static char block[512];
+    fill(block, 3);
+    unsigned short crc = SDCRC::crc16(block, 512);
+
+    MockBus bus;
+    // ready, the echo of the token, the block and the crc, then data accepted
+    bus.script.append(1, (char)0xFF);
+    bus.script.append(1 + 512 + 2, (char)0x00);
+    bus.script.append(1, (char)0xE5);
+    ASSERT_TRUE(SDBlock::write(bus, block, 0xFC, true) == 0x05);
+
+    ASSERT_TRUE(bus.out.size() == 1 + 1 + 512 + 2 + 1);
+    ASSERT_TRUE(bus.out[1] == (char)0xFC);
+    ASSERT_TRUE(memcmp(&bus.out[2], block, 512) == 0);
+    ASSERT_TRUE((unsigned char)bus.out[514] == (crc >> 8));
+    ASSERT_TRUE((unsigned char)bus.out[515] == (crc & 0xFF));
+
+    // without crc the card is sent 0xFFFF
+    MockBus nocrc;
+    nocrc.script = bus.script;
+    ASSERT_TRUE(SDBlock::write(nocrc, block, 0xFE, false) == 0x05);
+    ASSERT_TRUE(nocrc.out[514] == (char)0xFF && nocrc.out[515] == (char)0xFF);
+}
@@ -0,0 +1,130 @@
+#include "SectorCache.h"
+#include "disk.h"
+
+#include <string.h>
+
+#include "easyunit/test.h"
+
+// a card of 64 sectors, each filled with its own number, that counts what it is asked for
+class MockDisk : public MSD_Disk {
+    public:
+        MockDisk() : reads(0), sectors_read(0), writes(0) {}
+
+        int disk_read(char *data, uint32_t block, uint32_t count)
+        {
+            if (block + count > 64) return 1;
+            reads++;
+            sectors_read += count;
+            memcpy(data, card[block], count * 512);
+            return 0;
+        }
+
+        int disk_write(const char *data, uint32_t block, uint32_t count)
+        {
+            if (block + count > 64) return 1;
+            writes++;
+            memcpy(card[block], data, count * 512);
+            return 0;
+        }
+
+        bool busy() { return false; }
+
+        void fill()
+        {
+            for (int i = 0; i < 64; ++i) memset(card[i], i, 512);
+        }
+
+        char card[64][512];
+        int reads;
+        int sectors_read;
+        int writes;
+};
+
+TEST(SectorCacheTest,sequential_reads_ahead)
+{
+    static MockDisk disk;
+    static char buf[512];
+    disk.fill();
+    SectorCache cache(&disk);
+
+    // until setup everything goes to the card as it is
+    ASSERT_TRUE(cache.read(buf, 40, 1) == 0 && cache.read(buf, 41, 1) == 0 && buf[0] == 41);
+    ASSERT_TRUE(disk.sectors_read == 2 && cache.memory() == 0);
+    ASSERT_TRUE(cache.setup());
+    ASSERT_TRUE(cache.memory() == (SECTORCACHE_LINES * SECTORCACHE_LINE_SECTORS + SECTORCACHE_FAT_SECTORS) * 512);
+    disk.reads = disk.sectors_read = 0;
+
+    // a random read only fetches what was asked for
+    ASSERT_TRUE(cache.read(buf, 40, 1) == 0 && buf[0] == 40);
+    ASSERT_TRUE(disk.sectors_read == 1 && cache.prefetched == 0);
+
+    // the next sector after it fills a whole line
+    ASSERT_TRUE(cache.read(buf, 41, 1) == 0 && buf[0] == 41);
+    ASSERT_TRUE(disk.sectors_read == 1 + SECTORCACHE_LINE_SECTORS);
+    for (int i = 1; i < SECTORCACHE_LINE_SECTORS; ++i) {
+        ASSERT_TRUE(cache.read(buf, 41 + i, 1) == 0 && buf[511] == 41 + i);
+    }
+    ASSERT_TRUE(disk.reads == 2);
+    ASSERT_TRUE(cache.hits == SECTORCACHE_LINE_SECTORS - 1);
+    ASSERT_TRUE(cache.prefetched == SECTORCACHE_LINE_SECTORS - 1);
+
+    // reading ahead past the end of the card falls back to what was asked for
+    ASSERT_TRUE(cache.read(buf, 62, 1) == 0);
+    ASSERT_TRUE(cache.read(buf, 63, 1) == 0 && buf[0] == 63);
+
+    // too big to cache
+    static char big[(SECTORCACHE_LINE_SECTORS + 1) * 512];
+    ASSERT_TRUE(cache.read(big, 8, SECTORCACHE_LINE_SECTORS + 1) == 0 && big[512] == 9);
+    ASSERT_TRUE(cache.bypassed == SECTORCACHE_LINE_SECTORS + 1);
+}
+
+TEST(SectorCacheTest,fat_sectors_stay)
+{
+    static MockDisk disk;
+    static char buf[512];
+    disk.fill();
+    SectorCache cache(&disk);
+    ASSERT_TRUE(cache.setup());
+    cache.set_fat(2, 4);
+
+    ASSERT_TRUE(cache.read(buf, 2, 1) == 0 && buf[0] == 2);
+    // streaming through more data than the cache holds
+    for (int i = 10; i < 10 + SECTORCACHE_LINES * SECTORCACHE_LINE_SECTORS * 2; ++i) {
+        ASSERT_TRUE(cache.read(buf, i, 1) == 0 && buf[0] == i);
+    }
+    int before = disk.reads;
+    ASSERT_TRUE(cache.read(buf, 2, 1) == 0 && buf[0] == 2);
+    ASSERT_TRUE(disk.reads == before);
+    ASSERT_TRUE(cache.fat_hits == 1 && cache.fat_misses == 1);
+}
+
+TEST(SectorCacheTest,writes_update_copies)
+{
+    static MockDisk disk;
+    static char buf[512], data[2 * 512];
+    disk.fill();
+    SectorCache cache(&disk);
+    ASSERT_TRUE(cache.setup());
+    cache.set_fat(2, 4);
+
+    ASSERT_TRUE(cache.read(buf, 20, 1) == 0);
+    ASSERT_TRUE(cache.read(buf, 21, 1) == 0);
+    ASSERT_TRUE(cache.read(buf, 3, 1) == 0);
+
+    memset(data, 0x55, sizeof(data));
+    ASSERT_TRUE(cache.write(data, 22, 2) == 0);
+    ASSERT_TRUE(cache.write(data, 3, 1) == 0);
+    ASSERT_TRUE(disk.writes == 2);
+
+    int before = disk.reads;
+    ASSERT_TRUE(cache.read(buf, 22, 1) == 0 && buf[0] == 0x55);
+    ASSERT_TRUE(cache.read(buf, 21, 1) == 0 && buf[0] == 21);
+    ASSERT_TRUE(cache.read(buf, 3, 1) == 0 && buf[0] == 0x55);
+    ASSERT_TRUE(disk.reads == before);
+
+    // a failed write drops the copy instead
+    ASSERT_TRUE(cache.write(data, 63, 2) != 0);
+    cache.invalidate();
+    ASSERT_TRUE(cache.read(buf, 22, 1) == 0 && buf[0] == 0x55);
+    ASSERT_TRUE(disk.reads == before + 1);
+}
@@ -0,0 +1,106 @@
+#include "SectorWriter.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "easyunit/test.h"
+
+#define TEST_FILE "/sd/sectorwriter.tmp"
+
+static uint8_t pattern(uint32_t i)
+{
+    return (i * 7 + (i >> 9)) & 0xFF;
+}
+
+// chunks of every awkward size have to come out as one contiguous file
+TEST(SectorWriterTest,odd_chunks)
+{
+    static uint8_t buf[3000];
+    static const size_t sizes[] = { 1, 511, 512, 513, 1024, 3000, 7, 2048, 4095, 100 };
+
+    FILE *fp = fopen(TEST_FILE, "wb");
+    ASSERT_TRUE(fp != NULL);
+
+    SectorWriter writer;
+    writer.attach(fp);
+    uint32_t n = 0;
+    for (int k = 0; k < 3; ++k) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+            size_t len = sizes[s] > sizeof(buf) ? sizeof(buf) : sizes[s];
+            for (size_t i = 0; i < len; ++i) buf[i] = pattern(n + i);
+            ASSERT_TRUE(writer.write(buf, len));
+            n += len;
+        }
+    }
+    ASSERT_TRUE(writer.flush());
+    fclose(fp);
+    ASSERT_TRUE(writer.total == n);
+
+    fp = fopen(TEST_FILE, "rb");
+    ASSERT_TRUE(fp != NULL);
+    uint32_t pos = 0;
+    bool same = true;
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        for (size_t i = 0; i < got; ++i) {
+            if (buf[i] != pattern(pos + i)) same = false;
+        }
+        pos += got;
+    }
+    fclose(fp);
+    remove(TEST_FILE);
+
+    ASSERT_TRUE(pos == n);
+    ASSERT_TRUE(same);
+}
+
+// whole sector packets never touch the staging buffer
+TEST(SectorWriterTest,aligned_packets_go_direct)
+{
+    static uint8_t buf[4096];
+    memset(buf, 0x5A, sizeof(buf));
+
+    FILE *fp = fopen(TEST_FILE, "wb");
+    ASSERT_TRUE(fp != NULL);
+
+    SectorWriter writer;
+    writer.attach(fp);
+    for (int k = 0; k < 4; ++k) ASSERT_TRUE(writer.write(buf, sizeof(buf)));
+    ASSERT_TRUE(writer.write(buf, 100));
+    ASSERT_TRUE(writer.flush());
+    fclose(fp);
+    remove(TEST_FILE);
+
+    ASSERT_TRUE(writer.total == 4 * sizeof(buf) + 100);
+    ASSERT_TRUE(writer.direct == 4 * sizeof(buf));
+}
+
+// a reserved file ends up as long as what was written into it
+TEST(SectorWriterTest,reserve_is_trimmed)
+{
+    static uint8_t buf[5000];
+    for (size_t i = 0; i < sizeof(buf); ++i) buf[i] = pattern(i);
+
+    FILE *fp = fopen(TEST_FILE, "wb");
+    ASSERT_TRUE(fp != NULL);
+
+    SectorWriter writer;
+    writer.attach(fp);
+    ASSERT_TRUE(writer.reserve(64 * 1024));
+    ASSERT_TRUE(writer.write(buf, sizeof(buf)));
+    ASSERT_TRUE(writer.flush());
+    ASSERT_TRUE(!writer.reserve(64 * 1024));
+    fclose(fp);
+
+    fp = fopen(TEST_FILE, "rb");
+    ASSERT_TRUE(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, sizeof(buf) - 1, SEEK_SET);
+    int last = fgetc(fp);
+    fclose(fp);
+    remove(TEST_FILE);
+
+    ASSERT_TRUE(size == (long)sizeof(buf));
+    ASSERT_TRUE(last == pattern(sizeof(buf) - 1));
+}